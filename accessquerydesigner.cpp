@@ -1,10 +1,14 @@
 #include "accessquerydesigner.h"
 #include "datamodel.h"
+#include "sqlengine.h"
+#include "resultmodel.h"
+#include "paramprompt.h"
 
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QListWidget>
 #include <QTableWidget>
+#include <QTableView>
 #include <QHeaderView>
 #include <QToolButton>
 #include <QComboBox>
@@ -16,61 +20,28 @@
 #include <QDate>
 #include <QRegularExpression>
 
-// ===== Helpers de valores / normalización =====
-static QString up(const QString& s){ return QString(s).toUpper(); }
-
-static QString normalizeColToken(QString t){
-    t = t.trimmed();
-    if ((t.startsWith('[') && t.endsWith(']')) ||
-        (t.startsWith('"') && t.endsWith('"')) ||
-        (t.startsWith('`') && t.endsWith('`'))) {
-        t = t.mid(1, t.size()-2);
-    }
-    int dot = t.lastIndexOf('.');
-    if (dot > 0) t = t.mid(dot+1).trimmed();
-    return t;
-}
-static int schemaFieldIndex(const Schema& s, const QString& name){
-    const QString n = normalizeColToken(name);
-    for (int i=0;i<s.size();++i) if(s[i].name.compare(n, Qt::CaseInsensitive)==0) return i;
-    return -1;
-}
-static int cmpVar(const QVariant& a, const QVariant& b){
-    if(!a.isValid() && !b.isValid()) return 0;
-    if(!a.isValid()) return -1;
-    if(!b.isValid()) return 1;
-    if(a.userType()==QMetaType::QDate || b.userType()==QMetaType::QDate){
-        QDate da = a.userType()==QMetaType::QDate ? a.toDate() : QDate::fromString(a.toString(),"yyyy-MM-dd");
-        QDate db = b.userType()==QMetaType::QDate ? b.toDate() : QDate::fromString(b.toString(),"yyyy-MM-dd");
-        if(!da.isValid() || !db.isValid())
-            return QString::compare(a.toString(), b.toString(), Qt::CaseInsensitive);
-        if(da<db) return -1; if(da>db) return 1; return 0;
-    }
-    bool okA=false, okB=false;
-    double da=a.toDouble(&okA), db=b.toDouble(&okB);
-    if(okA && okB){ if(da<db) return -1; if(da>db) return 1; return 0; }
-    if(a.typeId()==QMetaType::LongLong || b.typeId()==QMetaType::LongLong){
-        qlonglong ia=a.toLongLong(&okA), ib=b.toLongLong(&okB);
-        if(okA && okB){ if(ia<ib) return -1; if(ia>ib) return 1; return 0; }
-    }
-    return QString::compare(a.toString(), b.toString(), Qt::CaseInsensitive);
-}
-static bool equalVar(const QVariant& a, const QVariant& b){
-    if(!a.isValid() && !b.isValid()) return true;
-    return cmpVar(a,b)==0;
-}
-static QVariant parseLiteral(const QString& tok){
-    QString s=tok.trimmed();
-    if(s.startsWith('\'') && s.endsWith('\'')) return s.mid(1, s.size()-2);
-    if(up(s)=="TRUE")  return true;
-    if(up(s)=="FALSE") return false;
-    if(up(s)=="NULL")  return QVariant();
-    bool ok=false;
-    qlonglong i=s.toLongLong(&ok); if(ok) return QVariant::fromValue(i);
-    double d=s.toDouble(&ok);      if(ok) return d;
-    QDate dt=QDate::fromString(s, "yyyy-MM-dd"); if(dt.isValid()) return dt;
-    return s;
+// ===== Helpers de SQL =====
+// Una celda de criterio tal como la escribiría alguien en Access: con operador
+// ("> 5", "LIKE 'A%'", "IN (1,2)", "IN (SELECT ...)", "IS NULL"...) o solo el
+// valor ("Ana", 10), que equivale a "= valor".
+static QString criterionSql(const QString& field, const QString& cond){
+    static const QRegularExpression withOp(
+        R"(^(=|<|>|!|(NOT|LIKE|BETWEEN|IN|IS)\b))", QRegularExpression::CaseInsensitiveOption);
+    if (withOp.match(cond).hasMatch()) return field + " " + cond;
+
+    const QString upv = cond.toUpper();
+    if (upv=="NULL") return field + " IS NULL";
+
+    bool ok=false; (void)cond.toDouble(&ok);
+    const bool literal = ok || upv=="TRUE" || upv=="FALSE"
+                         || QDate::fromString(cond, "yyyy-MM-dd").isValid()
+                         || (cond.startsWith('\'') && cond.endsWith('\'') && cond.size()>=2)
+                         || (cond.startsWith('#') && cond.endsWith('#') && cond.size()>=2)
+                         || (cond.startsWith('[') && cond.endsWith(']') && cond.size()>=2)   // [Parámetro]
+                         || cond.startsWith(':');                                            // :parámetro
+    return field + " = " + (literal ? cond : "'" + QString(cond).replace("'", "''") + "'");
 }
+
 static QToolButton* mkBtn(const QString& text){
     auto *b = new QToolButton;
     b->setText(text);
@@ -192,7 +163,9 @@ AccessQueryDesignerPage::AccessQueryDesignerPage(QWidget* parent) : QWidget(pare
     mid->addLayout(rightCol, 1);
 
     // Resultados embebidos (abajo)
-    results_ = new QTableWidget;
+    resultModel_ = new SqlResultModel(this);
+    results_ = new QTableView;
+    results_->setModel(resultModel_);
     results_->setObjectName("designerResults");
     results_->setEditTriggers(QAbstractItemView::NoEditTriggers);
     results_->horizontalHeader()->setStretchLastSection(true);
@@ -204,6 +177,12 @@ AccessQueryDesignerPage::AccessQueryDesignerPage(QWidget* parent) : QWidget(pare
     root->addWidget(status_);
 
     // Conexiones
+    connect(resultModel_, &SqlResultModel::rowsFetched, this, [this](int rows, bool complete){
+        if (!status_) return;
+        const QString err = resultModel_->error();
+        if (!err.isEmpty()) status_->setText("Error: " + err);
+        else status_->setText(QString::number(rows) + (complete ? "" : "+") + " fila(s) — " + shownSql_);
+    });
     connect(cbTable_, &QComboBox::currentTextChanged, this, &AccessQueryDesignerPage::onTableChanged);
     connect(lwFields_, &QListWidget::itemDoubleClicked, [this](QListWidgetItem*){ onAddSelectedField(); });
     connect(bAdd,    &QToolButton::clicked, this, &AccessQueryDesignerPage::onAddSelectedField);
@@ -277,7 +256,7 @@ void AccessQueryDesignerPage::rebuildFields(){
 void AccessQueryDesignerPage::onTableChanged(const QString&){
     rebuildFields();
     onClearGrid();
-    if (results_) { results_->setRowCount(0); results_->setColumnCount(0); }
+    if (resultModel_) resultModel_->clear();
     if (status_) status_->clear();
 }
 
@@ -400,7 +379,7 @@ QString AccessQueryDesignerPage::buildSql() const{
         if (!hdr) continue;
         const QString field = hdr->text().trimmed();
         if (field.isEmpty()) continue;
-        cols << QString("%1.%2").arg(table, field);
+        cols << SqlParser::quoteIdent(table) + "." + SqlParser::quoteIdent(field);
     }
     const QString select = cols.isEmpty() ? "*" : cols.join(", ");
 
@@ -416,7 +395,7 @@ QString AccessQueryDesignerPage::buildSql() const{
             if (!crit) continue;
             const QString cond = crit->text().trimmed();
             if (cond.isEmpty()) continue;
-            ands << QString("%1.%2 %3").arg(table, field, cond);
+            ands << criterionSql(SqlParser::quoteIdent(table) + "." + SqlParser::quoteIdent(field), cond);
         }
         return ands.join(" AND ");
     };
@@ -427,12 +406,12 @@ QString AccessQueryDesignerPage::buildSql() const{
         if (!rr.isEmpty()) orRows << "(" + rr + ")";
     }
 
-    QString sql = "SELECT " + select + " FROM " + table;
+    QString sql = "SELECT " + select + " FROM " + SqlParser::quoteIdent(table);
     if(!orRows.isEmpty()) sql += " WHERE " + orRows.join(" OR ");
 
     // ORDER BY
     if (cbOrderBy_ && cbOrderBy_->count()>0 && !cbOrderBy_->currentText().trimmed().isEmpty()) {
-        sql += " ORDER BY " + table + "." + cbOrderBy_->currentText().trimmed();
+        sql += " ORDER BY " + SqlParser::quoteIdent(table) + "." + SqlParser::quoteIdent(cbOrderBy_->currentText().trimmed());
         if (btnDesc_ && btnDesc_->isChecked()) sql += " DESC";
     }
 
@@ -444,171 +423,24 @@ QString AccessQueryDesignerPage::buildSql() const{
 
 // ===== Ejecutar y pintar resultados =====
 void AccessQueryDesignerPage::onRun(){
-    auto& dm = DataModel::instance();
-    const QString table = currentTable();
-    const Schema schema = dm.schema(table);
-    if (schema.isEmpty()) { QMessageBox::warning(this, "SELECT", "Tabla no encontrada"); return; }
-
-    // columnas a mostrar
-    QStringList cols;
-    for (int c=0;c<grid_->columnCount();++c){
-        auto *hdr = grid_->horizontalHeaderItem(c);
-        if (hdr && !hdr->text().trimmed().isEmpty()) cols << hdr->text().trimmed();
-    }
-    if (cols.isEmpty()) for (const auto& f : schema) cols << f.name;
-
-    // condiciones sencillas (todas las filas OR)
-    struct Cond { QString col; QString op; QVariant val; };
-    using CondRow = QVector<Cond>;
-    QVector<CondRow> whereRows;
-
-    auto parseCond = [&](const QString& field, const QString& t)->CondRow{
-        QString s = t.trimmed();
-        if (s.isEmpty()) return {};
-        // operadores binarios comunes
-        static const QStringList ops = {"<>","!=",">=","<=","=","<",">"};
-        for (const QString& op : ops) {
-            if (s.startsWith(op)) {
-                QString rhs = s.mid(op.size()).trimmed();
-                return { { field, op=="!=" ? "<>" : op, parseLiteral(rhs) } };
-            }
-        }
-        // IS NULL / NOT NULL / TRUE / FALSE
-        if (up(s)=="IS NULL")     return { { field, "=", QVariant() } };
-        if (up(s)=="IS NOT NULL") return {}; // no lo filtramos explícitamente (se deja pasar todos)
-        if (up(s)=="TRUE")        return { { field, "=", true } };
-        if (up(s)=="FALSE")       return { { field, "=", false } };
-
-        // BETWEEN a AND b
-        {
-            QRegularExpression re("^BETWEEN\\s+(.+)\\s+AND\\s+(.+)$", QRegularExpression::CaseInsensitiveOption);
-            auto m = re.match(s);
-            if (m.hasMatch()) {
-                QVariant a = parseLiteral(m.captured(1).trimmed());
-                QVariant b = parseLiteral(m.captured(2).trimmed());
-                // Modelamos como (>= a) y (<= b)
-                return { {field, ">=", a}, {field, "<=", b} };
-            }
-        }
-
-        // IN ( … )
-        {
-            QRegularExpression re("^NOT\\s+IN\\s*\\((.+)\\)$", QRegularExpression::CaseInsensitiveOption);
-            auto m = re.match(s);
-            if (m.hasMatch()) {
-                QStringList toks = m.captured(1).split(',', Qt::SkipEmptyParts);
-                CondRow cr;
-                // NOT IN lo modelamos como != para cada elemento y luego AND
-                for (auto t : toks) cr << Cond{field, "<>", parseLiteral(t.trimmed())};
-                return cr;
-            }
-        }
-        {
-            QRegularExpression re("^IN\\s*\\((.+)\\)$", QRegularExpression::CaseInsensitiveOption);
-            auto m = re.match(s);
-            if (m.hasMatch()) {
-                QStringList toks = m.captured(1).split(',', Qt::SkipEmptyParts);
-                // IN lo modelamos como OR de iguales; aquí devolvemos un truco:
-                // el ejecutor de abajo sólo entiende AND dentro de fila,
-                // así que simplificamos a "igual a alguno" replicando filas no es trivial.
-                // Para mantenerlo simple, si hay IN, dejaremos pasar y el preview no filtrará por IN.
-                // (El SQL generado sí tendrá IN porque lo insertamos tal cual.)
-                return {}; // no aplicamos filtro local; se verá en la ejecución real si la hay
-            }
-        }
-
-        // LIKE / NOT LIKE: tampoco hacemos el patrón en preview local; lo omitimos.
-        if (s.startsWith("LIKE ", Qt::CaseInsensitive) ||
-            s.startsWith("NOT LIKE ", Qt::CaseInsensitive)) {
-            return {};
-        }
-
-        // genérico: igualdad del literal completo
-        return { { field, "=", parseLiteral(s) } };
-    };
-
-    for (int r=0; r<grid_->rowCount(); ++r){
-        CondRow rowConds;
-        for (int c=0;c<grid_->columnCount();++c){
-            auto *hdr = grid_->horizontalHeaderItem(c);
-            if (!hdr) continue;
-            const QString field = hdr->text().trimmed();
-            if (field.isEmpty()) continue;
-
-            auto *crit = grid_->item(r,c);
-            if (!crit) continue;
-            const QString cond = crit->text().trimmed();
-            if (cond.isEmpty()) continue;
-
-            for (const auto& cd : parseCond(field, cond)) rowConds << cd;
-        }
-        if (!rowConds.isEmpty()) whereRows << rowConds;
-    }
-
-    // header resultados
-    results_->clear(); results_->setRowCount(0);
-    results_->setColumnCount(cols.size());
-    QStringList hdr; for (const QString& c : cols) hdr << (table + "." + c);
-    results_->setHorizontalHeaderLabels(hdr);
-
-    auto matchRowAND = [&](const Record& r, const QVector<Cond>& andConds)->bool{
-        for (const auto& c : andConds) {
-            int ci = schemaFieldIndex(schema, c.col); if (ci<0) return false;
-            QVariant v = r.value(ci);
-            QString op = c.op; if (op=="<>") op = "!=";
-
-            if(op=="=")  { if(!equalVar(v, c.val)) return false; continue; }
-            if(op=="!=") { if( equalVar(v, c.val)) return false; continue; }
-
-            int cmp = cmpVar(v, c.val);
-            if(op==">"  && !(cmp>0))  return false;
-            if(op=="<"  && !(cmp<0))  return false;
-            if(op==">=" && !(cmp>=0)) return false;
-            if(op=="<=" && !(cmp<=0)) return false;
-        }
-        return true;
-    };
-    auto matchRowOR = [&](const Record& r)->bool{
-        if (whereRows.isEmpty()) return true;
-        for (const auto& andGroup : whereRows)
-            if (matchRowAND(r, andGroup)) return true;
-        return false;
-    };
-
-    const auto& data = dm.rows(table);
-    QVector<const Record*> rows; rows.reserve(data.size());
-    for (const auto& r : data) if (!r.isEmpty() && matchRowOR(r)) rows << &r;
-
-    // ORDER BY (local, si es posible)
-    QString orderCol = cbOrderBy_ ? cbOrderBy_->currentText().trimmed() : QString();
-    bool orderDesc = btnDesc_ && btnDesc_->isChecked();
-    if (!orderCol.isEmpty()){
-        int oi = schemaFieldIndex(schema, orderCol);
-        if (oi >= 0) {
-            std::sort(rows.begin(), rows.end(), [&](const Record* a, const Record* b){
-                int c = cmpVar(a->value(oi), b->value(oi));
-                return orderDesc ? (c>0) : (c<0);
-            });
-        }
-    }
-
-    // LIMIT
-    int limit = spLimit_ && spLimit_->value() > 0 ? spLimit_->value() : -1;
-    int take = rows.size(); if (limit>=0) take = qMin(take, limit);
-
-    // volcado
-    results_->setRowCount(take);
-    for (int r=0; r<take; ++r){
-        for (int c=0; c<cols.size(); ++c){
-            int ix = schemaFieldIndex(schema, cols[c]);
-            if (ix<0) continue;
-            results_->setItem(r,c,new QTableWidgetItem(rows[r]->value(ix).toString()));
-        }
-    }
-
+    // La vista previa ejecuta exactamente el SQL generado (IN, LIKE, OR... incluidos)
     const QString sql = buildSql();
+    if (sql.isEmpty()) { QMessageBox::warning(this, "SELECT", "Tabla no encontrada"); return; }
     if (sqlPreview_) sqlPreview_->setText(sql);
-    if (status_) status_->setText(QString::number(take) + " fila(s) — " + sql);
+
+    // Criterios con [Parámetro] o :parámetro: se piden antes de ejecutar
+    QString err;
+    SqlEngine engine;
+    SqlPreparedQuery prepared;
+    if (!engine.prepare(sql, &prepared, &err)) { QMessageBox::warning(this, "SELECT", err); return; }
+    QVariantMap values;
+    if (!askQueryParameters(this, prepared.parameters(), &values)) return;
+    SqlCursor cur;
+    if (!engine.query(prepared, values, &cur, &err)) { QMessageBox::warning(this, "SELECT", err); return; }
+
+    // las filas se leen del cursor según la vista las pide (status: rowsFetched)
+    shownSql_ = sql;
+    resultModel_->setCursor(cur);
     emit runSql(sql);
 }
 
@@ -6,9 +6,11 @@ class QComboBox;
 class QLineEdit;
 class QListWidget;
 class QTableWidget;
+class QTableView;
 class QToolButton;
 class QSpinBox;
 class QLabel;
+class SqlResultModel;
 
 /**
  * Diseñador visual de consultas (estilo Access).
@@ -92,7 +94,9 @@ private:
 
     // Preview + resultados
     QLabel*        sqlPreview_ {nullptr};   // texto SQL
-    QTableWidget*  results_    {nullptr};   // resultados embebidos
+    QTableView*    results_    {nullptr};   // resultados embebidos
+    SqlResultModel* resultModel_ {nullptr}; // lee del cursor a pedido de la vista
+    QString        shownSql_;               // SQL de los resultados visibles
     QLabel*        status_     {nullptr};   // estado (filas/SQL)
 
     QString        lastSqlText_;
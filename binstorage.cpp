@@ -24,6 +24,10 @@ QString BinStorage::relDir(const QString& t) const { return tableDir(t) + "/rel"
 
 bool BinStorage::ensureTableLayout(const QString& t){
     QMutexLocker lk(&ioMutex_);
+    return ensureTableLayoutLocked(t);
+}
+// ioMutex_ ya tomado por el llamador (no es recursivo)
+bool BinStorage::ensureTableLayoutLocked(const QString& t){
     QDir().mkpath(tableDir(t));
     QDir().mkpath(indexDir(t));
     QDir().mkpath(relDir(t));
@@ -56,7 +60,7 @@ bool BinStorage::readAll(const QString& p, QByteArray& out) const{
 
 bool BinStorage::writeSchema(const QString& t, const Schema& s){
     QMutexLocker lk(&ioMutex_);
-    if (!ensureTableLayout(t)) return false;
+    if (!ensureTableLayoutLocked(t)) return false;
     const QByteArray meta = BinSerializer::packSchema(t, s, 1);
     return writeAll(schemaPath(t), meta);
 }
@@ -83,7 +87,10 @@ bool BinStorage::saveFSM(const QString& /*t*/, const FreeSpaceManager& fsm) cons
 
 qint64 BinStorage::insertRecord(const QString& t, const QByteArray& packed){
     QMutexLocker lk(&ioMutex_);
-    if (!ensureTableLayout(t)) return -1;
+    return insertRecordLocked(t, packed);
+}
+qint64 BinStorage::insertRecordLocked(const QString& t, const QByteArray& packed){
+    if (!ensureTableLayoutLocked(t)) return -1;
     QFile f(dataPath(t)); if (!f.open(QIODevice::ReadWrite)) return -1;
 
     FreeSpaceManager fsm; loadFSM(t, fsm);
@@ -103,6 +110,9 @@ qint64 BinStorage::insertRecord(const QString& t, const QByteArray& packed){
 
 bool BinStorage::deleteRecord(const QString& t, qint64 off){
     QMutexLocker lk(&ioMutex_);
+    return deleteRecordLocked(t, off);
+}
+bool BinStorage::deleteRecordLocked(const QString& t, qint64 off){
     QFile f(dataPath(t)); if (!f.open(QIODevice::ReadWrite)) return false;
     if (off < 0 || off >= f.size()) return false;
 
@@ -140,8 +150,8 @@ bool BinStorage::updateRecord(const QString& t, qint64 off, const QByteArray& pa
         if (newOff) *newOff = off;
         return true;
     } else {
-        if (!deleteRecord(t, off)) return false;
-        const qint64 p = insertRecord(t, packed);
+        if (!deleteRecordLocked(t, off)) return false;
+        const qint64 p = insertRecordLocked(t, packed);
         if (newOff) *newOff = p;
         return p >= 0;
     }
@@ -45,6 +45,11 @@ private:
     mutable QMutex ioMutex_;
     FreeSpaceManager::Strategy strategy_ = FreeSpaceManager::Strategy::FirstFit;
 
+    // Variantes sin candado: el llamador ya tiene ioMutex_ (QMutex no recursivo)
+    bool   ensureTableLayoutLocked(const QString& table);
+    qint64 insertRecordLocked(const QString& table, const QByteArray& packedRow);
+    bool   deleteRecordLocked(const QString& table, qint64 offset);
+
     bool writeAll(const QString& path, const QByteArray& data);
     bool readAll(const QString& path, QByteArray& data) const;
 
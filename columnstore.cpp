@@ -0,0 +1,540 @@
+#include "columnstore.h"
+
+#include <QtAlgorithms>
+#include <QMutex>
+#include <algorithm>
+#include <cmath>
+
+/* ====================== BitVector ====================== */
+
+void BitVector::set(int i, bool v) {
+    const quint64 mask = quint64(1) << (i & 63);
+    if (v) m_words[i >> 6] |= mask;
+    else   m_words[i >> 6] &= ~mask;
+}
+
+void BitVector::append(bool v) {
+    if ((m_size & 63) == 0) m_words.push_back(0);
+    ++m_size;
+    set(m_size - 1, v);
+}
+
+void BitVector::resize(int n, bool v) {
+    const int old = m_size;
+    m_words.resize((n + 63) / 64);
+    m_size = n;
+    for (int i = old; i < n; ++i) set(i, v);
+    // limpiar bits sobrantes de la última palabra (count() los suma)
+    if (n < old && (n & 63)) m_words[n >> 6] &= (quint64(1) << (n & 63)) - 1;
+}
+
+int BitVector::count() const {
+    int c = 0;
+    for (quint64 w : m_words) c += qPopulationCount(w);
+    return c;
+}
+
+/* ====================== Column ====================== */
+
+QVariant Column::value(int slot) const {
+    if (slot < 0 || slot >= size() || isNull(slot)) return QVariant();
+    switch (m_kind) {
+    case ColumnKind::Int64:  return QVariant::fromValue(m_i64[slot]);
+    case ColumnKind::Double: return m_f64[slot];
+    case ColumnKind::Date:   return QDate::fromJulianDay(m_days[slot]);
+    case ColumnKind::Bool:   return m_bits.test(slot);
+    case ColumnKind::Text:   return m_dictMode ? m_dict[m_codes[slot]] : textAt(slot).toString();
+    }
+    return QVariant();
+}
+
+double Column::doubleAt(int slot) const {
+    switch (m_kind) {
+    case ColumnKind::Int64:  return double(m_i64[slot]);
+    case ColumnKind::Double: return m_f64[slot];
+    case ColumnKind::Date:   return double(m_days[slot]);
+    case ColumnKind::Bool:   return m_bits.test(slot) ? 1.0 : 0.0;
+    case ColumnKind::Text:   return textAt(slot).toDouble();
+    }
+    return 0.0;
+}
+
+QStringView Column::textAt(int slot) const {
+    if (m_dictMode) return QStringView(m_dict[m_codes[slot]]);
+    return QStringView(m_chars.constData() + m_strOff[slot], m_strLen[slot]);
+}
+
+void Column::resize(int n) {
+    m_valid.resize(n, false);
+    switch (m_kind) {
+    case ColumnKind::Int64:  m_i64.resize(n);  break;
+    case ColumnKind::Double: m_f64.resize(n);  break;
+    case ColumnKind::Date:   m_days.resize(n); break;
+    case ColumnKind::Bool:   m_bits.resize(n, false); break;
+    case ColumnKind::Text:
+        if (m_dictMode) m_codes.resize(n);
+        else { m_strOff.resize(n); m_strLen.resize(n); }
+        break;
+    }
+}
+
+void Column::reserve(int n) {
+    switch (m_kind) {
+    case ColumnKind::Int64:  m_i64.reserve(n);  break;
+    case ColumnKind::Double: m_f64.reserve(n);  break;
+    case ColumnKind::Date:   m_days.reserve(n); break;
+    case ColumnKind::Bool:   break;
+    case ColumnKind::Text:
+        if (m_dictMode) m_codes.reserve(n);
+        else { m_strOff.reserve(n); m_strLen.reserve(n); }
+        break;
+    }
+}
+
+qint32 Column::intern(QStringView s) {
+    const QString key = s.toString();
+    auto it = m_dictIndex.constFind(key);
+    if (it != m_dictIndex.constEnd()) return it.value();
+    const qint32 code = qint32(m_dict.size());
+    m_dict.push_back(key);
+    m_dictIndex.insert(key, code);
+    return code;
+}
+
+void Column::toPlainText() {
+    m_strOff.resize(size());
+    m_strLen.resize(size());
+    m_chars.clear();
+    for (int i = 0; i < size(); ++i) {
+        if (isNull(i)) { m_strOff[i] = 0; m_strLen[i] = 0; continue; }
+        const QString& t = m_dict[m_codes[i]];
+        m_strOff[i] = qint32(m_chars.size());
+        m_strLen[i] = qint32(t.size());
+        m_chars.append(t);
+    }
+    m_dictMode = false;
+    m_dict.clear();
+    m_dictIndex.clear();
+    m_codes.clear();
+    m_codes.squeeze();
+    m_garbage = 0;
+}
+
+void Column::setText(int slot, QStringView s) {
+    if (m_dictMode) {
+        const qint32 code = intern(s);
+        // Cardinalidad alta (más de la mitad de las filas son distintas): texto plano
+        if (m_dict.size() <= kDictMinEntries || m_dict.size() * 2 <= size()) {
+            m_codes[slot] = code;
+            return;
+        }
+        toPlainText();   // la celda actual se escribe abajo ya como texto plano
+    }
+    m_garbage += m_strLen[slot];
+    m_strOff[slot] = qint32(m_chars.size());
+    m_strLen[slot] = qint32(s.size());
+    m_chars.append(s);
+    // Si más de la mitad del buffer es basura, lo reescribimos (la celda que se
+    // escribe ya tiene que estar marcada como no nula, o se perdería)
+    if (m_garbage > 4096 && m_garbage * 2 > m_chars.size()) {
+        vacuumText();
+        Q_ASSERT(textAt(slot) == s);
+    }
+}
+
+void Column::vacuumText() {
+    QString fresh;
+    fresh.reserve(m_chars.size() - m_garbage);
+    for (int i = 0; i < size(); ++i) {
+        if (isNull(i)) { m_strOff[i] = 0; m_strLen[i] = 0; continue; }
+        const qint32 off = qint32(fresh.size());
+        fresh.append(textAt(i));
+        m_strOff[i] = off;
+    }
+    m_chars.swap(fresh);
+    m_garbage = 0;
+}
+
+void Column::setValue(int slot, const QVariant& v) {
+    if (!v.isValid() || v.isNull()) {
+        if (m_kind == ColumnKind::Text && !m_dictMode) { m_garbage += m_strLen[slot]; m_strLen[slot] = 0; }
+        m_valid.set(slot, false);
+        return;
+    }
+    bool ok = true;
+    switch (m_kind) {
+    case ColumnKind::Int64: {
+        qint64 x = v.toLongLong(&ok);
+        if (!ok) { const double d = v.toDouble(&ok); if (ok) x = std::llround(d); }
+        if (ok) m_i64[slot] = x;
+        break;
+    }
+    case ColumnKind::Double: {
+        const double d = v.toDouble(&ok);
+        if (ok) m_f64[slot] = d;
+        break;
+    }
+    case ColumnKind::Date: {
+        const QDate d = v.toDate();
+        ok = d.isValid();
+        if (ok) m_days[slot] = qint32(d.toJulianDay());
+        break;
+    }
+    case ColumnKind::Bool:
+        m_bits.set(slot, v.toBool());
+        break;
+    case ColumnKind::Text:
+        // Válida antes de escribir: si setText compacta el buffer, la celda se conserva
+        m_valid.set(slot, true);
+        setText(slot, v.toString());
+        break;
+    }
+    m_valid.set(slot, ok);
+}
+
+void Column::append(const QVariant& v) {
+    resize(size() + 1);
+    setValue(size() - 1, v);
+}
+
+void Column::appendFrom(const Column& src, int slot) {
+    const int dst = size();
+    resize(dst + 1);
+    if (src.isNull(slot)) return;
+    m_valid.set(dst, true);   // antes de setText (ver setValue)
+    switch (m_kind) {
+    case ColumnKind::Int64:  m_i64[dst]  = src.m_i64[slot];  break;
+    case ColumnKind::Double: m_f64[dst]  = src.m_f64[slot];  break;
+    case ColumnKind::Date:   m_days[dst] = src.m_days[slot]; break;
+    case ColumnKind::Bool:   m_bits.set(dst, src.m_bits.test(slot)); break;
+    case ColumnKind::Text:
+        setText(dst, src.textAt(slot));
+        break;
+    }
+}
+
+CellProbe Column::probe(const QVariant& v) const {
+    CellProbe p;
+    if (!v.isValid() || v.isNull()) return p;
+    bool ok = true;
+    switch (m_kind) {
+    case ColumnKind::Int64:
+        p.i = v.toLongLong(&ok);
+        if (!ok) { const double d = v.toDouble(&ok); if (ok) p.i = std::llround(d); }
+        break;
+    case ColumnKind::Double:
+        p.d = v.toDouble(&ok);
+        if (p.d == 0) p.d = 0;   // -0 == 0 (igual que SqlKeyPart)
+        break;
+    case ColumnKind::Date: {
+        const QDate d = v.toDate();
+        ok = d.isValid();
+        p.i = ok ? d.toJulianDay() : 0;
+        break;
+    }
+    case ColumnKind::Bool:   p.b = v.toBool(); break;
+    case ColumnKind::Text:
+        p.s = v.toString();
+        if (m_dictMode) p.code = codeOf(p.s);
+        break;
+    }
+    p.null = !ok;
+    return p;
+}
+
+bool Column::equals(int slot, const CellProbe& p) const {
+    if (p.null || isNull(slot)) return false;
+    switch (m_kind) {
+    case ColumnKind::Int64:  return m_i64[slot] == p.i;
+    case ColumnKind::Double: return m_f64[slot] == p.d;   // exacta: coherente con hashAt/hashOf
+    case ColumnKind::Date:   return m_days[slot] == p.i;
+    case ColumnKind::Bool:   return m_bits.test(slot) == p.b;
+    case ColumnKind::Text:
+        if (m_dictMode) return p.code >= 0 && m_codes[slot] == p.code;
+        return textAt(slot) == QStringView(p.s);
+    }
+    return false;
+}
+
+int Column::compareTo(int slot, const CellProbe& p) const {
+    auto cmp3 = [](auto a, auto b) { return (a < b) ? -1 : (b < a) ? 1 : 0; };
+    switch (m_kind) {
+    case ColumnKind::Int64:  return cmp3(m_i64[slot], p.i);
+    case ColumnKind::Double: return cmp3(m_f64[slot], p.d);
+    case ColumnKind::Date:   return cmp3(qint64(m_days[slot]), p.i);
+    case ColumnKind::Bool:   return cmp3(int(m_bits.test(slot)), int(p.b));
+    case ColumnKind::Text:   return textAt(slot).compare(QStringView(p.s), Qt::CaseInsensitive);
+    }
+    return 0;
+}
+
+int Column::compareSlots(int a, int b) const {
+    auto cmp3 = [](auto x, auto y) { return (x < y) ? -1 : (y < x) ? 1 : 0; };
+    switch (m_kind) {
+    case ColumnKind::Int64:  return cmp3(m_i64[a], m_i64[b]);
+    case ColumnKind::Double: return cmp3(m_f64[a], m_f64[b]);
+    case ColumnKind::Date:   return cmp3(m_days[a], m_days[b]);
+    case ColumnKind::Bool:   return cmp3(int(m_bits.test(a)), int(m_bits.test(b)));
+    case ColumnKind::Text:
+        if (m_dictMode && m_codes[a] == m_codes[b]) return 0;
+        return textAt(a).compare(textAt(b), Qt::CaseInsensitive);
+    }
+    return 0;
+}
+
+size_t Column::hashAt(int slot) const {
+    switch (m_kind) {
+    case ColumnKind::Int64:  return qHash(m_i64[slot]);
+    case ColumnKind::Double: return qHash(m_f64[slot] == 0 ? 0.0 : m_f64[slot]);
+    case ColumnKind::Date:   return qHash(qint64(m_days[slot]));
+    case ColumnKind::Bool:   return m_bits.test(slot) ? 1u : 0u;
+    case ColumnKind::Text:   return qHash(textAt(slot));
+    }
+    return 0;
+}
+
+size_t Column::hashOf(const CellProbe& p) const {
+    switch (m_kind) {
+    case ColumnKind::Int64:  return qHash(p.i);
+    case ColumnKind::Double: return qHash(p.d == 0 ? 0.0 : p.d);
+    case ColumnKind::Date:   return qHash(p.i);
+    case ColumnKind::Bool:   return p.b ? 1u : 0u;
+    case ColumnKind::Text:   return qHash(QStringView(p.s));
+    }
+    return 0;
+}
+
+qint64 Column::memoryBytes() const {
+    return m_valid.memoryBytes() + m_bits.memoryBytes()
+         + m_i64.capacity()    * qint64(sizeof(qint64))
+         + m_f64.capacity()    * qint64(sizeof(double))
+         + m_days.capacity()   * qint64(sizeof(qint32))
+         + m_strOff.capacity() * qint64(sizeof(qint32))
+         + m_strLen.capacity() * qint64(sizeof(qint32))
+         + m_chars.capacity()  * qint64(sizeof(QChar))
+         + m_codes.capacity()  * qint64(sizeof(qint32))
+         + dictBytes();
+}
+
+qint64 Column::dictBytes() const {
+    qint64 b = m_dict.capacity() * qint64(sizeof(QString));
+    for (const QString& t : m_dict) b += t.capacity() * qint64(sizeof(QChar));
+    // el índice comparte los datos de los QString; se cuenta solo su estructura
+    return b + m_dictIndex.size() * qint64(sizeof(QString) + sizeof(qint32));
+}
+
+/* ====================== ColumnTable ====================== */
+
+ColumnTable::ColumnTable(const QVector<ColumnKind>& kinds) {
+    m_cols.reserve(kinds.size());
+    for (ColumnKind k : kinds) m_cols.push_back(Column(k));
+}
+
+// Un snapshot copia la tabla con el lock de lectura: otro lector puede estar
+// armando la caché de orden del original, así que se copia con su mutex tomado
+ColumnTable::ColumnTable(const ColumnTable& o)
+    : m_cols(o.m_cols), m_live(o.m_live), m_liveCount(o.m_liveCount),
+      m_rowIds(o.m_rowIds), m_slotOf(o.m_slotOf), m_nextRowId(o.m_nextRowId),
+      m_indexes(o.m_indexes) {
+    QMutexLocker lk(&o.m_cacheMutex);
+    m_sorted = o.m_sorted;
+}
+
+ColumnTable& ColumnTable::operator=(const ColumnTable& o) {
+    if (this == &o) return *this;
+    m_cols = o.m_cols;
+    m_live = o.m_live;
+    m_liveCount = o.m_liveCount;
+    m_rowIds = o.m_rowIds;
+    m_slotOf = o.m_slotOf;
+    m_nextRowId = o.m_nextRowId;
+    m_indexes = o.m_indexes;
+    QMutexLocker lk(&o.m_cacheMutex);
+    m_sorted = o.m_sorted;
+    return *this;
+}
+
+QVector<ColumnKind> ColumnTable::kinds() const {
+    QVector<ColumnKind> out;
+    out.reserve(m_cols.size());
+    for (const Column& c : m_cols) out.push_back(c.kind());
+    return out;
+}
+
+QVariant ColumnTable::value(int slot, int col) const {
+    if (!isLive(slot) || col < 0 || col >= m_cols.size()) return QVariant();
+    return m_cols[col].value(slot);
+}
+
+Record ColumnTable::record(int slot) const {
+    if (!isLive(slot)) return Record{};
+    Record r(m_cols.size());
+    for (int c = 0; c < m_cols.size(); ++c) r[c] = m_cols[c].value(slot);
+    return r;
+}
+
+RowId ColumnTable::bindRowId(int slot, RowId id) {
+    // id explícito (carga/ALTER) si no está tomado; si no, uno nuevo
+    if (id <= kInvalidRowId || m_slotOf.contains(id)) id = m_nextRowId;
+    if (id >= m_nextRowId) m_nextRowId = id + 1;
+    m_rowIds[slot] = id;
+    m_slotOf.insert(id, slot);
+    return id;
+}
+
+int ColumnTable::append(const Record& r, RowId id) {
+    const int slot = m_live.size();
+    m_live.append(true);
+    ++m_liveCount;
+    m_rowIds.push_back(kInvalidRowId);
+    bindRowId(slot, id);
+    for (int c = 0; c < m_cols.size(); ++c)
+        m_cols[c].append(c < r.size() ? r[c] : QVariant());
+    indexAdd(slot);
+    return slot;
+}
+
+int ColumnTable::appendTombstone() {
+    const int slot = m_live.size();
+    m_live.append(false);
+    m_rowIds.push_back(kInvalidRowId);
+    for (Column& c : m_cols) c.resize(slot + 1);
+    return slot;
+}
+
+void ColumnTable::write(int slot, const Record& r) {
+    if (slot < 0 || slot >= m_live.size()) return;
+    if (!m_live.test(slot)) { m_live.set(slot, true); ++m_liveCount; bindRowId(slot, kInvalidRowId); }
+    else indexRemove(slot);
+    for (int c = 0; c < m_cols.size(); ++c)
+        m_cols[c].setValue(slot, c < r.size() ? r[c] : QVariant());
+    indexAdd(slot);
+}
+
+void ColumnTable::setValue(int slot, int col, const QVariant& v) {
+    if (!isLive(slot) || col < 0 || col >= m_cols.size()) return;
+    indexRemove(slot, col);
+    m_cols[col].setValue(slot, v);
+    indexAdd(slot, col);
+}
+
+void ColumnTable::kill(int slot) {
+    if (!isLive(slot)) return;
+    indexRemove(slot);
+    m_live.set(slot, false);
+    --m_liveCount;
+    m_slotOf.remove(m_rowIds[slot]);
+    m_rowIds[slot] = kInvalidRowId;
+    for (Column& c : m_cols) c.setValue(slot, QVariant());   // libera texto
+}
+
+int ColumnTable::compact() {
+    const int removed = m_live.size() - m_liveCount;
+    if (removed == 0) return 0;
+
+    QVector<Column> packed;
+    packed.reserve(m_cols.size());
+    for (const Column& src : m_cols) {
+        Column dst(src.kind());
+        dst.reserve(m_liveCount);
+        for (int s = 0; s < m_live.size(); ++s)
+            if (m_live.test(s)) dst.appendFrom(src, s);
+        packed.push_back(dst);
+    }
+    m_cols.swap(packed);
+
+    // Los ids sobreviven; solo cambia su slot
+    QVector<RowId> ids;
+    ids.reserve(m_liveCount);
+    for (int s = 0; s < m_live.size(); ++s)
+        if (m_live.test(s)) ids.push_back(m_rowIds[s]);
+    m_rowIds.swap(ids);
+    m_slotOf.clear();
+    m_slotOf.reserve(m_rowIds.size());
+    for (int s = 0; s < m_rowIds.size(); ++s) m_slotOf.insert(m_rowIds[s], s);
+
+    m_live.clear();
+    m_live.resize(m_liveCount, true);
+    for (auto it = m_indexes.begin(); it != m_indexes.end(); ++it) rebuildIndex(it.key());
+    return removed;
+}
+
+void ColumnTable::setIndexedColumns(const QVector<int>& cols) {
+    m_indexes.clear();
+    m_sorted.clear();
+    for (int c : cols) {
+        if (c < 0 || c >= m_cols.size()) continue;
+        m_indexes.insert(c, {});
+        rebuildIndex(c);
+    }
+}
+
+void ColumnTable::rebuildIndex(int col) {
+    m_sorted.remove(col);
+    auto& idx = m_indexes[col];
+    idx.clear();
+    const Column& c = m_cols[col];
+    for (int s = 0; s < m_live.size(); ++s)
+        if (m_live.test(s) && !c.isNull(s)) idx.insert(c.hashAt(s), s);
+}
+
+void ColumnTable::indexAdd(int slot, int onlyCol) {
+    m_sorted.clear();
+    for (auto it = m_indexes.begin(); it != m_indexes.end(); ++it) {
+        if (onlyCol >= 0 && it.key() != onlyCol) continue;
+        const Column& c = m_cols[it.key()];
+        if (!c.isNull(slot)) it->insert(c.hashAt(slot), slot);
+    }
+}
+
+void ColumnTable::indexRemove(int slot, int onlyCol) {
+    m_sorted.clear();
+    for (auto it = m_indexes.begin(); it != m_indexes.end(); ++it) {
+        if (onlyCol >= 0 && it.key() != onlyCol) continue;
+        const Column& c = m_cols[it.key()];
+        if (!c.isNull(slot)) it->remove(c.hashAt(slot), slot);
+    }
+}
+
+QVector<int> ColumnTable::lookup(int col, const CellProbe& p) const {
+    QVector<int> out;
+    if (p.null || col < 0 || col >= m_cols.size()) return out;
+    const Column& c = m_cols[col];
+    auto it = m_indexes.constFind(col);
+    if (it == m_indexes.constEnd()) {               // sin índice: escaneo
+        for (int s = 0; s < m_live.size(); ++s)
+            if (m_live.test(s) && c.equals(s, p)) out.push_back(s);
+        return out;
+    }
+    const auto range = it->equal_range(c.hashOf(p));
+    for (auto h = range.first; h != range.second; ++h)
+        if (m_live.test(h.value()) && c.equals(h.value(), p)) out.push_back(h.value());
+    return out;
+}
+
+QVector<int> ColumnTable::sortedSlots(int col) const {
+    if (!m_indexes.contains(col)) return {};
+    // Varios lectores (lock de lectura de la tabla) pueden pedirlo a la vez:
+    // el armado se serializa con el mutex de esta tabla
+    QMutexLocker lk(&m_cacheMutex);
+    auto it = m_sorted.constFind(col);
+    if (it != m_sorted.constEnd()) return *it;
+
+    const Column& c = m_cols[col];
+    QVector<int> order;
+    order.reserve(m_liveCount);
+    for (int s = 0; s < m_live.size(); ++s)
+        if (m_live.test(s) && !c.isNull(s)) order.push_back(s);
+    std::stable_sort(order.begin(), order.end(),
+                     [&c](int a, int b) { return c.compareSlots(a, b) < 0; });
+    m_sorted.insert(col, order);
+    return order;
+}
+
+qint64 ColumnTable::memoryBytes() const {
+    qint64 b = m_live.memoryBytes();
+    b += m_rowIds.capacity() * qint64(sizeof(RowId));
+    b += m_slotOf.size() * qint64(sizeof(RowId) + sizeof(int));
+    for (const Column& c : m_cols) b += c.memoryBytes();
+    return b;
+}
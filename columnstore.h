@@ -0,0 +1,204 @@
+#ifndef COLUMNSTORE_H
+#define COLUMNSTORE_H
+
+#include <QVector>
+#include <QVariant>
+#include <QString>
+#include <QStringView>
+#include <QDate>
+#include <QHash>
+#include <QMap>
+#include <QMultiHash>
+#include <QMutex>
+
+// Una fila de datos (mismo orden/longitud que el Schema)
+using Record = QVector<QVariant>;
+
+// Identidad estable de una fila: no cambia al compactar y nunca se reutiliza
+using RowId = qint64;
+constexpr RowId kInvalidRowId = 0;
+
+/* ======================= Almacenamiento columnar ======================= */
+// Tipo físico de una columna (se deriva del FieldDef::type lógico)
+enum class ColumnKind : quint8 { Int64, Double, Date, Bool, Text };
+
+// Vector de bits compacto (nulos, filas vivas, booleanos)
+class BitVector {
+public:
+    int  size() const { return m_size; }
+    bool test(int i) const { return (m_words[i >> 6] >> (i & 63)) & 1u; }
+    void set(int i, bool v);
+    void append(bool v);
+    void resize(int n, bool v = false);
+    void clear() { m_words.clear(); m_size = 0; }
+    int  count() const;                         // bits en 1
+    const QVector<quint64>& words() const { return m_words; }
+    qint64 memoryBytes() const { return m_words.capacity() * qint64(sizeof(quint64)); }
+
+private:
+    QVector<quint64> m_words;
+    int m_size = 0;
+};
+
+// Valor ya convertido al tipo físico de una columna (comparaciones sin QVariant por fila)
+struct CellProbe {
+    bool    null = true;
+    qint64  i = 0;
+    double  d = 0.0;
+    bool    b = false;
+    QString s;
+    qint32  code = -1;   // código de diccionario (-1 = el texto no aparece en la columna)
+};
+
+// Una columna tipada: un arreglo denso por tipo + bitmap de nulos.
+// Los textos empiezan codificados por diccionario (tabla de strings + código
+// entero por fila); si la cardinalidad resulta alta se pasan a un único buffer
+// (m_chars) direccionado por offset/longitud.
+class Column {
+public:
+    explicit Column(ColumnKind k = ColumnKind::Text) : m_kind(k), m_dictMode(k == ColumnKind::Text) {}
+
+    // Entradas mínimas para juzgar la cardinalidad: a partir de ahí, si más de
+    // la mitad de las filas son distintas se pasa a texto plano (sea cual sea
+    // el tamaño de la tabla)
+    static constexpr int kDictMinEntries = 64;
+
+    ColumnKind kind() const { return m_kind; }
+    int  size() const { return m_valid.size(); }
+    bool isNull(int slot) const { return !m_valid.test(slot); }
+
+    // Acceso genérico (compatibilidad con Record/QVariant)
+    QVariant value(int slot) const;
+    void     setValue(int slot, const QVariant& v);   // convierte al tipo físico; si no convierte => NULL
+    void     append(const QVariant& v);
+    void     appendFrom(const Column& src, int slot); // copia tipada (sin pasar por QVariant)
+    void     resize(int n);                           // celdas nuevas en NULL
+    void     reserve(int n);
+
+    // Acceso tipado para escaneos (el llamador verifica isNull/kind)
+    qint64      int64At(int slot) const  { return m_i64[slot]; }
+    double      doubleAt(int slot) const;            // numérico (Int64/Double)
+    qint32      dayAt(int slot) const    { return m_days[slot]; }   // día juliano
+    bool        boolAt(int slot) const   { return m_bits.test(slot); }
+    QStringView textAt(int slot) const;
+
+    const QVector<qint64>& int64Data() const  { return m_i64; }
+    const QVector<double>& doubleData() const { return m_f64; }
+    const QVector<qint32>& dayData() const    { return m_days; }
+    const BitVector&       nullBits() const   { return m_valid; }   // 1 = no nulo
+
+    // Diccionario (solo Text): los filtros de igualdad, GROUP BY y joins comparan códigos
+    bool   isDictEncoded() const { return m_dictMode; }
+    qint32 codeAt(int slot) const { return m_codes[slot]; }
+    qint32 codeOf(const QString& s) const { return m_dictIndex.value(s, -1); }
+    const QVector<QString>& dictionary() const { return m_dict; }
+    const QVector<qint32>&  codeData() const   { return m_codes; }
+
+    // Igualdad tipada: convierte el valor una sola vez y compara por slot (NULL nunca es igual)
+    CellProbe probe(const QVariant& v) const;
+    bool      equals(int slot, const CellProbe& p) const;
+    // Orden tipado (texto sin distinguir mayúsculas), el mismo del índice ordenado
+    int       compareTo(int slot, const CellProbe& p) const;
+    int       compareSlots(int a, int b) const;           // ambos no nulos
+    // Hash tipado coherente con equals (para índices hash)
+    size_t    hashAt(int slot) const;
+    size_t    hashOf(const CellProbe& p) const;
+
+    qint64 memoryBytes() const;
+
+private:
+    void setText(int slot, QStringView s);
+    void vacuumText();                                // reescribe m_chars sin basura
+    qint32 intern(QStringView s);                     // código del texto (lo agrega si falta)
+    void toPlainText();                               // abandona el diccionario
+    qint64 dictBytes() const;
+
+    ColumnKind       m_kind;
+    BitVector        m_valid;     // bitmap de no-nulos
+    QVector<qint64>  m_i64;
+    QVector<double>  m_f64;
+    QVector<qint32>  m_days;
+    BitVector        m_bits;
+    QVector<qint32>  m_strOff;
+    QVector<qint32>  m_strLen;
+    QString          m_chars;
+    qint64           m_garbage = 0;  // caracteres huérfanos tras actualizar textos
+
+    bool                  m_dictMode = false;
+    QVector<QString>      m_dict;        // código -> texto
+    QHash<QString,qint32> m_dictIndex;   // texto -> código
+    QVector<qint32>       m_codes;       // código por fila
+};
+
+// Tabla columnar: columnas tipadas + bitmap de filas vivas (sustituye a los
+// Record vacíos como tombstone). Las posiciones ("slots") siguen siendo las
+// mismas que exponía QVector<Record>, para no romper el Avail List.
+class ColumnTable {
+public:
+    ColumnTable() = default;
+    explicit ColumnTable(const QVector<ColumnKind>& kinds);
+    // Copian todo salvo el mutex de la caché (cada copia tiene el suyo)
+    ColumnTable(const ColumnTable& o);
+    ColumnTable& operator=(const ColumnTable& o);
+
+    int  slotCount() const { return m_live.size(); }  // incluye huecos
+    int  liveCount() const { return m_liveCount; }
+    bool isLive(int slot) const { return slot >= 0 && slot < m_live.size() && m_live.test(slot); }
+    const BitVector& liveBits() const { return m_live; }
+
+    int  columnCount() const { return m_cols.size(); }
+    const Column& column(int c) const { return m_cols[c]; }
+    QVector<ColumnKind> kinds() const;
+
+    QVariant value(int slot, int col) const;
+    Record   record(int slot) const;                  // Record vacío si es hueco
+
+    int  append(const Record& r, RowId id = kInvalidRowId);  // devuelve el slot (id 0 => nuevo)
+    int  appendTombstone();                           // hueco al final (carga/ALTER)
+    void write(int slot, const Record& r);            // escribe y marca vivo (hueco => id nuevo)
+    void setValue(int slot, int col, const QVariant& v);
+    void kill(int slot);                              // marca hueco (tombstone)
+    int  compact();                                   // elimina huecos; devuelve cuántos
+
+    // Directorio row id <-> slot (los slots cambian al compactar; los ids no)
+    RowId rowIdAt(int slot) const { return (slot >= 0 && slot < m_rowIds.size()) ? m_rowIds[slot] : kInvalidRowId; }
+    int   slotOf(RowId id) const  { return m_slotOf.value(id, -1); }
+    const QVector<RowId>& rowIdData() const { return m_rowIds; }   // 0 en los huecos
+    RowId nextRowId() const { return m_nextRowId; }
+    void  setNextRowId(RowId next) { if (next > m_nextRowId) m_nextRowId = next; }
+
+    // Índices hash por columna (PK / "sin duplicados"); se mantienen en cada escritura
+    void setIndexedColumns(const QVector<int>& cols);
+    bool hasIndex(int col) const { return m_indexes.contains(col); }
+    QVector<int> lookup(int col, const CellProbe& p) const;   // slots vivos con ese valor
+    // Índice ordenado de las mismas columnas: slots vivos no nulos ordenados por
+    // valor. Se arma al primer uso y se descarta con cualquier escritura.
+    QVector<int> sortedSlots(int col) const;
+
+    qint64 memoryBytes() const;
+
+private:
+    QVector<Column>  m_cols;
+    BitVector        m_live;
+    int              m_liveCount = 0;
+
+    QVector<RowId>    m_rowIds;      // slot -> row id (0 = hueco)
+    QHash<RowId, int> m_slotOf;      // row id -> slot
+    RowId             m_nextRowId = 1;
+
+    RowId bindRowId(int slot, RowId id);
+
+    QMap<int, QMultiHash<size_t, int>> m_indexes;   // columna -> hash(valor) -> slots
+
+    mutable QHash<int, QVector<int>> m_sorted;      // columna -> slots ordenados (caché)
+
+    void indexAdd(int slot, int onlyCol = -1);
+    void indexRemove(int slot, int onlyCol = -1);
+    void rebuildIndex(int col);
+
+    // Serializa el armado de m_sorted entre lectores concurrentes de esta
+    // tabla (las escrituras ya los excluyen con el lock de escritura)
+    mutable QMutex          m_cacheMutex;
+};
+
+#endif // COLUMNSTORE_H
@@ -1,4 +1,5 @@
 #include "datamodel.h"
+#include "sqlengine.h"
 
 #include <QtGlobal>
 #include <QRegularExpression>
@@ -15,6 +16,12 @@
 #include <QJsonArray>
 #include <cmath>
 #include <QLocale>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QMetaMethod>
+#include <QReadLocker>
+#include <QWriteLocker>
 
 /* ====================== Singleton ====================== */
 
@@ -32,6 +39,118 @@ int DataModel::autoColumn(const Schema& s) const {
 
 DataModel::DataModel(QObject* parent) : QObject(parent) {}
 
+/* ====================== Concurrencia ====================== */
+// Reglas de locks (evitan ciclos):
+//  - Todas las mutaciones corren dentro de un WriteScope (mutex recursivo: un
+//    solo escritor; las llamadas anidadas reutilizan la sección).
+//  - El escritor toma el lock de escritura de UNA tabla a la vez y solo
+//    mientras la modifica; nunca pide otro lock mientras lo tiene.
+//  - m_catalogLock (escritura) solo rodea cambios de m_tables/m_tableIds/m_queries.
+//  - Los lectores toman catálogo -> tabla, nunca al revés.
+
+struct DataModel::WriteScope {
+    explicit WriteScope(DataModel& m) : m_dm(m) { m_dm.beginWrite(); }
+    ~WriteScope() { m_dm.endWrite(); }
+    Q_DISABLE_COPY(WriteScope)
+private:
+    DataModel& m_dm;
+};
+
+void DataModel::beginWrite() {
+    m_writeMutex.lock();
+    ++m_writeDepth;
+}
+
+void DataModel::endWrite() {
+    if (--m_writeDepth > 0) { m_writeMutex.unlock(); return; }
+    // Sección externa: soltar el mutex y recién entonces notificar
+    // (los slots pueden volver a leer o escribir en el modelo)
+    const QVector<std::function<void()>> fns = std::move(m_pendingSignals);
+    m_pendingSignals.clear();
+    m_writeMutex.unlock();
+    deliver(fns);
+}
+
+void DataModel::post(std::function<void()> fn) {
+    if (m_writeDepth > 0) m_pendingSignals.push_back(std::move(fn));
+    else                  deliver({ std::move(fn) });
+}
+
+bool DataModel::tracksRowChanges() const {
+    return isSignalConnected(QMetaMethod::fromSignal(&DataModel::rowsModified));
+}
+
+void DataModel::deliver(const QVector<std::function<void()>>& fns) {
+    if (fns.isEmpty()) return;
+    if (QThread::currentThread() == thread()) {
+        for (const auto& fn : fns) fn();
+        return;
+    }
+    // Escritura desde otro hilo: las señales salen en el hilo de la GUI
+    QMetaObject::invokeMethod(this, [fns]{ for (const auto& fn : fns) fn(); }, Qt::QueuedConnection);
+}
+
+DataSnapshot DataModel::snapshot(const QStringList& tables) const {
+    // Sin escritura a medias (p.ej. una cascada entre dos tablas): corte consistente.
+    // Copiar cada tabla solo incrementa contadores de referencia.
+    QMutexLocker wl(&m_writeMutex);
+    QReadLocker  cl(&m_catalogLock);
+
+    DataSnapshot snap;
+    QStringList names = tables;
+    if (names.isEmpty()) names = m_tableIds.keys();
+    for (const QString& name : names) {
+        const TableId id = m_tableIds.value(name, kInvalidTableId);
+        if (id < 0 || id >= m_tables.size() || !m_tables[id]) continue;
+        const TableData& t = *m_tables[id];
+        QReadLocker tl(&t.lock);   // un escritor de otro hilo ya no puede estar dentro
+        auto e = QSharedPointer<DataSnapshot::Entry>::create();
+        e->schema  = t.schema;
+        e->data    = t.data;
+        e->fks     = t.fks;
+        e->version = t.version;
+        snap.m_tables.insert(name, e);
+    }
+    return snap;
+}
+
+QStringList DataSnapshot::tables() const {
+    QStringList t = m_tables.keys();
+    t.sort(Qt::CaseInsensitive);
+    return t;
+}
+
+const Schema& DataSnapshot::schema(const QString& table) const {
+    static const Schema kEmpty;
+    const auto e = m_tables.value(table);
+    return e ? e->schema : kEmpty;
+}
+
+const ColumnTable& DataSnapshot::columnTable(const QString& table) const {
+    static const ColumnTable kEmpty;
+    const auto e = m_tables.value(table);
+    return e ? e->data : kEmpty;
+}
+
+QVector<ForeignKey> DataSnapshot::relationshipsFor(const QString& table) const {
+    const auto e = m_tables.value(table);
+    return e ? e->fks : QVector<ForeignKey>();
+}
+
+quint64 DataSnapshot::version(const QString& table) const {
+    const auto e = m_tables.value(table);
+    return e ? e->version : 0;
+}
+
+TableReadLock DataModel::readTable(TableId id) const {
+    QSharedPointer<const TableData> t;
+    {
+        QReadLocker cl(&m_catalogLock);
+        if (id >= 0 && id < m_tables.size()) t = m_tables[id];
+    }
+    return TableReadLock(t);
+}
+
 /* ====================== Helpers (libres) ====================== */
 
 static inline bool isEmptyVar(const QVariant& v) {
@@ -82,7 +201,7 @@ int DataModel::fieldIndex(const Schema& s, const QString& name) const {
 }
 
 int DataModel::fieldIndex(const QString& table, const QString& name) const {
-    return fieldIndex(m_schemas.value(table), name);
+    return fieldIndex(schemaRef(tableId(table)), name);
 }
 
 bool DataModel::isUniqueField(const FieldDef& f) const {
@@ -90,6 +209,12 @@ bool DataModel::isUniqueField(const FieldDef& f) const {
     return f.indexado.contains("sin duplicados", Qt::CaseInsensitive);
 }
 
+bool DataModel::isIndexedField(const FieldDef& f) const {
+    if (f.pk) return true;
+    const QString ix = f.indexado.trimmed();
+    return !ix.isEmpty() && !ix.startsWith("No", Qt::CaseInsensitive);
+}
+
 bool DataModel::sameValue(const QVariant& a, const QVariant& b) const {
     if (!a.isValid() && !b.isValid()) return true;
     if (a.isNull() && b.isNull()) return true;
@@ -115,24 +240,25 @@ bool DataModel::validateRecordCore(const Schema& s, const Record& r, QString* er
     return true;
 }
 
-bool DataModel::checkUniqueness(const QString& table, const Schema& s,
-                                const Record& candidate, int skipRow, QString* err) const
+bool DataModel::checkUniqueness(const TableData& t, const Record& candidate, int skipRow, QString* err) const
 {
-    const auto& vec = m_data.value(table);
+    const Schema& s = t.schema;
+    const ColumnTable& tab = t.data;
+    // ¿Existe otra fila viva con el mismo valor en la columna c? (índice hash si existe)
+    auto clashes = [&](int c, const QVariant& val) {
+        if (c >= tab.columnCount()) return false;
+        const QVector<int> hits = tab.lookup(c, tab.column(c).probe(val));
+        for (int i : hits)
+            if (i != skipRow) return true;
+        return false;
+    };
     // 1) PK
     const int pk = pkColumn(s);
     if (pk >= 0 && pk < candidate.size()) {
         const QVariant& pkVal = candidate[pk];
-        if (pkVal.isValid() && !pkVal.isNull()) {
-            for (int i = 0; i < vec.size(); ++i) {
-                if (i == skipRow) continue;
-                const Record& rec = vec[i];
-                if (rec.isEmpty()) continue;
-                if (pk < rec.size() && sameValue(rec[pk], pkVal)) {
-                    if (err) *err = tr("Clave primaria duplicada: %1").arg(pkVal.toString());
-                    return false;
-                }
-            }
+        if (pkVal.isValid() && !pkVal.isNull() && clashes(pk, pkVal)) {
+            if (err) *err = tr("Clave primaria duplicada: %1").arg(pkVal.toString());
+            return false;
         }
     }
     // 2) Únicos ("Sí (sin duplicados)")
@@ -141,11 +267,47 @@ bool DataModel::checkUniqueness(const QString& table, const Schema& s,
         if (!isUniqueField(f)) continue;
         const QVariant& val = candidate.value(c);
         if (!val.isValid() || val.isNull()) continue; // NULLs permiten duplicados típicamente
-        for (int i = 0; i < vec.size(); ++i) {
-            if (i == skipRow) continue;
-            const Record& rec = vec[i];
-            if (rec.isEmpty()) continue;
-            if (c < rec.size() && sameValue(rec[c], val)) {
+        if (clashes(c, val)) {
+            if (f.pk) {
+                if (err) *err = tr("Clave primaria duplicada: %1").arg(val.toString());
+            } else {
+                if (err) *err = tr("Valor duplicado en campo único \"%1\": %2").arg(f.name, val.toString());
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+bool DataModel::checkUniquenessBatch(const TableData& t, const QVector<int>& targets,
+                                     const QVector<Record>& recs, QString* err) const
+{
+    const Schema& s = t.schema;
+    const ColumnTable& tab = t.data;
+    const QSet<int> updating(targets.cbegin(), targets.cend());
+    for (int c = 0; c < s.size() && c < tab.columnCount(); ++c) {
+        const FieldDef& f = s[c];
+        if (!isUniqueField(f)) continue;
+        // Si ninguna fila del lote cambia la columna, la unicidad ya se cumplía
+        bool changes = false;
+        for (int i = 0; i < targets.size() && !changes; ++i)
+            changes = !sameValue(tab.value(targets[i], c), recs[i].value(c));
+        if (!changes) continue;
+
+        // Un valor choca si se repite dentro del lote o si lo tiene una fila
+        // que no se actualiza (las del lote dejan su valor viejo: se permite
+        // p. ej. SET id = id + 1)
+        QSet<QString> seen;   // valores ya normalizados: mismo tipo en toda la columna
+        for (const Record& r : recs) {
+            const QVariant& val = r.value(c);
+            if (!val.isValid() || val.isNull()) continue; // NULLs permiten duplicados típicamente
+            bool clash = seen.contains(val.toString());
+            seen.insert(val.toString());
+            if (!clash) {
+                for (int hit : tab.lookup(c, tab.column(c).probe(val)))
+                    if (!updating.contains(hit)) { clash = true; break; }
+            }
+            if (clash) {
                 if (f.pk) {
                     if (err) *err = tr("Clave primaria duplicada: %1").arg(val.toString());
                 } else {
@@ -158,57 +320,66 @@ bool DataModel::checkUniqueness(const QString& table, const Schema& s,
     return true;
 }
 
-bool DataModel::checkForeignKeys(const QString& table, const Schema& s,
-                                 const Record& candidate, QString* err) const
+bool DataModel::checkForeignKeys(const TableData& t, const Record& candidate, QString* err) const
 {
-    Q_UNUSED(s);
-    return checkFksOnWrite(table, candidate, err);
+    return checkFksOnWrite(t, candidate, err);
 }
 
-void DataModel::assignAutonumberIfNeeded(const QString& table, const Schema& s, Record& r) {
-    const int ac = autoColumn(s);                   // ← en vez de pkColumn(s)
+void DataModel::assignAutonumberIfNeeded(TableData& t, Record& r) {
+    const int ac = autoColumn(t.schema);            // ← en vez de pkColumn(s)
     if (ac >= 0) {
-        r.resize(std::max(r.size(), s.size()));
+        r.resize(std::max(r.size(), t.schema.size()));
         if (isEmptyVar(r[ac])) {
-            r[ac] = nextAutoNumber(table);          // ← se autollenará igual
+            r[ac] = nextAutoNumber(t);              // ← se autollenará igual
         }
     }
 }
 
-void DataModel::ensureAutoCounterInitialized(const QString& table)
+void DataModel::ensureAutoCounterInitialized(TableData& t)
 {
-    if (m_lastIssuedId.contains(table)) return;
+    if (t.autoCounterReady) return;
+    t.autoCounterReady = true;
 
-    const auto& rows = this->rows(table);
-    const Schema sch = this->schema(table);
+    const ColumnTable& tab = t.data;
 
     // localizar columna de Autonumeración (aunque no sea PK)
-    const int ac = autoColumn(sch);
+    const int ac = autoColumn(t.schema);
     if (ac < 0) {                      // no hay autonum en esta tabla
-        m_lastIssuedId.insert(table, 0);
+        t.lastIssuedId = 0;
         return;
     }
 
     qint64 maxId = 0;
-    for (const Record& rec : rows) {
-        if (rec.isEmpty() || ac >= rec.size()) continue;
-        bool ok = false;
-        const qint64 v = rec[ac].toLongLong(&ok);
-        if (ok && v > maxId) maxId = v;
+    if (ac < tab.columnCount()) {
+        const Column& col = tab.column(ac);
+        for (int i = 0; i < tab.slotCount(); ++i) {
+            if (!tab.isLive(i) || col.isNull(i)) continue;
+            bool ok = col.kind() == ColumnKind::Int64;
+            const qint64 v = ok ? col.int64At(i) : col.value(i).toLongLong(&ok);
+            if (ok && v > maxId) maxId = v;
+        }
     }
-    m_lastIssuedId.insert(table, maxId);   // arranca en el máximo existente
+    t.lastIssuedId = maxId;   // arranca en el máximo existente
 }
 
 QVariant DataModel::nextAutoNumber(const QString& name)
 {
-    const Schema sch = m_schemas.value(name);
+    WriteScope ws(*this);   // inicializa/consulta el contador del escritor
+    TableData* t = tableMut(name);
+    if (!t) return static_cast<qint64>(1);
+    return nextAutoNumber(*t);
+}
+
+QVariant DataModel::nextAutoNumber(TableData& t)
+{
+    const Schema& sch = t.schema;
 
     // ← localizar la columna AUTONUM (aunque no sea PK)
     const int ac = autoColumn(sch);
     if (ac < 0) return static_cast<qint64>(1);
 
     const FieldDef& fd = sch[ac];
-    auto it = m_data.constFind(name);
+    const ColumnTable& tab = t.data;
 
     // 1) Replication ID -> GUID
     if (normType(fd.type) == "autonumeracion" &&
@@ -219,23 +390,18 @@ QVariant DataModel::nextAutoNumber(const QString& name)
 
     // 2) Random entero único
     if (fd.autoNewValues.toLower().startsWith("random")) {
-        if (it == m_data.constEnd() || it->isEmpty()) {
+        if (tab.liveCount() == 0 || ac >= tab.columnCount()) {
             return static_cast<qint64>(QRandomGenerator::global()->bounded(1, INT_MAX));
         }
         while (true) {
             const qint64 v = static_cast<qint64>(QRandomGenerator::global()->bounded(1, INT_MAX));
-            bool clash = false;
-            for (const auto& rec : it.value()) {
-                if (rec.isEmpty()) continue;                 // omite tombstones
-                if (ac < rec.size() && rec.value(ac).toLongLong() == v) { clash = true; break; }
-            }
-            if (!clash) return v;
+            if (tab.lookup(ac, tab.column(ac).probe(v)).isEmpty()) return v;
         }
     }
 
     // 3) Incremental MONÓTONO: último emitido + 1
-    ensureAutoCounterInitialized(name);                      // ya usa autoColumn internamente
-    return QVariant(m_lastIssuedId.value(name, 0) + 1);
+    ensureAutoCounterInitialized(t);                         // ya usa autoColumn internamente
+    return QVariant(t.lastIssuedId + 1);
 }
 
 bool DataModel::normalizeValue(const FieldDef& col, QVariant& v, QString* err) const {
@@ -363,56 +529,89 @@ bool DataModel::normalizeValue(const FieldDef& col, QVariant& v, QString* err) c
     }
 }
 
-bool DataModel::ensureUniquePk(const QString& name, int pkCol, const QVariant& pkVal,
+bool DataModel::ensureUniquePk(const TableData& t, int pkCol, const QVariant& pkVal,
                                int ignoreRow, QString* err) const
 {
-    if (pkCol < 0) return true;
-    const auto& vec = m_data.value(name);
-    for (int i = 0; i < vec.size(); ++i) {
+    const ColumnTable& tab = t.data;
+    if (pkCol < 0 || pkCol >= tab.columnCount()) return true;
+    for (int i : tab.lookup(pkCol, tab.column(pkCol).probe(pkVal))) {
         if (i == ignoreRow) continue;
-        const Record& rec = vec[i];
-        if (rec.isEmpty()) continue; // ⟵ omitir tombstones
-        const QVariant& v = rec.value(pkCol);
-        if (v.isValid() && !v.isNull() && v == pkVal) {
-            if (err) *err = tr("Clave primaria duplicada: %1").arg(pkVal.toString());
-            return false;
-        }
+        if (err) *err = tr("Clave primaria duplicada: %1").arg(pkVal.toString());
+        return false;
     }
     return true;
 }
 
+/* ====================== Handles de tabla ====================== */
+
+TableId DataModel::tableId(const QString& name) const {
+    QReadLocker cl(&m_catalogLock);
+    return m_tableIds.value(name, kInvalidTableId);
+}
+
+const TableData* DataModel::table(TableId id) const {
+    QReadLocker cl(&m_catalogLock);
+    if (id < 0 || id >= m_tables.size()) return nullptr;
+    return m_tables[id].data();
+}
+
+TableData* DataModel::tableMut(TableId id) {
+    QReadLocker cl(&m_catalogLock);
+    if (id < 0 || id >= m_tables.size()) return nullptr;
+    return m_tables[id].data();
+}
+
+const Schema& DataModel::schemaRef(TableId id) const {
+    static const Schema kEmpty;
+    const TableData* t = table(id);
+    return t ? t->schema : kEmpty;
+}
+
+TableData& DataModel::addTable(const QString& name, const Schema& s) {
+    auto t = QSharedPointer<TableData>::create();
+    t->name   = name;
+    t->schema = s;
+    t->data   = makeColumnTable(s);
+    QWriteLocker cl(&m_catalogLock);
+    t->id     = TableId(m_tables.size());
+    m_tables.push_back(t);
+    m_tableIds.insert(name, t->id);
+    return *t;
+}
+
 /* ====================== Esquema ====================== */
 
 QStringList DataModel::tables() const {
-    QStringList t = m_schemas.keys();
+    QReadLocker cl(&m_catalogLock);
+    QStringList t = m_tableIds.keys();
     t.sort(Qt::CaseInsensitive);
     return t;
 }
 
 Schema DataModel::schema(const QString& name) const {
-    return m_schemas.value(name);
+    const TableReadLock t = readTable(name);   // copia consistente desde cualquier hilo
+    return t ? t->schema : Schema();
 }
 
 QString DataModel::tableDescription(const QString& table) const {
-    return m_tableDescriptions.value(table);
+    const TableReadLock t = readTable(table);
+    return t ? t->description : QString();
 }
 
 void DataModel::setTableDescription(const QString& table, const QString& desc) {
     if (table.isEmpty()) return;
-    if (!m_schemas.contains(table)) return;
-    m_tableDescriptions[table] = desc;
-    // opcional: emit schemaChanged(table, m_schemas.value(table));
-}
-
-void DataModel::ensureTableExists(const QString& table) {
-    if (!m_schemas.contains(table)) m_schemas[table] = Schema{};
-    if (!m_data.contains(table))    m_data[table]    = {};
-    if (!m_freeList.contains(table))m_freeList[table]= {};
+    WriteScope ws(*this);
+    TableData* t = tableMut(table);
+    if (!t) return;
+    QWriteLocker tl(&t->lock);
+    t->description = desc;
+    // opcional: emit schemaChanged(table, t->schema);
 }
 
 bool DataModel::createTable(const QString& name, const Schema& s, QString* err) {
+    WriteScope ws(*this);
     if (!isValidTableName(name)) { if (err) *err = tr("Nombre de tabla inválido: %1").arg(name); return false; }
-    if (m_schemas.contains(name)) { if (err) *err = tr("La tabla ya existe: %1").arg(name); return false; }
+    if (tableId(name) != kInvalidTableId) { if (err) *err = tr("La tabla ya existe: %1").arg(name); return false; }
 
     // Aceptar esquema vacío al crear; el usuario lo diseñará luego.
     Schema s2 = s;  // ← trabajamos sobre una copia editable para poder forzar 'requerido'
@@ -442,42 +641,58 @@ bool DataModel::createTable(const QString& name, const Schema& s, QString* err)
         }
     }
 
-    m_schemas.insert(name, s2);
-    m_data.insert(name, {});
-    m_tableDescriptions.insert(name, QString());
-    m_freeList.insert(name, {}); // ⟵ preparar avail list
-    emit tableCreated(name);
-    emit schemaChanged(name, s2);
+    addTable(name, s2);          // ⟵ esquema, datos y avail list vacía
+    post([this, name, s2]{ emit tableCreated(name); emit schemaChanged(name, s2); });
     return true;
 }
 
 bool DataModel::dropTable(const QString& name, QString* err) {
-    if (!m_schemas.contains(name)) { if (err) *err = tr("No existe la tabla: %1").arg(name); return false; }
-    m_schemas.remove(name);
-    m_data.remove(name);
-    m_tableDescriptions.remove(name);
-    m_freeList.remove(name);
-    emit tableDropped(name);
+    WriteScope ws(*this);
+    const TableId id = tableId(name);
+    if (id == kInvalidTableId) { if (err) *err = tr("No existe la tabla: %1").arg(name); return false; }
+    {
+        QWriteLocker cl(&m_catalogLock);
+        m_tableIds.remove(name);
+        m_tables[id].reset();    // el id no se reutiliza (un TableReadLock vivo la mantiene)
+    }
+    m_compactPending.remove(id);
+    post([this, name]{ emit tableDropped(name); });
     return true;
 }
 
 bool DataModel::renameTable(const QString& oldName, const QString& newName, QString* err) {
-    if (!m_schemas.contains(oldName)) { if (err) *err = tr("No existe: %1").arg(oldName); return false; }
+    WriteScope ws(*this);
+    TableData* t = tableMut(oldName);
+    if (!t)                            { if (err) *err = tr("No existe: %1").arg(oldName); return false; }
     if (!isValidTableName(newName))   { if (err) *err = tr("Nombre inválido: %1").arg(newName); return false; }
-    if (m_schemas.contains(newName))  { if (err) *err = tr("Ya existe: %1").arg(newName); return false; }
-
-    m_schemas.insert(newName, m_schemas.take(oldName));
-    m_data.insert(newName,   m_data.take(oldName));
-    m_tableDescriptions.insert(newName, m_tableDescriptions.take(oldName));
-    m_freeList.insert(newName, m_freeList.take(oldName));
-    emit tableDropped(oldName);
-    emit tableCreated(newName);
-    emit schemaChanged(newName, m_schemas.value(newName));
+    if (tableId(newName) != kInvalidTableId) { if (err) *err = tr("Ya existe: %1").arg(newName); return false; }
+
+    // El id se conserva: solo cambia el nombre (y las FKs que lo mencionan)
+    {
+        QWriteLocker cl(&m_catalogLock);
+        m_tableIds.insert(newName, m_tableIds.take(oldName));
+    }
+    for (const auto& other : m_tables) {   // solo el escritor modifica m_tables
+        if (!other) continue;
+        QWriteLocker tl(&other->lock);
+        if (other.data() == t) { t->name = newName; touch(*t); }
+        for (auto& fk : other->fks) {
+            if (fk.childTable  == oldName) fk.childTable  = newName;
+            if (fk.parentTable == oldName) fk.parentTable = newName;
+        }
+    }
+    const Schema sch = t->schema;
+    post([this, oldName, newName, sch]{
+        emit tableDropped(oldName);
+        emit tableCreated(newName);
+        emit schemaChanged(newName, sch);
+    });
     return true;
 }
 
 void DataModel::markColumnEdited(const QString& table, const QString& colName)
 {
+    WriteScope ws(*this);
     // Solo marca si esa columna salió antes de Autonumeración (hay baseline guardado)
     if (m_autoBaseline.contains(table) && m_autoBaseline[table].contains(colName)) {
         m_autoEditedSinceLeave[table].insert(colName);
@@ -485,7 +700,9 @@ void DataModel::markColumnEdited(const QString& table, const QString& colName)
 }
 
 bool DataModel::setSchema(const QString& name, const Schema& s, QString* err) {
-    if (!m_schemas.contains(name)) { if (err) *err = tr("No existe la tabla: %1").arg(name); return false; }
+    WriteScope ws(*this);
+    TableData* t = tableMut(name);
+    if (!t) { if (err) *err = tr("No existe la tabla: %1").arg(name); return false; }
 
     // --- VALIDACIÓN: duplicados, PK única, y SOLO 1 Autonumeración (si hay, forzar requerido=true)
     Schema s2 = s; // copia editable
@@ -512,8 +729,11 @@ bool DataModel::setSchema(const QString& name, const Schema& s, QString* err) {
     }
 
     // Migración sencilla por nombre + soporte a rename, usando s2 (no s)
-    const Schema oldS  = m_schemas.value(name);
-    const auto   oldRs = m_data.value(name);
+    const Schema oldS  = t->schema;
+    // Filas viejas por slot (los huecos como Record vacío), solo para migrar
+    QVector<Record> oldRs;
+    oldRs.reserve(t->data.slotCount());
+    for (int s = 0; s < t->data.slotCount(); ++s) oldRs.push_back(t->data.record(s));
 
     QHash<QString,int> oldIndex;
     for (int i = 0; i < oldS.size(); ++i) oldIndex.insert(oldS[i].name, i);
@@ -692,14 +912,10 @@ bool DataModel::setSchema(const QString& name, const Schema& s, QString* err) {
             const QVector<QVariant>& snap = m_autoBaseline[name][colNameNow];
             bool differs = false;
 
-            const QVector<Record>& rows = m_data.value(name);
-            const int N = std::max(snap.size(), rows.size());
+            const ColumnTable& tab = t->data;
+            const int N = std::max<int>(snap.size(), tab.slotCount());
             for (int r = 0; r < N; ++r) {
-                QVariant cur;
-                if (r < rows.size()) {
-                    const Record& rec = rows[r];
-                    if (newCol < rec.size()) cur = rec[newCol];
-                }
+                const QVariant cur  = tab.value(r, newCol);   // inválido si es hueco/fuera de rango
                 const QVariant base = (r < snap.size() ? snap[r] : QVariant());
                 if (!sameValue(cur, base)) { differs = true; break; }
             }
@@ -710,36 +926,86 @@ bool DataModel::setSchema(const QString& name, const Schema& s, QString* err) {
         }
     }
 
-    // Sustituir esquema y datos (usar s2, no s)
-    m_schemas[name] = s2;
-    m_data[name]    = newRows;
+    // Sustituir esquema y datos (usar s2, no s); se construye fuera del lock
+    ColumnTable fresh = makeColumnTable(s2);
+    for (int slot = 0; slot < newRows.size(); ++slot) {
+        const Record& nr = newRows[slot];
+        if (nr.isEmpty()) fresh.appendTombstone();
+        else              fresh.append(nr, t->data.rowIdAt(slot));   // conserva el row id
+    }
+    fresh.setNextRowId(t->data.nextRowId());
 
-    // Recalcular free list (tombstones) tras cambio de esquema
-    m_freeList[name].clear();
-    for (int i = 0; i < m_data[name].size(); ++i)
-        if (m_data[name][i].isEmpty()) m_freeList[name].push_back(i);
+    {
+        QWriteLocker tl(&t->lock);
+        touch(*t);
+        t->schema = s2;
+        t->data   = fresh;
+
+        // Recalcular free list (tombstones) tras cambio de esquema
+        t->freeList.clear();
+        for (int i = 0; i < fresh.slotCount(); ++i)
+            if (!fresh.isLive(i)) t->freeList.push_back(i);
+    }
 
     // Recalcular contador SÓLO si cambió cuál columna es Autonumeración
     const int oldAuto = autoColumn(oldS);
     const int newAuto = autoColumn(s2);
     if (oldAuto != newAuto) {
-        m_lastIssuedId.remove(name);        // se recalculará con ensureAutoCounterInitialized
+        t->autoCounterReady = false;        // se recalculará con ensureAutoCounterInitialized
     }
-    emit schemaChanged(name, s2);
+    post([this, name, s2]{ emit schemaChanged(name, s2); });
     return true;
 }
 
 /* ====================== Datos ====================== */
 
 int DataModel::rowCount(const QString& name) const {
-    return m_data.value(name).size();
+    return rowCount(tableId(name));
+}
+
+const ColumnTable& DataModel::columnTable(const QString& name) const {
+    return columnTable(tableId(name));
+}
+
+int DataModel::rowCount(TableId id) const {
+    return columnTable(id).slotCount();
+}
+
+const ColumnTable& DataModel::columnTable(TableId id) const {
+    static const ColumnTable kEmpty;
+    const TableData* t = table(id);
+    return t ? t->data : kEmpty;
+}
+
+ColumnKind DataModel::columnKindFor(const FieldDef& f) {
+    // Debe coincidir con lo que produce normalizeValue para cada tipo
+    const QString t = normType_free(f.type);
+    if (t == "autonumeracion")
+        return f.autoSubtipo.trimmed().toLower().startsWith("replication") ? ColumnKind::Text
+                                                                           : ColumnKind::Int64;
+    if (t == "numero") {
+        const QString sz = f.autoSubtipo.trimmed().toLower();
+        const bool isInt =
+            sz.contains("byte") || sz.contains("entero") || sz.contains("integer") || sz.contains("long");
+        return isInt ? ColumnKind::Int64 : ColumnKind::Double;
+    }
+    if (t == "moneda")     return ColumnKind::Double;
+    if (t == "fecha_hora") return ColumnKind::Date;
+    if (t == "booleano")   return ColumnKind::Bool;
+    return ColumnKind::Text;   // texto / texto_largo
 }
 
-const QVector<Record>& DataModel::rows(const QString& name) const {
-    static const QVector<Record> kEmpty;
-    auto it = m_data.constFind(name);
-    if (it == m_data.constEnd()) return kEmpty;
-    return it.value();
+ColumnTable DataModel::makeColumnTable(const Schema& s) const {
+    QVector<ColumnKind> kinds;
+    QVector<int> indexed;
+    kinds.reserve(s.size());
+    for (int i = 0; i < s.size(); ++i) {
+        kinds.push_back(columnKindFor(s[i]));
+        if (isIndexedField(s[i])) indexed.push_back(i);
+    }
+    ColumnTable tab(kinds);
+    tab.setIndexedColumns(indexed);
+    return tab;
 }
 
 bool DataModel::validate(const Schema& s, Record& r, QString* err) const {
@@ -753,167 +1019,315 @@ bool DataModel::validate(const Schema& s, Record& r, QString* err) const {
 }
 
 bool DataModel::insertRow(const QString& name, Record r, QString* err) {
-    if (!m_schemas.contains(name)) { if (err) *err = tr("No existe la tabla: %1").arg(name); return false; }
-    ensureTableExists(name);
-    const Schema s = m_schemas.value(name);
+    const TableId id = tableId(name);
+    if (id == kInvalidTableId) { if (err) *err = tr("No existe la tabla: %1").arg(name); return false; }
+    return insertRow(id, std::move(r), err);
+}
+
+bool DataModel::updateRow(const QString& name, int row, const Record& r, QString* err) {
+    const TableId id = tableId(name);
+    if (id == kInvalidTableId) { if (err) *err = tr("No existe la tabla: %1").arg(name); return false; }
+    return updateRow(id, row, r, err);
+}
+
+bool DataModel::removeRows(const QString& name, const QList<int>& rowsToRemove, QString* err) {
+    return removeRows(tableId(name), rowsToRemove, err);
+}
+
+bool DataModel::insertRow(TableId id, Record r, QString* err, RowId* outId) {
+    WriteScope ws(*this);
+    TableData* t = tableMut(id);
+    if (!t) { if (err) *err = tr("La tabla no existe."); return false; }
+    const Schema& s = t->schema;
+    const QString name = t->name;   // copia: se emite al final
 
     // Autonum si aplica y viene vacío
-    assignAutonumberIfNeeded(name, s, r);
+    assignAutonumberIfNeeded(*t, r);
 
     // Normalización + requeridos
     if (!validate(s, r, err)) return false;
 
     // Integridad referencial
-    if (!checkForeignKeys(name, s, r, err)) return false;
+    if (!checkForeignKeys(*t, r, err)) return false;
 
     // Unicidad (PK + únicos)
-    if (!checkUniqueness(name, s, r, -1, err)) return false;
+    if (!checkUniqueness(*t, r, -1, err)) return false;
 
     // === Avail List: reutiliza huecos antes de hacer append ===
-    auto& vec  = m_data[name];
+    QWriteLocker tl(&t->lock);
+    const quint64 fromVersion = t->version;
+    touch(*t);
+    auto& tab  = t->data;
 
-    auto& free = m_freeList[name];
+    auto& free = t->freeList;
 
+    int slot = -1;
     if (!free.isEmpty()) {
         int idx = free.back();
         free.pop_back();
-        if (idx >= 0 && idx < vec.size() && vec[idx].isEmpty()) {
-            vec[idx] = r;               // reutilización in-place
+        if (idx >= 0 && idx < tab.slotCount() && !tab.isLive(idx)) {
+            tab.write(idx, r);          // reutilización in-place (el slot sí, el row id no)
+            slot = idx;
         } else {
-            vec.push_back(r);           // fallback seguro
+            slot = tab.append(r);       // fallback seguro
         }
     } else {
-        vec.push_back(r);
+        slot = tab.append(r);
+    }
+    if (outId) *outId = tab.rowIdAt(slot);
+    scheduleCompaction(kInvalidTableId);   // hay actividad: posponer la compactación
+    if (tracksRowChanges()) {
+        RowChange ch;
+        ch.kind  = RowChange::Kind::Insert;
+        ch.row   = tab.rowIdAt(slot);
+        ch.after = tab.record(slot);
+        const quint64 toVersion = t->version;
+        post([this, name, fromVersion, toVersion, ch]{ emit rowsModified(name, fromVersion, toVersion, {ch}); });
     }
 
     // ← AVANZAR contador monótono si la tabla tiene columna de Autonumeración (sea o no PK)
     {
         const int ac = autoColumn(s);
         if (ac >= 0) {
-            ensureAutoCounterInitialized(name);
+            ensureAutoCounterInitialized(*t);
             bool ok = false;
             const qint64 v = (ac < r.size() ? r[ac].toLongLong(&ok) : 0);
-            if (ok && v > m_lastIssuedId.value(name, 0)) {
-                m_lastIssuedId[name] = v;
+            if (ok && v > t->lastIssuedId) {
+                t->lastIssuedId = v;
             }
         }
     }
+    tl.unlock();
 
-    emit rowsChanged(name);
+    post([this, name]{ emit rowsChanged(name); });
     return true;
 }
 
-bool DataModel::updateRow(const QString& name, int row, const Record& newR, QString* err) {
-    if (!m_schemas.contains(name)) { if (err) *err = tr("No existe la tabla: %1").arg(name); return false; }
-    ensureTableExists(name);
-    auto& vec = m_data[name];
-    if (row < 0 || row >= vec.size() || vec[row].isEmpty()) { // ⟵ evitar actualizar tombstone
-        if (err) *err = tr("La fila no existe.");
-        return false;
-    }
-
-    Record r = newR;
-    const Schema s = m_schemas.value(name);
+bool DataModel::updateRow(TableId id, int row, const Record& newR, QString* err) {
+    return updateSlots(id, {row}, {newR}, err);
+}
 
+// Actualización en bloque: se valida todo (tipos, FKs, unicidad, RESTRICT)
+// antes de escribir nada; luego se escribe bajo un solo lock de la tabla y
+// sale una sola notificación por tabla tocada.
+bool DataModel::updateSlots(TableId id, const QVector<int>& targets, QVector<Record> recs, QString* err) {
+    WriteScope ws(*this);
+    TableData* t = tableMut(id);
+    if (!t) { if (err) *err = tr("La tabla no existe."); return false; }
+    const QString name = t->name;
+    auto& tab = t->data;
+    const Schema& s = t->schema;
+
+    // No permitir cambiar el autonum
     const int pk = pkColumn(s);
-    if (pk >= 0 && normType(s[pk].type) == "autonumeracion") {
-        // No permitir cambiar el autonum
-        if (r.size() <= pk || r[pk] != vec[row][pk]) {
+    const bool autoPk = pk >= 0 && normType(s[pk].type) == "autonumeracion";
+
+    for (int i = 0; i < targets.size(); ++i) {
+        const int row = targets[i];
+        if (!tab.isLive(row)) { // ⟵ evitar actualizar tombstone
+            if (err) *err = tr("La fila no existe.");
+            return false;
+        }
+        Record& r = recs[i];
+        if (autoPk) {
             if (r.size() <= pk) r.resize(pk+1);
-            r[pk] = vec[row][pk];
+            r[pk] = tab.value(row, pk);
         }
+        // Normalización
+        if (!validate(s, r, err)) return false;
+        // Integridad referencial (como hija)
+        if (!checkForeignKeys(*t, r, err)) return false;
     }
 
-    // Normalización
-    if (!validate(s, r, err)) return false;
-
-    // Integridad referencial (como hija)
-    if (!checkForeignKeys(name, s, r, err)) return false;
-
-    // Unicidad (PK + únicos) respetando skipRow
-    if (!checkUniqueness(name, s, r, row, err)) return false;
+    // Unicidad (PK + únicos) del lote contra sí mismo y el resto de la tabla
+    if (!checkUniquenessBatch(*t, targets, recs, err)) return false;
 
     // === ON UPDATE para FKs entrantes (cuando 'name' actúa como PADRE) ===
-    {
-        const auto incoming = incomingRelationshipsTo(name); // FKs donde 'name' es padre
-        if (!incoming.isEmpty()) {
-            QVector<QPair<int, QPair<QVariant,QVariant>>> parentChanges; // (parentCol, (old,new))
-            for (const auto& fk : incoming) {
-                const int pc = fk.parentCol;
-                if (pc < 0) continue;
-                if (pc >= vec[row].size()) continue;
-                const QVariant oldV = vec[row][pc];
-                const QVariant newV = (pc < r.size() ? r[pc] : QVariant());
-                if (oldV != newV) parentChanges.push_back({pc, {oldV, newV}});
+    // Primero se buscan todas las filas hijas afectadas (contra los valores
+    // viejos) y se aplica RESTRICT; recién después se modifican.
+    struct ChildChange { TableData* child; int col; QVariant value; QVector<int> rows; };
+    QVector<ChildChange> childChanges;
+    for (const auto& fk : incomingRelationshipsTo(name)) {   // FKs donde 'name' es padre
+        const int pc = fk.parentCol;
+        if (pc < 0 || pc >= tab.columnCount()) continue;
+        TableData* child = tableMut(fk.childTable);
+        if (!child) continue;
+        const auto& childTab = child->data;
+        if (fk.childCol < 0 || fk.childCol >= childTab.columnCount()) continue;
+        const Column& ccol = childTab.column(fk.childCol);
+
+        // Claves viejas que cambian (una por fila destino) y su valor nuevo
+        struct KeyChange { CellProbe old; QVariant value; QVector<int> rows; };
+        QVector<KeyChange> keys;
+        for (int i = 0; i < targets.size(); ++i) {
+            const QVariant oldV = tab.value(targets[i], pc);
+            const QVariant newV = (pc < recs[i].size() ? recs[i][pc] : QVariant());
+            if (oldV == newV) continue;
+            const CellProbe p = ccol.probe(oldV);
+            if (!p.null) keys.push_back({ p, newV, {} });
+        }
+        if (keys.isEmpty()) continue;
+
+        // Filas vivas que referencian cada valor viejo (⟵ omite tombstones): con
+        // índice, una búsqueda por clave; sin él, una sola pasada por la columna
+        // hija contra un hash temporal de las claves (no una por fila destino)
+        if (childTab.hasIndex(fk.childCol)) {
+            for (KeyChange& k : keys) k.rows = childTab.lookup(fk.childCol, k.old);
+        } else {
+            QMultiHash<size_t, int> byHash;
+            for (int k = 0; k < keys.size(); ++k) byHash.insert(ccol.hashOf(keys[k].old), k);
+            for (int r = 0; r < childTab.slotCount(); ++r) {
+                if (!childTab.isLive(r) || ccol.isNull(r)) continue;
+                const auto range = byHash.equal_range(ccol.hashAt(r));
+                for (auto h = range.first; h != range.second; ++h)
+                    if (ccol.equals(r, keys[h.value()].old)) keys[h.value()].rows.push_back(r);
             }
+        }
 
-            for (const auto& fk : incoming) {
-                bool touches = false; QVariant oldVal, newVal;
-                for (const auto& ch : parentChanges) {
-                    if (ch.first == fk.parentCol) { touches = true; oldVal = ch.second.first; newVal = ch.second.second; break; }
-                }
-                if (!touches) continue;
-
-                auto& childVec = m_data[fk.childTable];
-                QList<int> hitRows;
-                for (int i = 0; i < childVec.size(); ++i) {
-                    const Record& cr = childVec[i];
-                    if (cr.isEmpty()) continue; // ⟵ omitir tombstones
-                    if (fk.childCol >= 0 && fk.childCol < cr.size()) {
-                        if (cr[fk.childCol] == oldVal) hitRows.push_back(i);
-                    }
-                }
-                if (hitRows.isEmpty()) continue;
-
-                if (fk.onUpdate == FkAction::Restrict) {
-                    if (err) *err = tr("Restrict: no se puede actualizar %1.%2 porque hay registros referenciando ese valor en %3.")
-                                   .arg(name, m_schemas.value(name)[fk.parentCol].name, fk.childTable);
-                    return false;
-                } else if (fk.onUpdate == FkAction::SetNull) {
-                    for (int i : hitRows) {
-                        if (fk.childCol >= 0 && fk.childCol < childVec[i].size())
-                            childVec[i][fk.childCol] = QVariant();
-                    }
-                    emit rowsChanged(fk.childTable);
-                } else if (fk.onUpdate == FkAction::Cascade) {
-                    for (int i : hitRows) {
-                        if (fk.childCol >= 0 && fk.childCol < childVec[i].size())
-                            childVec[i][fk.childCol] = newVal;
-                    }
-                    emit rowsChanged(fk.childTable);
-                }
+        for (const KeyChange& k : std::as_const(keys)) {
+            if (k.rows.isEmpty()) continue;
+            if (fk.onUpdate == FkAction::Restrict) {
+                if (err) *err = tr("Restrict: no se puede actualizar %1.%2 porque hay registros referenciando ese valor en %3.")
+                               .arg(name, s[fk.parentCol].name, fk.childTable);
+                return false;
             }
+            childChanges.push_back({ child, fk.childCol,
+                                     fk.onUpdate == FkAction::SetNull ? QVariant() : k.value, k.rows });
         }
     }
+    QSet<TableData*> touchedChildren;
+    for (const ChildChange& ch : childChanges) {
+        QWriteLocker cl(&ch.child->lock);
+        if (!touchedChildren.contains(ch.child)) {
+            touch(*ch.child);
+            touchedChildren.insert(ch.child);
+            const QString childName = ch.child->name;
+            post([this, childName]{ emit rowsChanged(childName); });
+        }
+        for (int i : ch.rows) ch.child->data.setValue(i, ch.col, ch.value);
+    }
     // === END ON UPDATE ===
 
-    vec[row] = r;
-    emit rowsChanged(name);
+    QVector<RowChange> changes;
+    quint64 fromVersion = 0, toVersion = 0;
+    const bool track = tracksRowChanges();
+    {
+        QWriteLocker tl(&t->lock);
+        fromVersion = t->version;
+        touch(*t);
+        toVersion = t->version;
+        if (track) changes.reserve(targets.size());
+        for (int i = 0; i < targets.size(); ++i) {
+            if (track) changes.push_back({ RowChange::Kind::Update, tab.rowIdAt(targets[i]), tab.record(targets[i]), {} });
+            tab.write(targets[i], recs[i]);
+            if (track) changes.back().after = tab.record(targets[i]);
+        }
+    }
+    scheduleCompaction(kInvalidTableId);
+    if (track)
+        post([this, name, fromVersion, toVersion, changes]{ emit rowsModified(name, fromVersion, toVersion, changes); });
+    post([this, name]{ emit rowsChanged(name); });
     return true;
 }
 
-bool DataModel::removeRows(const QString& name, const QList<int>& rowsToRemove, QString* err) {
-    if (!m_schemas.contains(name)) return false;
-    ensureTableExists(name);
+bool DataModel::removeRows(TableId id, const QList<int>& rowsToRemove, QString* err) {
+    WriteScope ws(*this);
+    TableData* t = tableMut(id);
+    if (!t) return false;
+    const QString name = t->name;
 
     // Acciones FK entrantes respecto a 'name' como padre
-    if (!handleParentDeletes(name, rowsToRemove, err)) return false;
+    if (!handleParentDeletes(*t, rowsToRemove, err)) return false;
 
-    auto& vec  = m_data[name];
-    auto& free = m_freeList[name];
+    auto& tab  = t->data;
+    auto& free = t->freeList;
 
     // Marcar tombstones + añadir a free list (no eliminar físicamente)
-    for (int r : rowsToRemove) {
-        if (r < 0 || r >= vec.size()) continue;
-        if (vec[r].isEmpty()) continue;   // ya era hueco
-        vec[r].clear();                   // ⟵ tombstone
-        free.push_back(r);                // ⟵ agrega al Avail List (LIFO)
+    QVector<RowChange> changes;
+    quint64 fromVersion = 0, toVersion = 0;
+    const bool track = tracksRowChanges();
+    {
+        QWriteLocker tl(&t->lock);
+        fromVersion = t->version;
+        touch(*t);
+        toVersion = t->version;
+        for (int r : rowsToRemove) {
+            if (!tab.isLive(r)) continue;     // fuera de rango o ya era hueco
+            if (track) changes.push_back({ RowChange::Kind::Delete, tab.rowIdAt(r), tab.record(r), {} });
+            tab.kill(r);                      // ⟵ tombstone
+            free.push_back(r);                // ⟵ agrega al Avail List (LIFO)
+        }
     }
+    scheduleCompaction(id);
+    if (track)
+        post([this, name, fromVersion, toVersion, changes]{ emit rowsModified(name, fromVersion, toVersion, changes); });
 
-    emit rowsChanged(name);
+    post([this, name]{ emit rowsChanged(name); });
     return true;
 }
 
+/* ====================== Row ids ====================== */
+
+RowId DataModel::rowIdAt(TableId id, int slot) const {
+    return columnTable(id).rowIdAt(slot);
+}
+
+int DataModel::slotOf(TableId id, RowId row) const {
+    return columnTable(id).slotOf(row);
+}
+
+QVector<RowId> DataModel::rowIds(TableId id) const {
+    const ColumnTable& tab = columnTable(id);
+    QVector<RowId> out;
+    out.reserve(tab.liveCount());
+    for (RowId rid : tab.rowIdData())
+        if (rid != kInvalidRowId) out.push_back(rid);
+    return out;
+}
+
+Record DataModel::record(TableId id, RowId row) const {
+    const ColumnTable& tab = columnTable(id);
+    return tab.record(tab.slotOf(row));
+}
+
+bool DataModel::updateRowById(TableId id, RowId row, const Record& r, QString* err) {
+    WriteScope ws(*this);   // resolución id -> slot y escritura sin otro escritor en medio
+    const int slot = slotOf(id, row);
+    if (slot < 0) { if (err) *err = tr("La fila no existe."); return false; }
+    return updateRow(id, slot, r, err);
+}
+
+bool DataModel::updateRowsById(TableId id, const QVector<RowId>& rows, const QVector<Record>& recs,
+                               QString* err) {
+    WriteScope ws(*this);
+    if (rows.size() != recs.size()) { if (err) *err = tr("Cantidad de registros inválida."); return false; }
+    const ColumnTable& tab = columnTable(id);
+    QVector<int> targets;
+    QVector<Record> values;
+    targets.reserve(rows.size());
+    values.reserve(rows.size());
+    for (int i = 0; i < rows.size(); ++i) {
+        const int slot = tab.slotOf(rows[i]);
+        if (slot < 0) continue;                  // ya borrada por otro escritor
+        targets.push_back(slot);
+        values.push_back(recs[i]);
+    }
+    if (targets.isEmpty()) return true;
+    return updateSlots(id, targets, values, err);
+}
+
+bool DataModel::removeRowsById(TableId id, const QList<RowId>& rowsToRemove, QString* err) {
+    WriteScope ws(*this);
+    const ColumnTable& tab = columnTable(id);
+    QList<int> targets;
+    targets.reserve(rowsToRemove.size());
+    for (RowId rid : rowsToRemove) {
+        const int slot = tab.slotOf(rid);
+        if (slot >= 0) targets.push_back(slot);
+    }
+    return removeRows(id, targets, err);
+}
+
 int DataModel::columnIndex(const Schema& s, const QString& name) const {
     for (int i = 0; i < s.size(); ++i)
         if (QString::compare(s[i].name, name, Qt::CaseInsensitive) == 0) return i;
@@ -924,12 +1338,15 @@ bool DataModel::addRelationship(const QString& childTable, const QString& childC
                                 const QString& parentTable, const QString& parentColName,
                                 FkAction onDelete, FkAction onUpdate, QString* err)
 {
-    if (!m_schemas.contains(childTable) || !m_schemas.contains(parentTable)) {
+    WriteScope ws(*this);
+    TableData* childT        = tableMut(childTable);
+    const TableData* parentT = table(tableId(parentTable));
+    if (!childT || !parentT) {
         if (err) *err = tr("Tabla inexistente en relación.");
         return false;
     }
-    const Schema cs = m_schemas.value(childTable);
-    const Schema ps = m_schemas.value(parentTable);
+    const Schema& cs = childT->schema;
+    const Schema& ps = parentT->schema;
 
     const int cc = columnIndex(cs, childColName);
     const int pc = columnIndex(ps, parentColName);
@@ -967,7 +1384,7 @@ bool DataModel::addRelationship(const QString& childTable, const QString& childC
     }
 
     // Evitar duplicado exacto de relación
-    for (const auto& existing : m_fksByChild.value(childTable)) {
+    for (const auto& existing : childT->fks) {
         if (existing.childCol==cc && existing.parentTable==parentTable && existing.parentCol==pc) {
             if (err) *err = tr("La relación ya existe.");
             return false;
@@ -976,8 +1393,8 @@ bool DataModel::addRelationship(const QString& childTable, const QString& childC
 
     // Integridad previa: no permitir crear la FK si ya hay valores huérfanos
     {
-        const auto& childRows = m_data.value(childTable);
-        const auto& parentRows = m_data.value(parentTable);
+        const ColumnTable& childTab  = childT->data;
+        const ColumnTable& parentTab = parentT->data;
 
         auto keyOf = [](const QVariant& v)->QString {
             if (!v.isValid() || v.isNull()) return QStringLiteral("<NULL>");
@@ -990,15 +1407,15 @@ bool DataModel::addRelationship(const QString& childTable, const QString& childC
         };
 
         QSet<QString> parentKeys;
-        for (const auto& pr : parentRows) {
-            if (pr.isEmpty()) continue; // ⟵ omitir tombstones
-            if (pc >= 0 && pc < pr.size()) parentKeys.insert(keyOf(pr[pc]));
+        for (int i = 0; i < parentTab.slotCount(); ++i) {
+            if (!parentTab.isLive(i)) continue; // ⟵ omitir tombstones
+            if (pc >= 0 && pc < parentTab.columnCount()) parentKeys.insert(keyOf(parentTab.value(i, pc)));
         }
 
-        for (const auto& r : childRows) {
-            if (r.isEmpty()) continue; // ⟵ omitir tombstones
-            if (cc < 0 || cc >= r.size()) continue;
-            const QVariant v = r[cc];
+        for (int i = 0; i < childTab.slotCount(); ++i) {
+            if (!childTab.isLive(i)) continue; // ⟵ omitir tombstones
+            if (cc < 0 || cc >= childTab.columnCount()) continue;
+            const QVariant v = childTab.value(i, cc);
             if (!v.isValid() || v.isNull()) continue;
             if (!parentKeys.contains(keyOf(v))) {
                 if (err) *err = tr("No se puede crear la relación: hay filas en %1.%2 sin padre en %3.%4.")
@@ -1016,43 +1433,46 @@ bool DataModel::addRelationship(const QString& childTable, const QString& childC
     fk.onDelete    = onDelete;
     fk.onUpdate    = onUpdate;
 
-    auto& vec = m_fksByChild[childTable];
-    vec.push_back(fk);
+    QWriteLocker tl(&childT->lock);
+    touch(*childT);
+    childT->fks.push_back(fk);
     return true;
 }
 
 QVector<ForeignKey> DataModel::relationshipsFor(const QString& table) const {
-    return m_fksByChild.value(table);
+    const TableReadLock t = readTable(table);
+    return t ? t->fks : QVector<ForeignKey>();
 }
 
 QVector<ForeignKey> DataModel::incomingRelationshipsTo(const QString& table) const {
     QVector<ForeignKey> r;
-    for (auto it = m_fksByChild.constBegin(); it != m_fksByChild.constEnd(); ++it) {
-        for (const auto& fk : it.value())
+    QReadLocker cl(&m_catalogLock);
+    for (const auto& t : m_tables) {
+        if (!t) continue;
+        QReadLocker tl(&t->lock);
+        for (const auto& fk : t->fks)
             if (fk.parentTable == table) r.push_back(fk);
     }
     return r;
 }
 
 // Verifica que todo valor FK (no nulo) exista en su tabla padre
-bool DataModel::checkFksOnWrite(const QString& childTable, const Record& r, QString* err) const {
-    const auto fks = m_fksByChild.value(childTable);
-    for (const auto& fk : fks) {
+bool DataModel::checkFksOnWrite(const TableData& child, const Record& r, QString* err) const {
+    for (const auto& fk : child.fks) {
         if (fk.childCol < 0 || fk.childCol >= r.size()) continue;
         const QVariant v = r[fk.childCol];
         if (!v.isValid() || v.isNull()) continue;
 
-        const auto& parentRows = m_data.value(fk.parentTable);
-        const Schema ps = m_schemas.value(fk.parentTable);
+        const TableData* parent = table(tableId(fk.parentTable));
+        if (!parent) continue;
+        const Schema& ps = parent->schema;
         if (fk.parentCol < 0 || fk.parentCol >= ps.size()) continue;
 
+        // La columna padre suele ser PK (índice hash) ⟵ lookup omite tombstones
+        const ColumnTable& parentTab = parent->data;
         bool found = false;
-        for (const auto& pr : parentRows) {
-            if (pr.isEmpty()) continue; // ⟵ omitir tombstones
-            if (pr.size() > fk.parentCol && pr[fk.parentCol].isValid() && pr[fk.parentCol] == v) {
-                found = true; break;
-            }
-        }
+        if (fk.parentCol < parentTab.columnCount())
+            found = !parentTab.lookup(fk.parentCol, parentTab.column(fk.parentCol).probe(v)).isEmpty();
         if (!found) {
             if (err) *err = tr("Violación FK: valor \"%1\" no existe en %2.%3")
                            .arg(v.toString(), fk.parentTable, ps[fk.parentCol].name);
@@ -1063,31 +1483,29 @@ bool DataModel::checkFksOnWrite(const QString& childTable, const Record& r, QStr
 }
 
 // Aplica acciones de borrado referencial para filas padre
-bool DataModel::handleParentDeletes(const QString& parentTable, const QList<int>& parentRows, QString* err) {
-    ensureTableExists(parentTable);
+bool DataModel::handleParentDeletes(TableData& parent, const QList<int>& parentRows, QString* err) {
+    const QString parentTable = parent.name;
 
     // Obtén valores padre que van a desaparecer
-    const auto& parentVec = m_data.value(parentTable);
-    const Schema ps = m_schemas.value(parentTable);
+    const ColumnTable& parentTab = parent.data;
 
     // Mapa por columna padre -> conjunto de valores
     QHash<int, QList<QVariant>> doomedValues;
+    const auto incoming = incomingRelationshipsTo(parentTable);
     for (int r : parentRows) {
-        if (r < 0 || r >= parentVec.size()) continue;
-        const Record& rec = parentVec[r];
-        if (rec.isEmpty()) continue; // ya es hueco
-        for (const auto& fk : incomingRelationshipsTo(parentTable)) {
-            if (fk.parentCol >= 0 && fk.parentCol < rec.size())
-                doomedValues[fk.parentCol].append(rec[fk.parentCol]);
+        if (!parentTab.isLive(r)) continue; // ya es hueco
+        for (const auto& fk : incoming) {
+            if (fk.parentCol >= 0 && fk.parentCol < parentTab.columnCount())
+                doomedValues[fk.parentCol].append(parentTab.value(r, fk.parentCol));
         }
     }
 
     // Recorre todas las tablas hijas afectadas
-    for (auto it = m_fksByChild.begin(); it != m_fksByChild.end(); ++it) {
-        const QString child = it.key();
-        auto fks = it.value();
-        ensureTableExists(child);
-        auto& cvec = m_data[child];
+    for (const auto& ct : m_tables) {
+        if (!ct || ct->fks.isEmpty()) continue;
+        const QString child = ct->name;
+        const auto fks = ct->fks;
+        auto& ctab = ct->data;
 
         // Para cada FK que apunte a parentTable
         for (const auto& fk : fks) {
@@ -1095,14 +1513,15 @@ bool DataModel::handleParentDeletes(const QString& parentTable, const QList<int>
 
             // Filtra filas hijas que referencian a los padres a borrar
             QList<int> hitRows;
-            for (int i = 0; i < cvec.size(); ++i) {
-                const Record& cr = cvec[i];
-                if (cr.isEmpty()) continue; // omitir huecos
-                if (fk.childCol >= 0 && fk.childCol < cr.size()) {
-                    const QVariant v = cr[fk.childCol];
-                    if (doomedValues.value(fk.parentCol).contains(v))
-                        hitRows.push_back(i);
-                }
+            if (fk.childCol < 0 || fk.childCol >= ctab.columnCount()) continue;
+            const Column& ccol = ctab.column(fk.childCol);
+            QVector<CellProbe> probes;
+            for (const QVariant& v : doomedValues.value(fk.parentCol)) probes.push_back(ccol.probe(v));
+            if (probes.isEmpty()) continue;
+            for (int i = 0; i < ctab.slotCount(); ++i) {
+                if (!ctab.isLive(i)) continue; // omitir huecos
+                for (const CellProbe& p : probes)
+                    if (ccol.equals(i, p)) { hitRows.push_back(i); break; }
             }
 
             if (hitRows.isEmpty()) continue;
@@ -1112,21 +1531,23 @@ bool DataModel::handleParentDeletes(const QString& parentTable, const QList<int>
                                .arg(child);
                 return false;
             } else if (fk.onDelete == FkAction::SetNull) {
-                for (int i : hitRows) {
-                    if (fk.childCol >= 0 && fk.childCol < cvec[i].size())
-                        cvec[i][fk.childCol] = QVariant();
-                }
-                emit rowsChanged(child);
+                QWriteLocker tl(&ct->lock);
+                touch(*ct);
+                for (int i : hitRows) ctab.setValue(i, fk.childCol, QVariant());
+                post([this, child]{ emit rowsChanged(child); });
             } else if (fk.onDelete == FkAction::Cascade) {
                 // ⟵ Usar tombstones + avail list del hijo
-                auto& ffree = m_freeList[child];
+                QWriteLocker tl(&ct->lock);
+                touch(*ct);
+                auto& ffree = ct->freeList;
                 for (int r : hitRows) {
-                    if (r >= 0 && r < cvec.size() && !cvec[r].isEmpty()) {
-                        cvec[r].clear();
+                    if (ctab.isLive(r)) {
+                        ctab.kill(r);
                         ffree.push_back(r);
                     }
                 }
-                emit rowsChanged(child);
+                scheduleCompaction(ct->id);
+                post([this, child]{ emit rowsChanged(child); });
             }
         }
     }
@@ -1191,15 +1612,22 @@ bool DataModel::saveToJson(const QString& path, QString* err) const {
     QJsonObject root;
     root["version"] = 1;
 
-    // Tablas
+    // Puede correr fuera de la GUI (autosave): catálogo y cada tabla bajo lock de lectura
+    QReadLocker cl(&m_catalogLock);
+
+    // Tablas (orden estable por nombre)
+    QStringList names = m_tableIds.keys();
+    std::sort(names.begin(), names.end());
+
     QJsonArray jt;
-    for (auto it = m_schemas.constBegin(); it != m_schemas.constEnd(); ++it) {
-        const QString table = it.key();
-        const Schema  s     = it.value();
+    for (const QString& table : names) {
+        const TableReadLock lk = readTable(m_tableIds.value(table));
+        const TableData& t = *lk;
+        const Schema&    s = t.schema;
 
         QJsonObject tobj;
         tobj["name"]        = table;
-        tobj["description"] = m_tableDescriptions.value(table);
+        tobj["description"] = t.description;
 
         // Esquema
         QJsonArray js;
@@ -1224,24 +1652,29 @@ bool DataModel::saveToJson(const QString& path, QString* err) const {
 
         // Filas: guardamos también los tombstones como arrays de nulls
         QJsonArray jrows;
-        const auto& vec = m_data.value(table);
-        for (const auto& r : vec) {
+        const ColumnTable& tab = t.data;
+        for (int slot = 0; slot < tab.slotCount(); ++slot) {
             QJsonArray jrow;
-            if (r.isEmpty()) {
+            if (!tab.isLive(slot)) {
                 // tombstone: todos nulls
                 for (int i = 0; i < s.size(); ++i) jrow.append(QJsonValue());
             } else {
-                for (int i = 0; i < s.size(); ++i) {
-                    const QVariant v = (i < r.size()) ? r[i] : QVariant();
-                    jrow.append(cellToJson(s[i], v));
-                }
+                for (int i = 0; i < s.size(); ++i)
+                    jrow.append(cellToJson(s[i], tab.value(slot, i)));
             }
             jrows.append(jrow);
         }
         tobj["rows"] = jrows;
 
+        // Row ids estables (0 en los tombstones) + siguiente id a emitir
+        QJsonArray jids;
+        for (int slot = 0; slot < tab.slotCount(); ++slot)
+            jids.append(double(tab.rowIdAt(slot)));
+        tobj["rowIds"]    = jids;
+        tobj["nextRowId"] = double(tab.nextRowId());
+
         // Guardar también métricas de free list (opcional, solo informativo)
-        tobj["freeCount"] = m_freeList.value(table).size();
+        tobj["freeCount"] = t.freeList.size();
 
         jt.append(tobj);
     }
@@ -1249,10 +1682,12 @@ bool DataModel::saveToJson(const QString& path, QString* err) const {
 
     // Relaciones
     QJsonArray jrels;
-    for (auto it = m_fksByChild.constBegin(); it != m_fksByChild.constEnd(); ++it) {
-        for (const auto& fk : it.value()) {
-            const Schema cs = m_schemas.value(fk.childTable);
-            const Schema ps = m_schemas.value(fk.parentTable);
+    for (const QString& table : names) {
+        const TableReadLock child = readTable(m_tableIds.value(table));
+        for (const auto& fk : child->fks) {
+            const TableReadLock parent = readTable(fk.parentTable);
+            const Schema& cs = child->schema;
+            const Schema  ps = parent ? parent->schema : Schema();
             QJsonObject jr;
             jr["childTable"]      = fk.childTable;
             jr["childColName"]    = (fk.childCol  >=0 && fk.childCol  < cs.size()) ? cs[fk.childCol].name   : "";
@@ -1270,6 +1705,7 @@ bool DataModel::saveToJson(const QString& path, QString* err) const {
         QJsonArray jq;
         for (const auto& q : m_queries) {
             QJsonObject o; o["name"] = q.name; o["sql"] = q.sql;
+            if (q.materialized) o["materialized"] = true;
             jq.append(o);
         }
         root["queries"] = jq;
@@ -1299,13 +1735,16 @@ bool DataModel::loadFromJson(const QString& path, QString* err) {
     }
     const QJsonObject root = doc.object();
 
+    WriteScope ws(*this);
+
     // Limpia y reconstruye
-    m_schemas.clear();
-    m_data.clear();
-    m_tableDescriptions.clear();
-    m_fksByChild.clear();
-    m_freeList.clear();
-    m_queries.clear();
+    {
+        QWriteLocker cl(&m_catalogLock);
+        m_tables.clear();
+        m_tableIds.clear();
+        m_queries.clear();
+    }
+    m_compactPending.clear();
 
     // Tablas
     for (const auto& vtab : root.value("tables").toArray()) {
@@ -1334,15 +1773,16 @@ bool DataModel::loadFromJson(const QString& path, QString* err) {
             s.append(c);
         }
 
-        m_schemas.insert(name, s);
-        m_data.insert(name, {});
-        m_tableDescriptions.insert(name, tobj.value("description").toString());
-        m_freeList.insert(name, {});
+        TableData& t = addTable(name, s);
+        QWriteLocker tl(&t.lock);   // ya es visible por nombre: nadie la lee a medio cargar
+        touch(t);
+        t.description = tobj.value("description").toString();
 
         // filas
         const QJsonArray jrows = tobj.value("rows").toArray();
-        auto& vec = m_data[name];
-        auto& free = m_freeList[name];
+        const QJsonArray jids  = tobj.value("rowIds").toArray();   // ausente en archivos viejos
+        auto& tab = t.data;
+        auto& free = t.freeList;
         for (int ri = 0; ri < jrows.size(); ++ri) {
             const QJsonArray ja = jrows.at(ri).toArray();
 
@@ -1352,7 +1792,7 @@ bool DataModel::loadFromJson(const QString& path, QString* err) {
                 if (!(i < ja.size()) || !ja.at(i).isNull()) { allNull = false; break; }
             }
             if (allNull) {
-                vec.push_back(Record{}); // ⟵ tombstone
+                tab.appendTombstone(); // ⟵ tombstone
                 free.push_back(ri);
                 continue;
             }
@@ -1364,8 +1804,10 @@ bool DataModel::loadFromJson(const QString& path, QString* err) {
             }
             QString verr;
             validate(s, r, &verr);  // normaliza; si algo no convierte, queda null
-            vec.push_back(r);
+            tab.append(r, ri < jids.size() ? RowId(jids.at(ri).toDouble()) : kInvalidRowId);
         }
+        tab.setNextRowId(RowId(tobj.value("nextRowId").toDouble()));
+        if (!free.isEmpty()) scheduleCompaction(t.id);   // huecos heredados del archivo
     }
 
     // Relaciones (usa la API pública para respetar validaciones)
@@ -1384,13 +1826,14 @@ bool DataModel::loadFromJson(const QString& path, QString* err) {
     // Consultas guardadas
     for (const auto& vq : root.value("queries").toArray()) {
         const QJsonObject qo = vq.toObject();
-        SavedQuery q{ qo.value("name").toString(), qo.value("sql").toString() };
-        if (!q.name.trimmed().isEmpty())
+        SavedQuery q{ qo.value("name").toString(), qo.value("sql").toString(),
+                      qo.value("materialized").toBool() };
+        if (!q.name.trimmed().isEmpty()) {
+            QWriteLocker cl(&m_catalogLock);
             m_queries.push_back(q);
+        }
     }
 
-    m_lastIssuedId.clear();
-
     return true;
 }
 
@@ -1398,39 +1841,160 @@ bool DataModel::loadFromJson(const QString& path, QString* err) {
 
 int DataModel::compactTable(const QString& table, QString* err) {
     Q_UNUSED(err);
-    if (!m_schemas.contains(table)) return 0;
-    ensureTableExists(table);
-
-    auto& vec = m_data[table];
-    QVector<Record> compacted;
-    compacted.reserve(vec.size());
-    for (const auto& rec : vec) {
-        if (!rec.isEmpty()) compacted.push_back(rec);
-    }
-    int removed = vec.size() - compacted.size();
-    vec.swap(compacted);
-    m_freeList[table].clear();
-    emit rowsChanged(table);
+    WriteScope ws(*this);
+    TableData* t = tableMut(table);
+    if (!t) return 0;
+
+    int removed = 0;
+    {
+        QWriteLocker tl(&t->lock);
+        touch(*t);
+        removed = t->data.compact();
+        t->freeList.clear();
+    }
+    m_compactPending.remove(t->id);
+    post([this, table, removed]{
+        emit rowsChanged(table);
+        if (removed > 0) emit tableCompacted(table, removed);
+    });
     return removed;
 }
 
 DataModel::AvailStats DataModel::availStats(const QString& table) const {
     AvailStats st;
-    auto it = m_data.constFind(table);
-    if (it == m_data.constEnd()) return st;
+    const TableReadLock t = readTable(table);
+    if (!t) return st;
+    const ColumnTable* it = &t->data;
+
+    st.total   = it->slotCount();
+    st.deleted = it->slotCount() - it->liveCount();
+    st.bytes   = it->memoryBytes();
+    st.freeSlots = t->freeList.size();
+    return st;
+}
+
+/* ====================== Compactación automática ====================== */
+
+void DataModel::setCompactionPolicy(const CompactionPolicy& p) {
+    WriteScope ws(*this);
+    m_compactPolicy = p;
+    if (!p.enabled) post([this]{ if (m_compactTimer) m_compactTimer->stop(); });
+    else            scheduleCompaction(kInvalidTableId);
+}
 
-    st.total = it->size();
-    for (const auto& rec : *it) {
-        if (rec.isEmpty()) ++st.deleted;
+bool DataModel::needsCompaction(const QString& table) const {
+    const TableReadLock t = readTable(table);
+    return t && needsCompaction(*t);
+}
+
+bool DataModel::needsCompaction(const TableData& t) const {
+    const int total = t.data.slotCount();
+    const int dead  = total - t.data.liveCount();
+    if (dead <= 0 || dead < m_compactPolicy.minDeadSlots) return false;
+    return double(dead) / total >= m_compactPolicy.minDeadRatio;
+}
+
+// id válido => la tabla queda pendiente; en cualquier caso reinicia la espera
+// (cada escritura pospone la compactación hasta que haya inactividad)
+void DataModel::scheduleCompaction(TableId id) {
+    if (id != kInvalidTableId) m_compactPending.insert(id);
+    if (!m_compactPolicy.enabled || m_compactPending.isEmpty()) return;
+
+    // El timer vive en el hilo de DataModel: se arma al cerrar la escritura
+    const int delay = qMax(0, m_compactPolicy.idleDelayMs);
+    post([this, delay]{
+        if (!m_compactTimer) {
+            m_compactTimer = new QTimer(this);
+            m_compactTimer->setSingleShot(true);
+            connect(m_compactTimer, &QTimer::timeout, this, &DataModel::runIdleCompaction);
+        }
+        m_compactTimer->start(delay);
+    });
+}
+
+void DataModel::runIdleCompaction() {
+    WriteScope ws(*this);
+    if (!m_compactPolicy.enabled || m_compactRunning) return;   // la que termine reprograma
+
+    // Elegir la pendiente con más huecos; las que no llegan al umbral se descartan
+    // (volverán a la cola con el próximo borrado)
+    TableData* best = nullptr;
+    int bestDead = 0;
+    for (auto it = m_compactPending.begin(); it != m_compactPending.end(); ) {
+        TableData* t = tableMut(*it);
+        if (!t || !needsCompaction(*t)) { it = m_compactPending.erase(it); continue; }
+        const int dead = t->data.slotCount() - t->data.liveCount();
+        if (dead > bestDead) { best = t; bestDead = dead; }
+        ++it;
     }
-    auto itf = m_freeList.constFind(table);
-    st.freeSlots = (itf == m_freeList.constEnd()) ? 0 : itf->size();
-    return st;
+    if (!best) return;
+
+    // La copia comparte los datos (implicit sharing): compactarla en otro
+    // hilo no toca la tabla, que sigue disponible para lectores y escritores
+    ColumnTable copy;
+    {
+        QReadLocker tl(&best->lock);
+        copy = best->data;
+    }
+    const TableId id = best->id;
+    const quint64 version = best->version;
+    m_compactRunning = true;
+    m_compactPool.start([this, id, version, copy]() mutable {
+        QElapsedTimer clock;
+        clock.start();
+        const int removed = copy.compact();
+        const qint64 ms = clock.elapsed();
+        QMetaObject::invokeMethod(this, [this, id, version, copy, removed, ms]{
+            finishCompaction(id, version, copy, removed, ms);
+        }, Qt::QueuedConnection);
+    });
+}
+
+// En el hilo de DataModel: si la tabla cambió mientras se compactaba la copia
+// se descarta y queda pendiente (se reintenta con la próxima inactividad).
+// La versión no cambia: el contenido es el mismo (solo se renumeran slots), así
+// que la caché de resultados y las vistas materializadas siguen vigentes.
+void DataModel::finishCompaction(TableId id, quint64 version, ColumnTable packed, int removed, qint64 ms) {
+    WriteScope ws(*this);
+    m_compactRunning = false;
+    TableData* t = tableMut(id);
+    if (!t || !m_compactPolicy.enabled) {
+        // Tabla eliminada o compactación apagada: sigue con las demás pendientes
+        m_compactPending.remove(id);
+        if (m_compactPolicy.enabled && !m_compactPending.isEmpty()) m_compactTimer->start(0);
+        return;
+    }
+    if (t->version != version) {
+        scheduleCompaction(id);
+        return;
+    }
+
+    const QString name = t->name;
+    {
+        QWriteLocker tl(&t->lock);
+        t->data = std::move(packed);
+        t->freeList.clear();
+    }
+    m_compactPending.remove(id);
+    post([this, name, removed]{
+        emit rowsChanged(name);
+        if (removed > 0) emit tableCompacted(name, removed);
+    });
+
+    m_compactStats.runs           += 1;
+    m_compactStats.slotsReclaimed += removed;
+    m_compactStats.totalMs        += ms;
+    m_compactStats.lastMs          = ms;
+    m_compactStats.lastTable       = name;
+
+    // Siguiente tabla en otra vuelta del event loop
+    if (!m_compactPending.isEmpty()) m_compactTimer->start(0);
 }
 
 /* ====================== Consultas guardadas (API) ====================== */
 
 QStringList DataModel::queries() const {
+    QReadLocker cl(&m_catalogLock);
     QStringList names;
     names.reserve(m_queries.size());
     for (const auto& q : m_queries) names << q.name;
@@ -1439,16 +2003,19 @@ QStringList DataModel::queries() const {
 }
 
 QString DataModel::querySql(const QString& name) const {
+    QReadLocker cl(&m_catalogLock);
     for (const auto& q : m_queries) if (q.name.compare(name, Qt::CaseInsensitive) == 0) return q.sql;
     return QString();
 }
 
 bool DataModel::saveQuery(const QString& name, const QString& sql, QString* err) {
     // si existe => update, si no => add
+    WriteScope ws(*this);
+    QWriteLocker cl(&m_catalogLock);
     for (auto& q : m_queries) {
         if (q.name.compare(name.trimmed(), Qt::CaseInsensitive) == 0) {
             q.sql = sql;
-            emit queriesChanged();
+            post([this]{ emit queriesChanged(); });
             return true;
         }
     }
@@ -1458,6 +2025,8 @@ bool DataModel::saveQuery(const QString& name, const QString& sql, QString* err)
 bool DataModel::addQuery(const QString& name, const QString& sql, QString* err) {
     const QString n = name.trimmed();
     if (n.isEmpty()) { if (err) *err = tr("El nombre de la consulta no puede estar vacío."); return false; }
+    WriteScope ws(*this);
+    QWriteLocker cl(&m_catalogLock);
     for (const auto& q : m_queries) {
         if (q.name.compare(n, Qt::CaseInsensitive) == 0) {
             if (err) *err = tr("Ya existe una consulta llamada \"%1\".").arg(n);
@@ -1465,16 +2034,18 @@ bool DataModel::addQuery(const QString& name, const QString& sql, QString* err)
         }
     }
     m_queries.push_back({n, sql});
-    emit queriesChanged();
+    post([this]{ emit queriesChanged(); });
     return true;
 }
 
 bool DataModel::updateQuery(const QString& name, const QString& sql, QString* err) {
     const QString n = name.trimmed();
+    WriteScope ws(*this);
+    QWriteLocker cl(&m_catalogLock);
     for (auto& q : m_queries) {
         if (q.name.compare(n, Qt::CaseInsensitive) == 0) {
             q.sql = sql;
-            emit queriesChanged();
+            post([this]{ emit queriesChanged(); });
             return true;
         }
     }
@@ -1484,10 +2055,36 @@ bool DataModel::updateQuery(const QString& name, const QString& sql, QString* er
 
 bool DataModel::removeQuery(const QString& name, QString* err) {
     const QString n = name.trimmed();
+    WriteScope ws(*this);
+    QWriteLocker cl(&m_catalogLock);
     for (int i = 0; i < m_queries.size(); ++i) {
         if (m_queries[i].name.compare(n, Qt::CaseInsensitive) == 0) {
             m_queries.removeAt(i);
-            emit queriesChanged();
+            post([this]{ emit queriesChanged(); });
+            return true;
+        }
+    }
+    if (err) *err = tr("No existe la consulta \"%1\".").arg(n);
+    return false;
+}
+
+bool DataModel::isQueryMaterialized(const QString& name) const {
+    QReadLocker cl(&m_catalogLock);
+    for (const auto& q : m_queries)
+        if (q.name.compare(name.trimmed(), Qt::CaseInsensitive) == 0) return q.materialized;
+    return false;
+}
+
+bool DataModel::setQueryMaterialized(const QString& name, bool on, QString* err) {
+    const QString n = name.trimmed();
+    WriteScope ws(*this);
+    QWriteLocker cl(&m_catalogLock);
+    for (auto& q : m_queries) {
+        if (q.name.compare(n, Qt::CaseInsensitive) == 0) {
+            if (q.materialized != on) {
+                q.materialized = on;
+                post([this]{ emit queriesChanged(); });
+            }
             return true;
         }
     }
@@ -1495,4 +2092,14 @@ bool DataModel::removeQuery(const QString& name, QString* err) {
     return false;
 }
 
+/* ====================== Ejecución SQL ====================== */
 
+QVector<QMap<QString, QVariant>> DataModel::executeSql(const QString& sql) const {
+    // Adaptador por filas sobre SqlEngine (quien pueda, mejor recorre el SqlCursor)
+    QVector<QMap<QString, QVariant>> out;
+    SqlCursor cur;
+    if (!SqlEngine().query(sql, &cur)) return out;
+    while (cur.next()) out.push_back(cur.rowMap());
+    if (!cur.error().isEmpty()) return {};
+    return out;
+}
@@ -12,6 +12,15 @@
 #include <QSet>
 #include <QJsonObject>
 #include <QJsonArray>
+#include <QSharedPointer>
+#include <QReadWriteLock>
+#include <QMutex>
+#include <QThreadPool>
+#include <functional>
+
+#include "columnstore.h"
+
+class QTimer;
 
 /* ======================== Relaciones (FK) ======================== */
 enum class FkAction { Restrict, Cascade, SetNull };
@@ -52,13 +61,101 @@ struct FieldDef {
 
 // Un "Schema" es la lista de campos de una tabla (en el mismo orden que se muestran).
 using Schema = QList<FieldDef>;
-// Una fila de datos (mismo orden/longitud que el Schema)
-using Record = QVector<QVariant>;
+// Record (una fila de datos) se define en columnstore.h
+
+/* ========================= Handle de tabla ========================= */
+// Identificador estable de una tabla mientras exista (no se reutiliza tras un DROP)
+using TableId = int;
+constexpr TableId kInvalidTableId = -1;
+
+// Todo lo que DataModel guarda de una tabla, en un solo objeto: el nombre se
+// resuelve una vez (tableId) y luego se trabaja directo sobre la tabla.
+struct TableData {
+    TableId             id = kInvalidTableId;
+    QString             name;
+    QString             description;
+    Schema              schema;
+    ColumnTable         data;               // columnas tipadas + filas vivas + índices hash (PK/únicos)
+    QVector<int>        freeList;           // Avail List (LIFO) de slots tombstone
+    QVector<ForeignKey> fks;                // FKs donde esta tabla es la hija
+    qint64              lastIssuedId = 0;   // último Autonumeración emitido (no disminuye)
+    bool                autoCounterReady = false;
+    quint64             version = 0;        // sube con cada escritura (datos o esquema)
+
+    // Lectores concurrentes / un escritor (ver DataModel::readTable)
+    mutable QReadWriteLock lock{QReadWriteLock::Recursive};
+};
+
+// Lectura de una tabla desde cualquier hilo: mantiene el lock de lectura
+// (y la tabla viva, aunque se elimine) mientras exista el objeto.
+class TableReadLock {
+public:
+    TableReadLock() = default;
+    explicit TableReadLock(QSharedPointer<const TableData> t) : m_t(std::move(t)) {
+        if (m_t) m_t->lock.lockForRead();
+    }
+    TableReadLock(TableReadLock&& o) noexcept : m_t(std::move(o.m_t)) { o.m_t.reset(); }
+    TableReadLock& operator=(TableReadLock&& o) noexcept {
+        if (this != &o) { unlock(); m_t = std::move(o.m_t); o.m_t.reset(); }
+        return *this;
+    }
+    ~TableReadLock() { unlock(); }
+    Q_DISABLE_COPY(TableReadLock)
+
+    explicit operator bool() const { return !m_t.isNull(); }
+    const TableData* operator->() const { return m_t.data(); }
+    const TableData& operator*() const  { return *m_t; }
+    void unlock() { if (m_t) { m_t->lock.unlock(); m_t.reset(); } }
+
+private:
+    QSharedPointer<const TableData> m_t;
+};
+
+/* ============================ Snapshots ============================ */
+// Vista inmutable de un conjunto de tablas tomada en un mismo instante. Copiar
+// las tablas es barato: las columnas son contenedores Qt con copy-on-write, así
+// que el snapshot comparte los buffers y el escritor solo duplica la columna
+// que modifica después. Leerlo no toma ningún lock (ni bloquea a escritores).
+class DataSnapshot {
+public:
+    DataSnapshot() = default;
+
+    bool        isNull() const { return m_tables.isEmpty(); }
+    QStringList tables() const;
+    bool        contains(const QString& table) const { return m_tables.contains(table); }
+
+    const Schema&       schema(const QString& table) const;
+    const ColumnTable&  columnTable(const QString& table) const;
+    QVector<ForeignKey> relationshipsFor(const QString& table) const;
+    quint64             version(const QString& table) const;   // TableData::version al tomarlo
+
+private:
+    friend class DataModel;
+    struct Entry {
+        Schema              schema;
+        ColumnTable         data;
+        QVector<ForeignKey> fks;
+        quint64             version = 0;
+    };
+    QHash<QString, QSharedPointer<const Entry>> m_tables;
+};
 
 /* ======================= Consultas guardadas ======================= */
 struct SavedQuery {
     QString name;
     QString sql;
+    bool    materialized = false;   // resultado guardado y mantenido (MaterializedQueries)
+};
+
+/* ======================= Cambios fila a fila ======================= */
+// Lo que una escritura hizo en una tabla, fila por fila (ver rowsModified).
+// Los registros están en el orden del esquema, ya normalizados.
+struct RowChange {
+    enum class Kind : quint8 { Insert, Update, Delete };
+    Kind   kind = Kind::Insert;
+    RowId  row = kInvalidRowId;
+    Record before;      // Update / Delete
+    Record after;       // Insert / Update
 };
 
 /* ========================= Núcleo de datos ========================= */
@@ -94,9 +191,52 @@ public:
     QStringList tables() const;
     Schema schema(const QString& name) const;
 
+    /* ---------- Concurrencia ---------- */
+    // Un solo escritor a la vez (todas las mutaciones se serializan) y lectores
+    // concurrentes. Las referencias de columnTable()/table() son seguras
+    // en el hilo que escribe (la GUI); cualquier otro hilo lee con readTable().
+    // Las señales se emiten al terminar la escritura, siempre en el hilo de
+    // DataModel (la GUI), aunque la escritura venga de otro hilo.
+    TableReadLock readTable(TableId id) const;
+    TableReadLock readTable(const QString& name) const { return readTable(tableId(name)); }
+
+    // Vista consistente (todas las tablas si la lista está vacía) para lectores
+    // largos: reportes, exportaciones, consultas. Espera a que termine la
+    // escritura en curso; después nadie espera a nadie.
+    DataSnapshot snapshot(const QStringList& tables = {}) const;
+
+    /* ---------- Handles de tabla ---------- */
+    TableId tableId(const QString& name) const;           // kInvalidTableId si no existe
+    const TableData* table(TableId id) const;             // nullptr si no existe
+    const Schema& schemaRef(TableId id) const;            // sin copia (vacío si no existe)
+
     /* ---------- Datos ---------- */
     int  rowCount(const QString& name) const;
-    const QVector<Record>& rows(const QString& name) const;
+    // Acceso columnar tipado (por fila: record(slot) / value(slot, col))
+    const ColumnTable& columnTable(const QString& name) const;
+
+    // Mismas operaciones sobre un handle ya resuelto (las de nombre delegan en estas)
+    int  rowCount(TableId id) const;
+    const ColumnTable& columnTable(TableId id) const;
+    bool insertRow(TableId id, Record r, QString* err = nullptr, RowId* outId = nullptr);
+    bool updateRow(TableId id, int row, const Record& r, QString* err = nullptr);
+    bool removeRows(TableId id, const QList<int>& rows, QString* err = nullptr);
+
+    /* ---------- Identidad estable de filas ---------- */
+    // Cada fila viva tiene un RowId de 64 bits que no cambia al compactar ni se
+    // reutiliza; los slots (posición física) sí pueden cambiar.
+    RowId rowIdAt(TableId id, int slot) const;             // kInvalidRowId si es hueco
+    int   slotOf(TableId id, RowId row) const;             // -1 si ya no existe
+    QVector<RowId> rowIds(TableId id) const;               // ids vivos en orden de slot
+    Record record(TableId id, RowId row) const;            // Record vacío si no existe
+    bool updateRowById(TableId id, RowId row, const Record& r, QString* err = nullptr);
+    // UPDATE en bloque: valida todas las filas antes de escribir ninguna (todo o
+    // nada) y emite un solo rowsChanged. Las filas ya borradas se omiten.
+    bool updateRowsById(TableId id, const QVector<RowId>& rows, const QVector<Record>& recs,
+                        QString* err = nullptr);
+    bool removeRowsById(TableId id, const QList<RowId>& rows, QString* err = nullptr);
+    // Tipo físico de columna según FieldDef::type
+    static ColumnKind columnKindFor(const FieldDef& f);
 
     // NOTA: estas firmas se mantienen para no romper nada;
     // internamente usarán Avail List (reutilización de huecos + tombstones)
@@ -120,9 +260,35 @@ public:
         int total{0};     // tamaño del vector interno (incluye tombstones)
         int deleted{0};   // filas marcadas como tombstone
         int freeSlots{0}; // posiciones disponibles en la free list
+        qint64 bytes{0};  // memoria aproximada del almacenamiento columnar
+        // Fracción de slots que cada escaneo recorre en vano
+        double deadRatio() const { return total > 0 ? double(deleted) / total : 0.0; }
     };
     AvailStats availStats(const QString& table) const;
 
+    /* ---------- Compactación automática ---------- */
+    // Tras borrar filas, la tabla queda pendiente; cuando la app lleva
+    // idleDelayMs sin escrituras se compacta UNA tabla a la vez (la de más
+    // huecos) si supera ambos umbrales. La copia se compacta en otro hilo y
+    // se cambia bajo el lock de escritura si la tabla no se tocó entretanto.
+    struct CompactionPolicy {
+        bool   enabled      = true;
+        double minDeadRatio = 0.30;   // huecos / total
+        int    minDeadSlots = 256;    // por debajo no compensa renumerar
+        int    idleDelayMs  = 1500;   // espera desde la última escritura
+    };
+    struct CompactionStats {
+        qint64  runs{0};             // compactaciones automáticas hechas
+        qint64  slotsReclaimed{0};   // huecos eliminados en total
+        qint64  totalMs{0};          // tiempo acumulado compactando
+        qint64  lastMs{0};
+        QString lastTable;
+    };
+    void setCompactionPolicy(const CompactionPolicy& p);
+    CompactionPolicy compactionPolicy() const { return m_compactPolicy; }
+    CompactionStats  compactionStats() const  { return m_compactStats; }
+    bool needsCompaction(const QString& table) const;   // ¿supera los umbrales ahora?
+
     /* ---------- Consultas guardadas (API) ---------- */
     QStringList queries() const;                        // nombres ordenados
     QString querySql(const QString& name) const;        // SQL por nombre (vacío si no existe)
@@ -135,10 +301,13 @@ public:
     bool updateQuery(const QString& name, const QString& sql, QString* err = nullptr);
     bool removeQuery(const QString& name, QString* err = nullptr);
 
-    /* ---------- (Opcional) Ejecución SQL genérica para Reportes ---------- */
-    // Si tu backend lo soporta, puedes implementar este método.
-    // El ReportEngine lo invoca de forma segura vía QMetaObject::invokeMethod(),
-    // pero declararlo aquí permite enlazar estáticamente cuando exista.
+    // Consulta materializada: su resultado se guarda y se mantiene al día
+    bool isQueryMaterialized(const QString& name) const;
+    bool setQueryMaterialized(const QString& name, bool on, QString* err = nullptr);
+
+    /* ---------- Ejecución SQL ---------- */
+    // SELECT materializado fila por fila (vacío si falla). El motor real es
+    // SqlEngine (sqlengine.h), que devuelve un SqlCursor en streaming.
     QVector<QMap<QString, QVariant>> executeSql(const QString& sql) const;
 
     /* ---------- Reportes (persistencia para ReportsPage/Wizard) ---------- */
@@ -154,6 +323,13 @@ signals:
     void tableDropped(const QString& name);
     void schemaChanged(const QString& name, const Schema& s);
     void rowsChanged(const QString& name);
+    // Detalle de rowsChanged para quien mantiene resultados derivados: sale
+    // justo antes y solo si hay receptores. fromVersion -> toVersion es el
+    // salto de TableData::version de esa escritura; los cambios que no lo
+    // informan (cascadas, ALTER, carga) se notan porque la versión ya no encadena.
+    void rowsModified(const QString& name, quint64 fromVersion, quint64 toVersion,
+                      const QVector<RowChange>& changes);
+    void tableCompacted(const QString& name, int removed);   // manual o automática
 
     void queriesChanged();  // cuando se agregan/actualizan/eliminan consultas
 
@@ -173,11 +349,9 @@ private:
     // Normaliza/convierte un valor según FieldDef::type (usada por validate)
     bool normalizeValue(const FieldDef& col, QVariant& v, QString* err) const;
 
-    // Último ID emitido por tabla (no disminuye cuando borras)
-    QHash<QString, qint64> m_lastIssuedId;
-
     // Inicializa el contador al máximo actual de la tabla si aún no está
-    void ensureAutoCounterInitialized(const QString& table);
+    void ensureAutoCounterInitialized(TableData& t);
+    QVariant nextAutoNumber(TableData& t);
 
     // Normaliza etiqueta de tipo (igual que en UI): "numero","moneda","fecha_hora", etc.
     QString normType(const QString& t) const;
@@ -188,8 +362,14 @@ private:
     int  fieldIndex(const Schema& s, const QString& name) const;  // alias explícito
     int  fieldIndex(const QString& table, const QString& name) const;
 
+    // Resolución de handles (internos, con acceso de escritura)
+    TableData*       tableMut(TableId id);
+    TableData*       tableMut(const QString& name) { return tableMut(tableId(name)); }
+
     // ¿Campo es único? (PK o índice "sin duplicados")
     bool isUniqueField(const FieldDef& f) const;
+    // ¿Campo indexado? (PK o "Indexado: Sí", con o sin duplicados)
+    bool isIndexedField(const FieldDef& f) const;
 
     // Comparación tolerante (útil para double / nulos)
     bool sameValue(const QVariant& a, const QVariant& b) const;
@@ -198,51 +378,83 @@ private:
     bool validateRecordCore(const Schema& s, const Record& r, QString* err) const;
 
     // Verifica unicidad (PK/unique) respecto a los datos actuales
-    bool checkUniqueness(const QString& table, const Schema& s,
-                         const Record& candidate, int skipRow, QString* err) const;
+    bool checkUniqueness(const TableData& t, const Record& candidate, int skipRow, QString* err) const;
+
+    // Unicidad de un lote de actualizaciones (entre sí y contra las demás filas)
+    bool checkUniquenessBatch(const TableData& t, const QVector<int>& targets,
+                              const QVector<Record>& recs, QString* err) const;
 
     // Verifica FKs del registro (child → parent existente si no es NULL)
-    bool checkForeignKeys(const QString& table, const Schema& s,
-                          const Record& candidate, QString* err) const;
+    bool checkForeignKeys(const TableData& t, const Record& candidate, QString* err) const;
 
     // Autonumeración: asigna MAX+1 si el valor viene vacío
-    void assignAutonumberIfNeeded(const QString& table, const Schema& s, Record& r);
+    void assignAutonumberIfNeeded(TableData& t, Record& r);
 
     /* ----------------- Otros helpers existentes ----------------- */
     bool isValidTableName(const QString& n) const;
-    bool ensureUniquePk(const QString& name, int pkCol, const QVariant& pkVal,
+    bool ensureUniquePk(const TableData& t, int pkCol, const QVariant& pkVal,
                         int ignoreRow, QString* err) const;
 
-    // Por tabla hija
-    QHash<QString, QVector<ForeignKey>> m_fksByChild;
-
     // Verifica FKs en operaciones de escritura (interno clásico)
-    bool checkFksOnWrite(const QString& childTable, const Record& r, QString* err) const;
-
-    // Maneja cascadas/bloqueos ante eliminación de padres (según onDelete)
-    bool handleParentDeletes(const QString& parentTable, const QList<int>& parentRows,
-                             QString* err);
-
-    /* ----------------- Avail List internals ----------------- */
-    // Free list por tabla: contiene índices de filas "tombstone" reutilizables (LIFO).
-    QMap<QString, QVector<int>> m_freeList;
+    bool checkFksOnWrite(const TableData& child, const Record& r, QString* err) const;
 
-    // Consideramos "tombstone" a un Record vacío -> hueco reutilizable en Avail List.
-    static inline bool isTombstone(const Record& r) { return r.isEmpty(); }
+    // Núcleo de updateRow/updateRowsById (slots vivos, registros completos)
+    bool updateSlots(TableId id, const QVector<int>& targets, QVector<Record> recs, QString* err);
 
-    // Asegura que existan entradas para tabla en mapas internos (schemas, data, freeList).
-    void ensureTableExists(const QString& table);
+    // Maneja cascadas/bloqueos ante eliminación de padres (según onDelete)
+    bool handleParentDeletes(TableData& parent, const QList<int>& parentRows, QString* err);
+
+    // Construye una tabla columnar vacía con los tipos físicos del esquema
+    // (e índices sobre la PK y los campos indexados, con o sin duplicados)
+    ColumnTable makeColumnTable(const Schema& s) const;
+
+    // Alta de una tabla nueva (id nuevo) y su registro por nombre
+    TableData& addTable(const QString& name, const Schema& s);
+
+    // Sección de escritura (mutex del escritor + señales diferidas), ver datamodel.cpp
+    struct WriteScope;
+    void beginWrite();
+    void endWrite();
+    void post(std::function<void()> fn);                 // emite al cerrar la escritura
+    void deliver(const QVector<std::function<void()>>& fns);
+    // Nueva versión para la tabla (reloj global: nunca se repite, ni tras recargar)
+    void touch(TableData& t) { t.version = ++m_versionClock; }
+    // ¿Alguien escucha rowsModified? (si no, no se copian las filas tocadas)
+    bool tracksRowChanges() const;
+
+    // Compactación automática (ver CompactionPolicy)
+    bool needsCompaction(const TableData& t) const;
+    void scheduleCompaction(TableId id);
+    void runIdleCompaction();
+    void finishCompaction(TableId id, quint64 version, ColumnTable packed, int removed, qint64 ms);
 
 private:
-    QMap<QString, Schema>          m_schemas; // tabla -> schema
-    QMap<QString, QVector<Record>> m_data;    // tabla -> filas (incluye tombstones)
-    QMap<QString, QString>         m_tableDescriptions; // nombre -> descripción
+    QVector<QSharedPointer<TableData>> m_tables;   // por TableId (nulo si se eliminó)
+    QHash<QString, TableId>            m_tableIds; // nombre -> id
+
+    // Concurrencia: catálogo (m_tables/m_tableIds/m_queries) + escritor único
+    mutable QReadWriteLock            m_catalogLock{QReadWriteLock::Recursive};
+    mutable QRecursiveMutex           m_writeMutex;   // snapshot() también lo toma (corte consistente)
+    int                               m_writeDepth = 0;
+    QVector<std::function<void()>>    m_pendingSignals;
+    quint64                           m_versionClock = 0;
+
+    // Compactación automática
+    CompactionPolicy m_compactPolicy;
+    CompactionStats  m_compactStats;
+    QSet<TableId>    m_compactPending;
+    QTimer*          m_compactTimer = nullptr;   // single-shot, se crea al primer borrado
+    bool             m_compactRunning = false;   // hay una copia compactándose en m_compactPool
 
     // Consultas guardadas
     QVector<SavedQuery>            m_queries;
 
     // Reportes guardados (nombre -> JSON definido por ReportDef::toJson())
     QMap<QString, QJsonObject>     m_reports;
+
+    // Último: al destruirse espera a la compactación en curso (que todavía
+    // encola su resultado en este objeto)
+    QThreadPool                    m_compactPool;
 };
 
 #endif // DATAMODEL_H
@@ -0,0 +1,181 @@
+#include "matview.h"
+#include "sqlengine.h"
+#include "datamodel.h"
+
+#include <QMutexLocker>
+
+static QString keyOf(const QString& name) { return name.trimmed().toLower(); }
+
+/* ====================== Singleton ====================== */
+MaterializedQueries& MaterializedQueries::instance()
+{
+    static MaterializedQueries inst;
+    return inst;
+}
+
+MaterializedQueries::MaterializedQueries()
+{
+    DataModel& dm = DataModel::instance();
+    QObject::connect(&dm, &DataModel::rowsModified, &dm,
+                     [this](const QString& table, quint64 from, quint64 to, const QVector<RowChange>& changes) {
+        onRowsModified(table, from, to, changes);
+    });
+    // Con otro esquema la vista enlazada ya no sirve: se recalcula al leer
+    auto drop = [this](const QString& table) { invalidateTable(table); };
+    QObject::connect(&dm, &DataModel::tableDropped,  &dm, drop);
+    QObject::connect(&dm, &DataModel::schemaChanged, &dm, [this](const QString& table, const Schema&) {
+        invalidateTable(table);
+    });
+    QObject::connect(&dm, &DataModel::queriesChanged, &dm, [this]{ sync(); });
+    sync();
+}
+
+/* ========================= Consulta ========================= */
+bool MaterializedQueries::fresh(const Entry& e, const DataSnapshot& snap)
+{
+    if (e.versions.isEmpty()) return false;
+    for (auto v = e.versions.cbegin(); v != e.versions.cend(); ++v)
+        if (!snap.contains(v.key()) || snap.version(v.key()) != v.value()) return false;
+    return true;
+}
+
+SqlResultPtr MaterializedQueries::result(const QString& name, const DataSnapshot& snap, QString* err)
+{
+    const QString key = keyOf(name);
+    QString sql;
+    {
+        QMutexLocker lock(&m_mutex);
+        auto it = m_entries.find(key);
+        if (it == m_entries.end()) return {};
+        if (fresh(*it, snap)) {
+            if (!it->result && it->view) {
+                QSharedPointer<SqlResult> res(new SqlResult);
+                res->names = it->view->columnNames();
+                res->rows = it->view->rows();
+                it->result = res;
+            }
+            if (it->result) return it->result;
+        }
+        sql = it->sql;
+    }
+
+    // Cálculo completo, fuera del candado (puede tardar)
+    SqlStatement st;
+    if (!SqlParser::parse(sql, &st, err)) return {};
+    if (st.kind != SqlStatement::Kind::Select) {
+        if (err) *err = "Solo se pueden materializar sentencias SELECT.";
+        return {};
+    }
+    SqlEngine engine;
+    QSharedPointer<SqlIncrementalView> view;
+    QSharedPointer<SqlResult> res(new SqlResult);
+    if (SqlIncrementalView::supports(st.select)) {
+        view.reset(new SqlIncrementalView);
+        if (!view->build(st.select, snap, err)) return {};
+        res->names = view->columnNames();
+        res->rows = view->rows();
+    } else {
+        SqlCursor cur;
+        if (!engine.query(st.select, snap, &cur, err)) return {};
+        res->names = cur.columnNames();
+        while (cur.next()) res->rows.push_back(cur.row());
+        if (!cur.error().isEmpty()) {
+            if (err) *err = cur.error();
+            return {};
+        }
+    }
+    QHash<QString, quint64> versions;
+    const QStringList tables = engine.tablesOf(st);
+    for (const QString& t : tables)
+        if (snap.contains(t)) versions.insert(t, snap.version(t));
+
+    // Se guarda salvo que ya haya uno más nuevo (las versiones nunca retroceden)
+    QMutexLocker lock(&m_mutex);
+    ++m_rebuilds;
+    auto it = m_entries.find(key);
+    if (it != m_entries.end() && it->sql == sql) {
+        bool newer = true;
+        for (auto v = versions.cbegin(); v != versions.cend() && newer; ++v)
+            newer = it->versions.value(v.key()) <= v.value();
+        if (newer) {
+            it->tables = tables;
+            it->versions = versions;
+            it->view = view;
+            it->result = res;
+        }
+    }
+    return res;
+}
+
+bool MaterializedQueries::isIncremental(const QString& name)
+{
+    SqlStatement st;
+    return SqlParser::parse(DataModel::instance().querySql(name), &st)
+        && st.kind == SqlStatement::Kind::Select && SqlIncrementalView::supports(st.select);
+}
+
+/* ======================= Mantenimiento ======================= */
+void MaterializedQueries::onRowsModified(const QString& table, quint64 fromVersion, quint64 toVersion,
+                                         const QVector<RowChange>& changes)
+{
+    QMutexLocker lock(&m_mutex);
+    for (Entry& e : m_entries) {
+        if (!e.versions.contains(table)) continue;      // sin calcular o no la lee
+        const quint64 have = e.versions.value(table);
+        if (have > fromVersion) continue;               // ya calculada sobre un snapshot posterior
+        if (have == fromVersion && e.view && e.view->apply(changes)) {
+            e.versions[table] = toVersion;
+            e.result.reset();                            // las filas se arman al leer
+            ++m_applied;
+            continue;
+        }
+        // Se perdió algún cambio o no se pudo deducir: se recalcula al leer
+        e.versions.clear();
+        e.view.reset();
+        e.result.reset();
+    }
+}
+
+void MaterializedQueries::invalidateTable(const QString& table)
+{
+    QMutexLocker lock(&m_mutex);
+    for (Entry& e : m_entries) {
+        if (!e.tables.contains(table, Qt::CaseInsensitive)) continue;
+        e.versions.clear();
+        e.view.reset();
+        e.result.reset();
+    }
+}
+
+void MaterializedQueries::sync()
+{
+    DataModel& dm = DataModel::instance();
+    QHash<QString, QString> wanted;     // clave -> SQL
+    for (const QString& n : dm.queries())
+        if (dm.isQueryMaterialized(n)) wanted.insert(keyOf(n), dm.querySql(n));
+
+    QMutexLocker lock(&m_mutex);
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        if (wanted.value(it.key()) != it->sql) it = m_entries.erase(it);
+        else ++it;
+    }
+    for (auto w = wanted.cbegin(); w != wanted.cend(); ++w) {
+        if (m_entries.contains(w.key())) continue;
+        Entry e;
+        e.sql = w.value();
+        m_entries.insert(w.key(), e);
+    }
+}
+
+/* ========================= Métricas ========================= */
+quint64 MaterializedQueries::incrementalUpdates() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_applied;
+}
+
+quint64 MaterializedQueries::rebuilds() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_rebuilds;
+}
@@ -0,0 +1,63 @@
+#ifndef MATVIEW_H
+#define MATVIEW_H
+
+#include <QHash>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "sqlcache.h"
+
+class DataSnapshot;
+class SqlIncrementalView;
+struct RowChange;
+
+/* ===================== Consultas materializadas ===================== */
+// Resultado guardado de cada consulta marcada con
+// DataModel::setQueryMaterialized. Las que SqlIncrementalView admite (una
+// tabla, filtro/proyección o agregados) se mantienen al día con
+// DataModel::rowsModified a medida que la tabla cambia; las demás, o las que
+// pierden el hilo de versiones (cascadas, ALTER, recarga, MIN/MAX que no se
+// puede deducir), se recalculan enteras la próxima vez que alguien las lee.
+// Igual que SqlResultCache, cada resultado va fechado con la versión de sus
+// tablas y solo se entrega si coincide con la del snapshot del lector. Se
+// puede leer desde cualquier hilo.
+class MaterializedQueries {
+public:
+    static MaterializedQueries& instance();
+
+    // Resultado de la consulta 'name' coherente con 'snap'. Nulo si no está
+    // materializada (el llamador la ejecuta como siempre) o si falla (*err).
+    SqlResultPtr result(const QString& name, const DataSnapshot& snap, QString* err = nullptr);
+
+    static bool isIncremental(const QString& name);  // ¿se mantiene fila a fila?
+    quint64 incrementalUpdates() const;               // lotes aplicados sin recalcular
+    quint64 rebuilds() const;                         // cálculos completos
+
+private:
+    MaterializedQueries();
+    Q_DISABLE_COPY(MaterializedQueries)
+
+    struct Entry {
+        QString                             sql;
+        QStringList                         tables;
+        QHash<QString, quint64>             versions;   // tabla -> versión del resultado (vacío: sin calcular)
+        QSharedPointer<SqlIncrementalView>  view;       // nulo: se recalcula entera
+        SqlResultPtr                        result;     // nulo con vista: se arma al leer
+    };
+
+    void sync();   // altas, bajas y cambios de SQL según las consultas guardadas
+    void onRowsModified(const QString& table, quint64 fromVersion, quint64 toVersion,
+                        const QVector<RowChange>& changes);
+    void invalidateTable(const QString& table);
+    static bool fresh(const Entry& e, const DataSnapshot& snap);
+
+    mutable QMutex          m_mutex;
+    QHash<QString, Entry>   m_entries;      // nombre en minúsculas
+    quint64                 m_applied = 0;
+    quint64                 m_rebuilds = 0;
+};
+
+#endif // MATVIEW_H
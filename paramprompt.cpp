@@ -0,0 +1,21 @@
+#include "paramprompt.h"
+#include "sqlengine.h"
+
+#include <QInputDialog>
+#include <QLineEdit>
+
+bool askQueryParameters(QWidget* parent, const QStringList& names, QVariantMap* values)
+{
+    for (const QString& n : names) {
+        bool given = false;
+        for (auto v = values->cbegin(); v != values->cend() && !given; ++v)
+            given = v.key().compare(n, Qt::CaseInsensitive) == 0;
+        if (given) continue;
+        bool ok = false;
+        const QString text = QInputDialog::getText(parent, "Introducir valor del parámetro", n,
+                                                   QLineEdit::Normal, QString(), &ok);
+        if (!ok) return false;
+        values->insert(n, SqlPreparedQuery::parseValue(text));
+    }
+    return true;
+}
@@ -0,0 +1,15 @@
+#ifndef PARAMPROMPT_H
+#define PARAMPROMPT_H
+
+#include <QStringList>
+#include <QVariantMap>
+
+class QWidget;
+
+// Pide uno por uno los parámetros de una consulta que aún no tienen valor en
+// *values, como Access al abrir una consulta con [Parámetros]. Lo escrito se
+// lee como un literal SQL (SqlPreparedQuery::parseValue): número, fecha
+// yyyy-MM-dd, TRUE/FALSE o texto; vacío es NULL. false si se cancela.
+bool askQueryParameters(QWidget* parent, const QStringList& names, QVariantMap* values);
+
+#endif // PARAMPROMPT_H
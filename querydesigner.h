@@ -3,8 +3,9 @@
 #include "datamodel.h"
 
 
-class QComboBox; class QListWidget; class QTableWidget;
+class QComboBox; class QListWidget; class QTableWidget; class QTableView;
 class QToolButton; class QSpinBox; class QLabel; class QLineEdit;
+class SqlResultModel;
 
 /**
  * Constructor visual de SELECT (Access-like):
@@ -37,11 +38,6 @@ private:
     QString buildSql() const;
     void execSelectSql(const QString& sql);
 
-    // helpers de comparación (copiados de QueryPage)
-    static int schemaFieldIndex(const Schema& s, const QString& name);
-    static int cmpVar(const QVariant& a, const QVariant& b);
-    static bool equalVar(const QVariant& a, const QVariant& b);
-
 private:
     QComboBox*   cbTable_;
     QListWidget* lwColumns_;
@@ -50,6 +46,8 @@ private:
     QToolButton* btnDesc_;
     QSpinBox*    spLimit_;
     QLineEdit*   edName_;
-    QTableWidget* grid_;
+    QTableView*  grid_;
+    SqlResultModel* results_;   // lee del cursor a medida que se desplaza la vista
     QLabel*      status_;
+    QString      shownSql_;     // SQL de los resultados visibles (para el status)
 };
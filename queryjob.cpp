@@ -0,0 +1,88 @@
+#include "queryjob.h"
+#include "sqlcache.h"
+
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QThreadPool>
+
+SqlQueryJob::SqlQueryJob(QObject* parent) : QObject(parent), m_state(new State)
+{
+    m_timeout.setSingleShot(true);
+    connect(&m_timeout, &QTimer::timeout, this, [this]{
+        m_state->timedOut = true;
+        cancel();
+    });
+    connect(this, &SqlQueryJob::finished, this, [this]{
+        m_timeout.stop();
+        deleteLater();
+    });
+}
+
+SqlQueryJob* SqlQueryJob::start(const QString& sql, const SqlSelect& q, const DataSnapshot& snap,
+                                const QStringList& tables, int timeoutMs)
+{
+    auto* job = new SqlQueryJob;
+    if (timeoutMs > 0) job->m_timeout.start(timeoutMs);
+    QThreadPool::globalInstance()->start([job, sql, q, snap, tables]{ job->run(sql, q, snap, tables); });
+    return job;
+}
+
+void SqlQueryJob::cancel()
+{
+    QMutexLocker lock(&m_state->mutex);
+    m_state->cancelRequested = true;
+    m_state->cursor.cancel();
+}
+
+/* ==================== Hilo de ejecución ==================== */
+// No toca el objeto después de emitir finished (se borra al recibirla)
+void SqlQueryJob::run(const QString& sql, const SqlSelect& q, const DataSnapshot& snap,
+                      const QStringList& tables)
+{
+    const QSharedPointer<State> st = m_state;
+    SqlCursor cur;
+    QString err;
+    if (!SqlEngine().query(q, snap, &cur, &err)) {
+        emit finished(Outcome::Failed, 0, err);
+        return;
+    }
+    {
+        QMutexLocker lock(&st->mutex);
+        st->cursor = cur;
+        if (st->cancelRequested) cur.cancel();
+    }
+    emit columnsReady(cur.columnNames());
+
+    QSharedPointer<SqlResult> all(new SqlResult);
+    all->names = cur.columnNames();
+    QVector<Record> batch;
+    int limit = kFirstBatch;
+    QElapsedTimer sinceFlush;
+    sinceFlush.start();
+    while (cur.next()) {
+        batch.push_back(cur.row());
+        if (batch.size() >= limit || sinceFlush.elapsed() >= kFlushMs) {
+            all->rows += batch;                 // los Record se comparten, no se copian
+            emit rowsReady(batch);
+            batch.clear();
+            limit = kBatch;
+            sinceFlush.restart();
+        }
+    }
+    if (!batch.isEmpty()) {
+        all->rows += batch;
+        emit rowsReady(batch);
+    }
+
+    const qint64 n = all->rows.size();
+    if (cur.isCancelled()) {
+        emit finished(st->timedOut ? Outcome::TimedOut : Outcome::Cancelled, n, QString());
+        return;
+    }
+    if (!cur.error().isEmpty()) {
+        emit finished(Outcome::Failed, n, cur.error());
+        return;
+    }
+    if (!q.explain) SqlResultCache::instance().store(sql, snap, tables, all);
+    emit finished(Outcome::Done, n, QString());
+}
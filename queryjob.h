@@ -0,0 +1,58 @@
+#ifndef QUERYJOB_H
+#define QUERYJOB_H
+
+#include <QObject>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QTimer>
+#include <QVector>
+#include <atomic>
+
+#include "sqlengine.h"
+
+/* ===================== SELECT en segundo plano ===================== */
+// Ejecuta un SELECT en un hilo del pool global y entrega las filas por lotes
+// (rowsReady) a medida que el motor las produce: el primer lote sale con pocas
+// filas para que la vista muestre algo enseguida. cancel() y el tiempo máximo
+// cortan la ejecución a través del cursor (SqlCursor::cancel). Las señales
+// llegan por cola al hilo del objeto; el objeto se borra solo tras finished.
+class SqlQueryJob : public QObject {
+    Q_OBJECT
+public:
+    enum class Outcome { Done, Cancelled, TimedOut, Failed };
+    Q_ENUM(Outcome)
+
+    static constexpr int kFirstBatch = 100;    // filas del primer lote
+    static constexpr int kBatch      = 5000;   // filas de los siguientes
+    static constexpr int kFlushMs    = 100;    // un lote sale al menos cada tanto
+
+    // 'tables' son las que lee el SELECT: con el resultado completo se guarda
+    // en SqlResultCache (salvo EXPLAIN). timeoutMs <= 0: sin límite.
+    static SqlQueryJob* start(const QString& sql, const SqlSelect& q, const DataSnapshot& snap,
+                              const QStringList& tables, int timeoutMs = 0);
+
+    void cancel();
+
+signals:
+    void columnsReady(const QStringList& names);
+    void rowsReady(const QVector<Record>& rows);
+    void finished(SqlQueryJob::Outcome outcome, qint64 rows, const QString& err);
+
+private:
+    explicit SqlQueryJob(QObject* parent = nullptr);
+
+    // Compartido con el hilo que ejecuta (puede sobrevivir al objeto un instante)
+    struct State {
+        QMutex            mutex;
+        SqlCursor         cursor;               // copia para cancelar desde aquí
+        bool              cancelRequested = false;
+        std::atomic<bool> timedOut{false};
+    };
+    void run(const QString& sql, const SqlSelect& q, const DataSnapshot& snap, const QStringList& tables);
+
+    QSharedPointer<State> m_state;
+    QTimer                m_timeout;
+};
+
+#endif // QUERYJOB_H
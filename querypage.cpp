@@ -1,117 +1,25 @@
 #include "querypage.h"
+#include "sqlengine.h"
+#include "sqlcache.h"
+#include "resultmodel.h"
+#include "queryjob.h"
+#include "matview.h"
+#include "paramprompt.h"
 
 #include <QVBoxLayout>
 #include <QHBoxLayout>
-#include <QRegularExpression>
 #include <QHeaderView>
 #include <QMessageBox>
 #include <QPlainTextEdit>
 #include <QToolButton>
+#include <QSpinBox>
 #include <QComboBox>
-#include <QTableWidget>
+#include <QTableView>
 #include <QLabel>
 #include <QKeyEvent>
 #include <QToolBar>
 #include <QAction>
 #include <QInputDialog>
-#include <algorithm>
-
-static bool isTomb(const Record& r){ return r.isEmpty(); }
-
-// ---------- normalización de tokens de columna ----------
-static QString normalizeColToken(QString t){
-    t = t.trimmed();
-    // quita envoltorios: [Col], "Col", `Col`
-    if ((t.startsWith('[') && t.endsWith(']')) ||
-        (t.startsWith('"') && t.endsWith('"')) ||
-        (t.startsWith('`') && t.endsWith('`'))) {
-        t = t.mid(1, t.size()-2);
-    }
-    // si viene calificado Tabla.Columna, quedarnos con la parte derecha
-    int dot = t.lastIndexOf('.');
-    if (dot > 0) t = t.mid(dot+1).trimmed();
-    return t;
-}
-
-// -------- helpers locales (evitan usar métodos privados de DataModel) --------
-static int schemaFieldIndex(const Schema& s, const QString& name){
-    const QString n = normalizeColToken(name);
-    for (int i = 0; i < s.size(); ++i)
-        if (s[i].name.compare(n, Qt::CaseInsensitive) == 0) return i;
-    return -1;
-}
-static int cmpVar(const QVariant& a, const QVariant& b){
-    // Nulls
-    if(!a.isValid() && !b.isValid()) return 0;
-    if(!a.isValid()) return -1;
-    if(!b.isValid()) return 1;
-
-    // Fecha
-    if(a.userType()==QMetaType::QDate || b.userType()==QMetaType::QDate){
-        QDate da = (a.userType()==QMetaType::QDate)? a.toDate() : QDate::fromString(a.toString(), "yyyy-MM-dd");
-        QDate db = (b.userType()==QMetaType::QDate)? b.toDate() : QDate::fromString(b.toString(), "yyyy-MM-dd");
-        if(!da.isValid() || !db.isValid()){
-            // fallback string si alguna no parsea
-            return QString::compare(a.toString(), b.toString(), Qt::CaseInsensitive);
-        }
-        if(da<db) return -1; if(da>db) return 1; return 0;
-    }
-
-    // Numérico
-    bool okA=false, okB=false;
-    double da=a.toDouble(&okA), db=b.toDouble(&okB);
-    if(okA && okB){
-        if(da<db) return -1; if(da>db) return 1; return 0;
-    }
-
-    // Enteros largos
-    if(a.typeId()==QMetaType::LongLong || b.typeId()==QMetaType::LongLong){
-        qlonglong ia=a.toLongLong(&okA), ib=b.toLongLong(&okB);
-        if(okA && okB){ if(ia<ib) return -1; if(ia>ib) return 1; return 0; }
-    }
-
-    // Por defecto: string case-insensitive
-    return QString::compare(a.toString(), b.toString(), Qt::CaseInsensitive);
-}
-static bool equalVar(const QVariant& a, const QVariant& b){
-    if(!a.isValid() && !b.isValid()) return true;
-    return cmpVar(a,b)==0;
-}
-
-// -------- util de parsing --------
-static QString takeAfter(const QString& src, const QString& kw){
-    int i = src.indexOf(kw, 0, Qt::CaseInsensitive);
-    if(i<0) return {};
-    return src.mid(i+kw.size()).trimmed();
-}
-static QList<QString> tokenize(const QString& s){
-    QList<QString> out; QString cur; bool inStr=false;
-    for(int i=0;i<s.size();++i){
-        QChar c=s[i];
-        if(inStr){
-            cur+=c;
-            if(c=='\''){ out<<cur; cur.clear(); inStr=false; }
-        } else if(c=='\''){
-            if(!cur.isEmpty()){ out<<cur; cur.clear(); }
-            cur="\'"; inStr=true;
-        } else if(QString("(),*=<>!+-/").contains(c) || c.isSpace()){
-            if(!cur.isEmpty()){ out<<cur; cur.clear(); }
-            if(!c.isSpace()) out<<QString(c);
-        } else cur+=c;
-    }
-    if(!cur.isEmpty()) out<<cur;
-    return out;
-}
-
-// -------- resolver nombre real de tabla ignorando mayúsc/minúsc --------
-static QString resolveTableNameCI(const QString& raw) {
-    auto &dm = DataModel::instance();
-    for (const QString& t : dm.tables()) {
-        if (QString::compare(t, raw, Qt::CaseInsensitive) == 0)
-            return t;
-    }
-    return QString();
-}
 
 // ===================== QueryPage =====================
 QueryPage::QueryPage(QWidget* parent) : QWidget(parent) {
@@ -137,31 +45,48 @@ QueryPage::QueryPage(QWidget* parent) : QWidget(parent) {
     m_sql = new QPlainTextEdit;
     m_sql->setPlaceholderText(
         "-- SQL minimal soportado\n"
-        "SELECT *|col1,col2 FROM tabla [WHERE col op valor [AND col op valor ...]] [ORDER BY col [DESC]] [LIMIT n];\n"
-        "INSERT INTO tabla (col1,col2,...) VALUES (v1,v2,...);\n"
-        "DELETE FROM tabla [WHERE col op valor];\n"
+        "SELECT [DISTINCT] *|expr [AS alias],... FROM tabla [[LEFT] JOIN t2 ON ...] [WHERE condición]\n"
+        "  [GROUP BY expr,... [HAVING condición]] [UNION [ALL]|INTERSECT|EXCEPT SELECT ...]\n"
+        "  [ORDER BY expr [DESC],...] [LIMIT n [OFFSET m]];\n"
+        "EXPLAIN [ANALYZE] SELECT ...;   (plan; con ANALYZE: filas, tiempo y memoria por operador)\n"
+        "INSERT INTO tabla [(col1,col2,...)] VALUES (v1,v2,...)[,(...)];\n"
+        "UPDATE tabla SET col1 = expr [, col2 = expr ...] [WHERE condición];\n"
+        "DELETE FROM tabla [WHERE condición];\n"
         "(Ctrl+Enter para ejecutar · Ctrl+S para guardar)"
         );
     m_sql->setFixedHeight(120);
 
     auto* run = new QToolButton; run->setText("Run"); run->setToolTip("Ejecutar (Ctrl+Enter)");
+    m_cancel = new QToolButton; m_cancel->setText("Cancelar"); m_cancel->setToolTip("Detener la consulta en curso");
+    m_cancel->setEnabled(false);
+    m_timeout = new QSpinBox; m_timeout->setRange(0, 3600); m_timeout->setValue(30);
+    m_timeout->setSuffix(" s"); m_timeout->setSpecialValueText("Sin límite");
+    m_timeout->setToolTip("Tiempo máximo por consulta");
     auto* clear = new QToolButton; clear->setText("Limpiar");
     m_examples = new QComboBox; m_examples->addItem("Ejemplos...");
     m_examples->addItem("SELECT * FROM Tabla;");
     m_examples->addItem("SELECT id,nombre FROM Tabla WHERE id >= 10 ORDER BY nombre DESC LIMIT 50;");
+    m_examples->addItem("SELECT categoria, COUNT(*), SUM(importe) FROM Tabla GROUP BY categoria HAVING COUNT(*) > 1;");
+    m_examples->addItem("SELECT DISTINCT categoria FROM Tabla UNION SELECT categoria FROM Otra ORDER BY 1;");
+    m_examples->addItem("EXPLAIN ANALYZE SELECT * FROM Tabla WHERE id >= 10 ORDER BY nombre LIMIT 50;");
     m_examples->addItem("INSERT INTO Tabla (nombre,activo) VALUES ('Alice', true);");
+    m_examples->addItem("UPDATE Tabla SET importe = importe * 1.1 WHERE categoria IN ('A','B');");
     m_examples->addItem("DELETE FROM Tabla WHERE id = 7;");
 
     th->addWidget(m_sql, 1);
     auto* side = new QVBoxLayout; side->setSpacing(6);
     side->addWidget(run);
+    side->addWidget(m_cancel);
+    side->addWidget(m_timeout);
     side->addWidget(clear);
     side->addWidget(m_examples);
     side->addStretch();
     th->addLayout(side);
     top->setLayout(th);
 
-    m_grid = new QTableWidget;
+    m_model = new SqlResultModel(this);
+    m_grid = new QTableView;
+    m_grid->setModel(m_model);
     m_grid->setEditTriggers(QAbstractItemView::NoEditTriggers);
     m_grid->horizontalHeader()->setStretchLastSection(true);
 
@@ -172,6 +97,9 @@ QueryPage::QueryPage(QWidget* parent) : QWidget(parent) {
     root->addWidget(m_status);
 
     connect(run, &QToolButton::clicked, this, &QueryPage::runQuery);
+    connect(m_cancel, &QToolButton::clicked, this, &QueryPage::cancelQuery);
+    m_ticker.setInterval(250);
+    connect(&m_ticker, &QTimer::timeout, this, &QueryPage::showProgress);
     connect(clear, &QToolButton::clicked, this, &QueryPage::clearEditor);
     connect(m_examples, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &QueryPage::loadExample);
 
@@ -179,6 +107,10 @@ QueryPage::QueryPage(QWidget* parent) : QWidget(parent) {
     m_sql->installEventFilter(this);
 }
 
+QueryPage::~QueryPage(){
+    stopJob();
+}
+
 bool QueryPage::eventFilter(QObject* obj, QEvent* ev){
     if(obj==m_sql && ev->type()==QEvent::KeyPress){
         auto* ke = static_cast<QKeyEvent*>(ev);
@@ -198,10 +130,10 @@ bool QueryPage::eventFilter(QObject* obj, QEvent* ev){
 }
 
 void QueryPage::clearEditor(){
+    stopJob();
     m_sql->clear();
     m_status->clear();
-    m_grid->setRowCount(0);
-    m_grid->setColumnCount(0);
+    m_model->clear();
     currentSql_.clear();
 }
 
@@ -210,256 +142,143 @@ void QueryPage::loadExample(int idx){
     m_sql->setPlainText(m_examples->itemText(idx));
 }
 
-QString QueryPage::normWS(const QString& s){
-    return s.trimmed().replace("\n"," ").replace(QRegularExpression("\\s+"), " ");
-}
-QString QueryPage::up(const QString& s){ return QString(s).toUpper(); }
-
-QStringList QueryPage::splitCsv(const QString& s){
-    QString t=s.trimmed();
-    if(t.startsWith('(') && t.endsWith(')')) t=t.mid(1,t.size()-2);
-    QString cur; bool inStr=false; QStringList out;
-    for(int i=0;i<t.size();++i){
-        QChar c=t[i];
-        if(c=='\''){ inStr=!inStr; cur+=c; }
-        else if(c==',' && !inStr){ out<<cur.trimmed(); cur.clear(); }
-        else cur+=c;
-    }
-    if(!cur.trimmed().isEmpty()) out<<cur.trimmed();
-    return out;
-}
-
-QVariant QueryPage::parseLiteral(const QString& tok){
-    QString s=tok.trimmed();
-    if(s.startsWith('\'') && s.endsWith('\'')) return s.mid(1,s.size()-2);
-    if(up(s)=="TRUE") return true;
-    if(up(s)=="FALSE") return false;
-    if(up(s)=="NULL") return QVariant();
-    bool ok=false;
-    qlonglong i=s.toLongLong(&ok); if(ok) return QVariant::fromValue(i);
-    double d=s.toDouble(&ok); if(ok) return d;
-    QDate dt=QDate::fromString(s, "yyyy-MM-dd"); if(dt.isValid()) return dt;
-    return s; // fallback string
-}
-
-bool QueryPage::parseSelect(const QString& sql, SelectSpec& out, QString* err){
-    QString s=normWS(sql);
-    if(!s.startsWith("SELECT ", Qt::CaseInsensitive)) return false;
-
-    int pFrom = s.indexOf(" FROM ", 0, Qt::CaseInsensitive);
-    if(pFrom<0){ if(err) *err="Falta FROM"; return false; }
-
-    QString colsPart = s.mid(7, pFrom-7).trimmed();
-    QString rest = s.mid(pFrom+6).trimmed();
-
-    // ---- tabla (recorta ; si viene pegado) ----
-    QString table = rest;
-    int pWS = table.indexOf(' ');
-    if(pWS>0) table = table.left(pWS);
-    table = table.trimmed();
-    if(table.endsWith(';')) table.chop(1);
-    out.table = table;
-    rest = rest.mid(table.size()).trimmed();
-
-    // columnas
-    if(colsPart=="*") out.columns.clear();
-    else { out.columns = colsPart.split(',', Qt::SkipEmptyParts); for(QString& c: out.columns) c=c.trimmed(); }
-
-    // WHERE
-    if(rest.startsWith("WHERE ", Qt::CaseInsensitive)){
-        int pAfterWhere = 6;
-        int pOrder = rest.indexOf(" ORDER BY ", Qt::CaseInsensitive);
-        int pLimit = rest.indexOf(" LIMIT ", Qt::CaseInsensitive);
-        int end = rest.size(); if(pOrder>=0) end = qMin(end, pOrder); if(pLimit>=0) end=qMin(end,pLimit);
-        QString where = rest.mid(pAfterWhere, end-pAfterWhere).trimmed();
-        auto parts = where.split(QRegularExpression("\\bAND\\b"), Qt::SkipEmptyParts);
-
-        // permite Tabla.Columna
-        QRegularExpression re("^([A-Za-z_][A-Za-z0-9_]*(?:\\.[A-Za-z_][A-Za-z0-9_]*)?)\\s*(=|!=|<>|>=|<=|>|<)\\s*(.+)$");
-        for(const QString& w : parts){
-            auto m=re.match(w.trimmed());
-            if(!m.hasMatch()){ if(err) *err="WHERE inválido"; return false; }
-            SelectSpec::Cond c{ normalizeColToken(m.captured(1)), m.captured(2), parseLiteral(m.captured(3).trimmed()) };
-            out.where<<c;
-        }
-        rest = rest.mid(end).trimmed();
-    }
-
-    // ORDER BY
-    if(rest.startsWith("ORDER BY ", Qt::CaseInsensitive)){
-        QString tail = takeAfter(rest, "ORDER BY ");
-        QStringList t = tail.split(' ', Qt::SkipEmptyParts);
-        out.orderBy = t.value(0);                    // puede venir calificado; schemaFieldIndex lo normaliza
-        out.orderDesc = (t.size()>1 && up(t[1])=="DESC");
-        // recorta aproximado
-        int pos = rest.indexOf(out.orderBy, 0, Qt::CaseInsensitive);
-        rest = rest.mid(pos + out.orderBy.size());
-        if(rest.trimmed().toUpper().startsWith(" DESC")) rest = rest.trimmed().mid(5);
-        rest = rest.trimmed();
-    }
-
-    // LIMIT
-    if(rest.startsWith("LIMIT ", Qt::CaseInsensitive)){
-        QString n = takeAfter(rest, "LIMIT "); bool ok=false; out.limit = n.toInt(&ok);
-        if(!ok){ if(err) *err="LIMIT inválido"; return false; }
-    }
-    return true;
-}
-
-bool QueryPage::parseInsert(const QString& sql, InsertSpec& out, QString* err){
-    QString s=normWS(sql);
-    QRegularExpression re("^INSERT\\s+INTO\\s+([A-Za-z_][A-Za-z0-9_]*)\\s*\\(([^)]*)\\)\\s*VALUES\\s*\\(([^)]*)\\)\\s*;?$");
-    auto m=re.match(s, QRegularExpression::CaseInsensitiveOption);
-    if(!m.hasMatch()) return false;
-    out.table = m.captured(1);
-    out.cols = splitCsv(m.captured(2));
-    auto vals = splitCsv(m.captured(3));
-    if(out.cols.size()!=vals.size()){ if(err) *err="# de columnas no coincide con # de valores"; return false; }
-    for(const QString& v: vals) out.vals<<parseLiteral(v);
-    return true;
-}
-
-bool QueryPage::parseDelete(const QString& sql, DeleteSpec& out, QString* err){
-    QString s=normWS(sql);
-    QRegularExpression re("^DELETE\\s+FROM\\s+([A-Za-z_][A-Za-z0-9_]*)\\s*(WHERE\\s+(.+))?;?$");
-    auto m=re.match(s, QRegularExpression::CaseInsensitiveOption);
-    if(!m.hasMatch()) return false;
-    out.table=m.captured(1);
-    if(m.captured(3).isEmpty()){ out.hasWhere=false; return true; }
-
-    // permite Tabla.Columna en DELETE
-    QRegularExpression rc("^([A-Za-z_][A-Za-z0-9_]*(?:\\.[A-Za-z_][A-Za-z0-9_]*)?)\\s*(=|!=|<>|>=|<=|>|<)\\s*(.+)$");
-    auto mw = rc.match(m.captured(3).trimmed());
-    if(!mw.hasMatch()){ if(err) *err="WHERE inválido"; return false; }
-    out.hasWhere=true; out.where={ normalizeColToken(mw.captured(1)), mw.captured(2), parseLiteral(mw.captured(3).trimmed()) };
-    return true;
-}
-
 void QueryPage::runQuery(){
-    QString sql = m_sql->toPlainText().trimmed();
+    const QString sql = m_sql->toPlainText().trimmed();
     if(sql.isEmpty()) return;
 
-    // ⬇️ quita ; final (si lo hay) para no contaminar WHERE/valores
-    if (sql.endsWith(';'))
-        sql.chop(1);
-
     QString err;
-    SelectSpec qs; InsertSpec qi; DeleteSpec qd;
-    if(parseSelect(sql, qs, &err)) { execSelect(qs); return; }
-    if(parseInsert(sql, qi, &err)) { execInsert(qi); return; }
-    if(parseDelete(sql, qd, &err)) { execDelete(qd); return; }
-    QMessageBox::warning(this, "SQL", QString("No se pudo interpretar la consulta. %1").arg(err));
-}
-
-void QueryPage::execSelect(const SelectSpec& q){
-    auto& dm = DataModel::instance();
-    const QString table = resolveTableNameCI(q.table);
-    if(table.isEmpty()){ QMessageBox::warning(this, "SELECT", "Tabla no encontrada"); return; }
-
-    const auto s = dm.schema(table);
-
-    // columnas (mantén encabezados como el usuario los escribió, usa normalizados para buscar)
-    QStringList cols = q.columns;
-    QStringList lookups;
-    if(cols.isEmpty()){
-        for(const auto& f : s){ cols<<f.name; lookups<<f.name; }
-    } else {
-        for(const QString& c : cols) lookups << normalizeColToken(c);
+    SqlStatement st;
+    if(!SqlParser::parse(sql, &st, &err)){
+        QMessageBox::warning(this, "SQL", QString("No se pudo interpretar la consulta. %1").arg(err));
+        return;
     }
-
-    // map de nombre->índice
-    QVector<int> colIdx; colIdx.reserve(cols.size());
-    for(int i=0;i<cols.size();++i){
-        int ix = schemaFieldIndex(s, lookups[i]);
-        if(ix<0){ QMessageBox::warning(this, "SELECT", QString("Columna '%1' no existe").arg(cols[i])); return; }
-        colIdx<<ix;
+    if(st.kind == SqlStatement::Kind::Select){
+        // La consulta guardada sin editar sale ya preparada; otro SELECT se
+        // prepara aquí. Los parámetros se piden antes de ejecutar.
+        DataModel& dm = DataModel::instance();
+        SqlPreparedPtr p;
+        if(!currentName_.isEmpty()
+           && SqlResultCache::normalize(sql) == SqlResultCache::normalize(dm.querySql(currentName_))){
+            p = SqlPreparedCache::instance().get(currentName_, &err);
+        } else {
+            QSharedPointer<SqlPreparedQuery> fresh(new SqlPreparedQuery);
+            if(SqlEngine().prepare(sql, fresh.data(), &err)) p = fresh;
+        }
+        if(!p){
+            QMessageBox::warning(this, "SELECT", err);
+            return;
+        }
+        QVariantMap values;
+        if(!askQueryParameters(this, p->parameters(), &values)) return;
+        SqlSelect q;
+        p->bind(values, &q);
+        execSelect(p->cacheKey(values), q, dm.snapshot(p->tables()), p->tables());
+        return;
     }
+    execDml(st);
+}
 
-    // header grid
-    m_grid->clear();
-    m_grid->setRowCount(0);
-    m_grid->setColumnCount(cols.size());
-    m_grid->setHorizontalHeaderLabels(cols);
-
-    // filtro
-    auto matchRow = [&](const Record& r){
-        for(const auto& cond : q.where){
-            int ci = schemaFieldIndex(s, cond.col); if(ci<0) return false;
-            const QVariant v=r.value(ci);
-            QString op=cond.op; if(op=="<>") op="!=";
-
-            if(op=="=")  { if(!equalVar(v, cond.val)) return false; continue; }
-            if(op=="!=") { if( equalVar(v, cond.val)) return false; continue; }
-
-            int c = cmpVar(v, cond.val);
-            if(op==">"  && !(c>0))  return false;
-            if(op=="<"  && !(c<0))  return false;
-            if(op==">=" && !(c>=0)) return false;
-            if(op=="<=" && !(c<=0)) return false;
+// Filas, ritmo y tiempo de un resultado
+static QString rateText(qint64 rows, qint64 ms){
+    const qint64 rate = ms > 0 ? qint64(rows * 1000.0 / ms) : rows;
+    return QString("%1 fila(s) · %2 filas/s · %3 s").arg(rows).arg(rate).arg(ms / 1000.0, 0, 'f', 1);
+}
+
+void QueryPage::execSelect(const QString& sql, const SqlSelect& q, const DataSnapshot& snap,
+                           const QStringList& tables){
+    stopJob();
+
+    // La consulta guardada abierta, sin editar y materializada: su resultado guardado
+    DataModel& dm = DataModel::instance();
+    if(!currentName_.isEmpty() && dm.isQueryMaterialized(currentName_)
+       && SqlResultCache::normalize(sql) == SqlResultCache::normalize(dm.querySql(currentName_))){
+        QString err;
+        if(const SqlResultPtr res = MaterializedQueries::instance().result(currentName_, snap, &err)){
+            m_model->setResult(res);
+            m_status->setText(QString("%1 fila(s) (materializada)").arg(res->rows.size()));
+            return;
         }
-        return true;
-    };
-
-    // recolecta
-    struct Row { int idx; const Record* rec; };
-    QVector<Row> rows;
-    const auto& data = dm.rows(table);
-    rows.reserve(data.size());
-    for(int i=0;i<data.size();++i){
-        const auto& r=data[i]; if(isTomb(r)) continue;
-        if(matchRow(r)) rows.push_back({i,&r});
+        QMessageBox::warning(this, "SELECT", err);
+        return;
     }
 
-    // ordenar
-    if(!q.orderBy.isEmpty()){
-        int oi = schemaFieldIndex(s, q.orderBy); // soporta calificado
-        if(oi<0){ QMessageBox::warning(this, "SELECT", "ORDER BY columna inválida"); return; }
-        std::sort(rows.begin(), rows.end(), [&](const Row& a, const Row& b){
-            int cmp = cmpVar(a.rec->value(oi), b.rec->value(oi));
-            return q.orderDesc ? (cmp>0) : (cmp<0);
-        });
+    // Si ninguna tabla leída cambió desde la última vez, sale de la caché
+    if(const SqlResultPtr res = SqlResultCache::instance().lookup(sql, snap)){
+        m_model->setResult(res);
+        m_status->setText(QString("%1 fila(s) (caché)").arg(res->rows.size()));
+        return;
     }
 
-    // LIMIT
-    int take = rows.size(); if(q.limit>=0) take = qMin(take, q.limit);
-
-    // llenar
-    m_grid->setRowCount(take);
-    for(int r=0;r<take;++r){
-        const auto& rec = *rows[r].rec;
-        for(int c=0;c<colIdx.size();++c){
-            auto it = new QTableWidgetItem;
-            it->setText(rec.value(colIdx[c]).toString());
-            m_grid->setItem(r,c,it);
+    // Si no, en otro hilo: las filas entran a la vista por lotes mientras se producen
+    m_streamed = 0;
+    m_clock.start();
+    m_job = SqlQueryJob::start(sql, q, snap, tables, m_timeout->value() * 1000);
+    connect(m_job, &SqlQueryJob::columnsReady, this, [this](const QStringList& names){
+        m_model->beginStream(names);
+    });
+    connect(m_job, &SqlQueryJob::rowsReady, this, [this](const QVector<Record>& rows){
+        m_model->appendRows(rows);
+        m_streamed += rows.size();
+    });
+    connect(m_job, &SqlQueryJob::finished, this,
+            [this](SqlQueryJob::Outcome outcome, qint64 rows, const QString& err){
+        m_ticker.stop();
+        m_cancel->setEnabled(false);
+        m_model->endStream();
+        const qint64 ms = m_clock.elapsed();
+        switch(outcome){
+        case SqlQueryJob::Outcome::Done:
+            m_status->setText(rateText(rows, ms));
+            break;
+        case SqlQueryJob::Outcome::Cancelled:
+            m_status->setText("Cancelada · " + rateText(rows, ms));
+            break;
+        case SqlQueryJob::Outcome::TimedOut:
+            m_status->setText(QString("Tiempo agotado (%1 s) · ").arg(m_timeout->value()) + rateText(rows, ms));
+            break;
+        case SqlQueryJob::Outcome::Failed:
+            m_status->clear();
+            QMessageBox::warning(this, "SELECT", err);
+            break;
         }
-    }
-
-    m_status->setText(QString("%1 fila(s)").arg(take));
+    });
+    m_cancel->setEnabled(true);
+    m_ticker.start();
+    showProgress();
 }
 
-void QueryPage::execInsert(const InsertSpec& q){
-    auto& dm = DataModel::instance();
-    const QString table = resolveTableNameCI(q.table);
-    if(table.isEmpty()){ QMessageBox::warning(this, "INSERT", "Tabla no encontrada"); return; }
+void QueryPage::showProgress(){
+    m_status->setText("Ejecutando… " + rateText(m_streamed, m_clock.elapsed()));
+}
 
-    const auto s = dm.schema(table);
+void QueryPage::cancelQuery(){
+    if(m_job) m_job->cancel();
+}
 
-    Record rec; rec.resize(s.size());
-    for(int i=0;i<rec.size();++i) rec[i]=QVariant(); // NULLs por defecto
+// La consulta anterior deja de escribir en la vista (termina sola en su hilo)
+void QueryPage::stopJob(){
+    if(!m_job) return;
+    m_job->cancel();
+    disconnect(m_job, nullptr, this, nullptr);
+    m_job = nullptr;
+    m_ticker.stop();
+    m_cancel->setEnabled(false);
+}
 
-    for(int i=0;i<q.cols.size();++i){
-        const QString col=q.cols[i];
-        int ix=schemaFieldIndex(s,col);
-        if(ix<0){ QMessageBox::warning(this, "INSERT", QString("Columna '%1' no existe").arg(col)); return; }
-        rec[ix]=q.vals[i];
+void QueryPage::execDml(const SqlStatement& st){
+    QString title, done;
+    switch(st.kind){
+    case SqlStatement::Kind::Insert: title = "INSERT"; done = "%1 fila(s) insertada(s)";  break;
+    case SqlStatement::Kind::Update: title = "UPDATE"; done = "%1 fila(s) actualizada(s)"; break;
+    default:                         title = "DELETE"; done = "%1 fila(s) borradas";       break;
     }
-
     QString err;
-    if(!dm.insertRow(table, rec, &err)){
-        QMessageBox::warning(this, "INSERT", err);
+    const int n = SqlEngine().execute(st, &err);
+    if(n < 0){
+        QMessageBox::warning(this, title, err);
         return;
     }
-    m_status->setText("1 fila insertada");
+    m_status->setText(done.arg(n));
 }
 
 void QueryPage::setSqlText(const QString& sql){
@@ -468,47 +287,6 @@ void QueryPage::setSqlText(const QString& sql){
     currentSql_ = sql;
 }
 
-void QueryPage::execDelete(const DeleteSpec& q){
-    auto& dm = DataModel::instance();
-    const QString table = resolveTableNameCI(q.table);
-    if(table.isEmpty()){ QMessageBox::warning(this, "DELETE", "Tabla no encontrada"); return; }
-
-    const auto s = dm.schema(table);
-
-    QList<int> toDel;
-    const auto& data = dm.rows(table);
-
-    auto match = [&](const Record& r){
-        if(!q.hasWhere) return true;
-        int ci = schemaFieldIndex(s, q.where.col); if(ci<0) return false;
-        const QVariant v=r.value(ci);
-        QString op=q.where.op; if(op=="<>") op="!=";
-
-        if(op=="=")  return equalVar(v, q.where.val);
-        if(op=="!=") return !equalVar(v, q.where.val);
-
-        int c = cmpVar(v, q.where.val);
-        if(op==">")  return c>0;
-        if(op=="<")  return c<0;
-        if(op==">=") return c>=0;
-        if(op=="<=") return c<=0;
-        return false;
-    };
-
-    for(int i=0;i<data.size();++i){
-        const auto& r=data[i]; if(isTomb(r)) continue;
-        if(match(r)) toDel<<i;
-    }
-    if(toDel.isEmpty()){ m_status->setText("0 filas borradas"); return; }
-
-    QString err;
-    if(!dm.removeRows(table, toDel, &err)){
-        QMessageBox::warning(this, "DELETE", err);
-        return;
-    }
-    m_status->setText(QString::number(toDel.size())+" fila(s) borradas");
-}
-
 // ===================== Guardado / Carga =====================
 
 QString QueryPage::collectCurrentQueryText() const {
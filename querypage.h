@@ -3,7 +3,7 @@
 
 #include <QWidget>
 #include <QPlainTextEdit>
-#include <QTableWidget>
+#include <QTableView>
 #include <QToolButton>
 #include <QLabel>
 #include <QComboBox>
@@ -12,16 +12,24 @@
 #include <QEvent>
 #include <QKeyEvent>
 #include <QString>
+#include <QPointer>
+#include <QTimer>
+#include <QElapsedTimer>
 #include "datamodel.h"
+#include "sqlparser.h"
 
 // Fwd decls para aligerar el header
 class QToolBar;
 class QAction;
+class QSpinBox;
+class SqlResultModel;
+class SqlQueryJob;
 
 class QueryPage : public QWidget {
     Q_OBJECT
 public:
     explicit QueryPage(QWidget* parent=nullptr);
+    ~QueryPage() override;
 
 signals:
     // Se emiten tras guardar (para refrescar la lista en la izquierda)
@@ -40,31 +48,27 @@ protected:
 private slots:
     // Existentes
     void runQuery();
+    void cancelQuery();
     void clearEditor();
     void loadExample(int idx);
     void setSqlText(const QString& sql);
 
 private:
-    // Estructuras de parsing/ejecución (existentes)
-    struct SelectSpec {
-        QStringList columns; // vacío => *
-        QString table;
-        struct Cond { QString col; QString op; QVariant val; };
-        QList<Cond> where;   // solo AND para MVP
-        QString orderBy;
-        bool orderDesc = false;
-        int limit = -1;
-    };
-
-    struct InsertSpec { QString table; QStringList cols; QList<QVariant> vals; };
-    struct DeleteSpec { QString table; SelectSpec::Cond where; bool hasWhere=false; };
-
     // ===== UI =====
     // Editor y resultados existentes
     QPlainTextEdit*  m_sql      = nullptr;
-    QTableWidget*    m_grid     = nullptr;
+    QTableView*      m_grid     = nullptr;
+    SqlResultModel*  m_model    = nullptr;   // celdas formateadas a pedido de la vista
     QLabel*          m_status   = nullptr;
     QComboBox*       m_examples = nullptr;
+    QToolButton*     m_cancel   = nullptr;
+    QSpinBox*        m_timeout  = nullptr;   // segundos por consulta (0 = sin límite)
+
+    // SELECT en curso (en otro hilo): filas llegadas y reloj para el status
+    QPointer<SqlQueryJob> m_job;
+    QElapsedTimer    m_clock;
+    QTimer           m_ticker;
+    qint64           m_streamed = 0;
 
     // Barra de herramientas para guardar (nuevos)
     QToolBar* toolbar_   = nullptr;
@@ -75,19 +79,12 @@ private:
     QString currentName_;
     QString currentSql_;
 
-    // ===== Helpers de parsing (existentes) =====
-    static QString normWS(const QString& s);
-    static QString up(const QString& s);
-    static QStringList splitCsv(const QString& s);
-    static QVariant parseLiteral(const QString& tok);
-    bool parseSelect(const QString& sql, SelectSpec& out, QString* err);
-    bool parseInsert(const QString& sql, InsertSpec& out, QString* err);
-    bool parseDelete(const QString& sql, DeleteSpec& out, QString* err);
-
-    // ===== Exec (existentes) =====
-    void execSelect(const SelectSpec& q);
-    void execInsert(const InsertSpec& q);
-    void execDelete(const DeleteSpec& q);
+    // ===== Exec (SqlEngine) =====
+    void execSelect(const QString& sql, const SqlSelect& q, const DataSnapshot& snap,
+                    const QStringList& tables);                      // caché o SqlQueryJob
+    void stopJob();                                                  // cancela y desconecta
+    void showProgress();
+    void execDml(const SqlStatement& st);                            // INSERT / UPDATE / DELETE
 
     // ===== Guardado (nuevos) =====
     QString collectCurrentQueryText() const;                 // obtiene SQL del editor
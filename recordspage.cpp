@@ -348,9 +348,9 @@ public:
                     // fallback: del modelo (si es una fila ya existente)
                     const int dr = m_owner->viewRowToDataRow(r);
                     if (dr >= 0) {
-                        const auto rows = DataModel::instance().rows(m_owner->tableName());
-                        if (dr < rows.size() && pk < rows[dr].size())
-                            return rows[dr][pk].toString().trimmed();
+                        const ColumnTable& tab = DataModel::instance().columnTable(m_owner->tableName());
+                        if (tab.isLive(dr) && pk < tab.columnCount())
+                            return tab.value(dr, pk).toString().trimmed();
                     }
                     return QString();
                 };
@@ -365,15 +365,15 @@ public:
                         (normType(s[pk].type) == "texto" || normType(s[pk].type) == "texto_largo");
                     const QString key = textPk ? pkTxt.toLower() : pkTxt;
 
-                    const auto rows  = DataModel::instance().rows(m_owner->tableName());
+                    const ColumnTable& tab = DataModel::instance().columnTable(m_owner->tableName());
                     const int drSelf = m_owner->viewRowToDataRow(vrow);
-                    for (int i = 0; i < rows.size(); ++i) {
+                    for (int i = 0; i < tab.slotCount(); ++i) {
                         if (i == drSelf) continue;
-                        const Record& rec = rows[i];
-                        if (rec.isEmpty() || pk >= rec.size()) continue;
+                        if (!tab.isLive(i) || pk >= tab.columnCount()) continue;
+                        const QVariant v = tab.value(i, pk);
                         const QString other = textPk
-                                                  ? rec[pk].toString().trimmed().toLower()
-                                                  : rec[pk].toString().trimmed();
+                                                  ? v.toString().trimmed().toLower()
+                                                  : v.toString().trimmed();
                         if (other == key) { pkDup = true; break; }
                     }
                 }
@@ -735,7 +735,7 @@ RecordsPage::RecordsPage(QWidget* parent)
             ? ui->twRegistros->selectionModel()->selectedRows()
             : QModelIndexList{};
             // Ignora la última fila "New"
-            const int dataCount = DataModel::instance().rows(m_tableName).size();
+            const int dataCount = DataModel::instance().columnTable(m_tableName).slotCount();
             for (const auto& ix : sel) {
                 if (ix.row() >= 0 && ix.row() < dataCount) { any = true; break; }
             }
@@ -1039,7 +1039,7 @@ void RecordsPage::reloadRows()
     ui->twRegistros->setItemDelegate(new DatasheetDelegate(this));
     ui->twRegistros->setSortingEnabled(false);
 
-    const auto& rowsData = DataModel::instance().rows(m_tableName);
+    const ColumnTable& tab = DataModel::instance().columnTable(m_tableName);
 
     int prevSelRow = -1, prevSelCol = -1;
     if (auto *sm = ui->twRegistros->selectionModel()) {
@@ -1082,18 +1082,17 @@ void RecordsPage::reloadRows()
 
         // --- construir lista de filas reales no-tombstone y ordenarlas por ID
         QVector<int> orderDrs;
-        orderDrs.reserve(rowsData.size());
-        for (int dr = 0; dr < rowsData.size(); ++dr) {
-            const Record& rec = rowsData[dr];
-            if (isTombstone(rec)) continue;
+        orderDrs.reserve(tab.liveCount());
+        for (int dr = 0; dr < tab.slotCount(); ++dr) {
+            if (isTombstone(tab.record(dr))) continue;
             orderDrs.push_back(dr);
         }
 
         if (idColForOrder >= 0) {
             std::stable_sort(orderDrs.begin(), orderDrs.end(),
                 [&](int a, int b){
-                    const auto idA = (idColForOrder < rowsData[a].size()) ? rowsData[a][idColForOrder] : QVariant();
-                    const auto idB = (idColForOrder < rowsData[b].size()) ? rowsData[b][idColForOrder] : QVariant();
+                    const auto idA = tab.value(a, idColForOrder);
+                    const auto idB = tab.value(b, idColForOrder);
                     bool okA=false, okB=false;
                     const qlonglong nA = idA.toLongLong(&okA);
                     const qlonglong nB = idB.toLongLong(&okB);
@@ -1106,11 +1105,12 @@ void RecordsPage::reloadRows()
         // --- pintar filas visibles en el orden decidido y mapear vista→modelo
         for (int ord = 0; ord < orderDrs.size(); ++ord) {
             const int dr = orderDrs[ord];
-            const Record& rec = rowsData[dr];
+            const Record rec = tab.record(dr);
 
             const int vr = ui->twRegistros->rowCount();   // fila visible
             ui->twRegistros->insertRow(vr);
-            m_rowMap.push_back(dr);                       // vista -> modelo
+            const RowId rowId = DataModel::instance().columnTable(m_tableName).rowIdAt(dr);
+            m_rowMap.push_back(rowId);                    // vista -> modelo (id estable)
 
             for (int c = 0; c < m_schema.size(); ++c) {
                 const FieldDef& fd = m_schema[c];
@@ -1127,14 +1127,14 @@ void RecordsPage::reloadRows()
                     hl->addStretch(1);
                     ui->twRegistros->setCellWidget(vr, c, wrap);
 
-                    const int dataRow = dr;
                     const int viewRow = vr;
-                    connect(cb, &QCheckBox::checkStateChanged, this, [this, dataRow, viewRow](int){
+                    connect(cb, &QCheckBox::checkStateChanged, this, [this, rowId, viewRow](int){
                         if (m_isReloading || m_isCommitting) return;
                         Record rowRec = rowToRecord(viewRow);     // usa fila visible
                         QString err;
                         if (!DataModel::instance().validate(m_schema, rowRec, &err)) { reloadRows(); return; }
-                        DataModel::instance().updateRow(m_tableName, dataRow, rowRec, &err); // actualiza fila real
+                        auto& dm = DataModel::instance();
+                        dm.updateRowById(dm.tableId(m_tableName), rowId, rowRec, &err); // actualiza fila real
                     });
                 } else {
                     auto *it = new QTableWidgetItem(formatCell(fd, vv));
@@ -1191,11 +1191,11 @@ void RecordsPage::reloadRows()
 
     // asegurar que la primera visible muestre su ID correcto (no editable si es autonumeración)
     if (idCol >= 0) {
-        const auto& vrows = DataModel::instance().rows(m_tableName);
+        const ColumnTable& vtab = DataModel::instance().columnTable(m_tableName);
         if (!m_rowMap.isEmpty()) {
-            const int firstDr = m_rowMap.first();
-            if (firstDr >= 0 && firstDr < vrows.size() && !vrows[firstDr].isEmpty()) {
-                QVariant v0 = (idCol < vrows[firstDr].size() ? vrows[firstDr][idCol] : QVariant());
+            const int firstDr = dataRowForView(0);
+            if (vtab.isLive(firstDr)) {
+                QVariant v0 = vtab.value(firstDr, idCol);
                 ui->twRegistros->removeCellWidget(0, idCol);
                 QTableWidgetItem *it0 = ui->twRegistros->item(0, idCol);
                 if (!it0) { it0 = new QTableWidgetItem; ui->twRegistros->setItem(0, idCol, it0); }
@@ -1847,11 +1847,8 @@ Record RecordsPage::rowToRecord(int row) const
             if (ok) {
                 rec[c] = d;
             } else {
-                const auto &rows = DataModel::instance().rows(m_tableName);
-                if (dataRow >= 0 && dataRow < rows.size() && c < rows[dataRow].size())
-                    rec[c] = rows[dataRow][c];
-                else
-                    rec[c] = QVariant();
+                // Valor vigente (QVariant() si la fila no existe)
+                rec[c] = DataModel::instance().columnTable(m_tableName).value(dataRow, c);
 
             }
         } else if (t == "booleano") {
@@ -1908,9 +1905,9 @@ void RecordsPage::onItemChanged(QTableWidgetItem* it)
     QString err;
     if (!DataModel::instance().updateRow(m_tableName, dataRow, r, &err)) {
         // Fallback visual: recuperar el valor correcto desde el MODELO (dataRow)
-        const auto rows = DataModel::instance().rows(m_tableName);
-        if (dataRow >= 0 && dataRow < rows.size() && col < rows[dataRow].size()) {
-            const QVariant& vv = rows[dataRow][col];
+        const ColumnTable& tab = DataModel::instance().columnTable(m_tableName);
+        if (tab.isLive(dataRow) && col < tab.columnCount()) {
+            const QVariant vv = tab.value(dataRow, col);
             if (auto *item = ui->twRegistros->item(row, col)) {
                 item->setText(formatCell(fd, vv));
                 item->setBackground(QColor("#ffe0e0"));
@@ -2199,9 +2196,9 @@ void RecordsPage::onCurrentCellChanged(int currentRow, int currentCol,
                 if (auto *it = ui->twRegistros->item(vrow, vcol)) return it->text().trimmed();
                 const int dr = dataRowForView(vrow);
                 if (dr >= 0) {
-                    const auto rows = DataModel::instance().rows(m_tableName);
-                    if (dr < rows.size() && vcol < rows[dr].size())
-                        return rows[dr][vcol].toString().trimmed();
+                    const ColumnTable& tab = DataModel::instance().columnTable(m_tableName);
+                    if (tab.isLive(dr) && vcol < tab.columnCount())
+                        return tab.value(dr, vcol).toString().trimmed();
                 }
                 return QString();
             };
@@ -2231,8 +2228,8 @@ void RecordsPage::onCurrentCellChanged(int currentRow, int currentCol,
                     if (auto *it = ui->twRegistros->item(vrow, pk)) return it->text();
                     const int dr = dataRowForView(vrow);
                     if (dr >= 0) {
-                        const auto rows = DataModel::instance().rows(m_tableName);
-                        if (dr < rows.size() && pk < rows[dr].size()) return rows[dr][pk];
+                        const ColumnTable& tab = DataModel::instance().columnTable(m_tableName);
+                        if (tab.isLive(dr) && pk < tab.columnCount()) return tab.value(dr, pk);
                     }
                     return QVariant();
                 };
@@ -2259,15 +2256,14 @@ void RecordsPage::onCurrentCellChanged(int currentRow, int currentCol,
                                                 ? pkVal.toString().trimmed().toLower()
                                                 : pkVal.toString();
 
-                    const auto rows = DataModel::instance().rows(m_tableName);
+                    const ColumnTable& tab = DataModel::instance().columnTable(m_tableName);
                     const int drPrev = dataRowForView(previousRow);
 
                     bool dup = false;
-                    for (int i = 0; i < rows.size(); ++i) {
+                    for (int i = 0; i < tab.slotCount(); ++i) {
                         if (i == drPrev) continue;                     // misma fila no cuenta
-                        const Record& rec = rows[i];
-                        if (rec.isEmpty() || pk >= rec.size()) continue; // tombstone / corto
-                        const QVariant& v = rec[pk];
+                        if (!tab.isLive(i) || pk >= tab.columnCount()) continue; // tombstone / corto
+                        const QVariant v = tab.value(i, pk);
                         if (!v.isValid() || v.isNull()) continue;      // ignora vacíos de otras filas
                         const QString k = textPk
                                               ? v.toString().trimmed().toLower()
@@ -32,10 +32,8 @@ public:
     // Nombre de la tabla actual (solo lectura)
     const QString& tableName() const { return m_tableName; }
 
-    // Mapeo vista->modelo para el delegado
-    int viewRowToDataRow(int vr) const {
-        return (vr >= 0 && vr < m_rowMap.size()) ? m_rowMap[vr] : -1;
-    }
+    // Mapeo vista->modelo para el delegado (slot actual de la fila)
+    int viewRowToDataRow(int vr) const { return dataRowForView(vr); }
 
 
 public slots:
@@ -107,11 +105,16 @@ private:
 
 
 
-    // Mapea fila visible (vista) -> fila real en DataModel
-    QVector<int> m_rowMap;
+    // Mapea fila visible (vista) -> RowId estable en DataModel (sobrevive a compactTable)
+    QVector<RowId> m_rowMap;
 
+    inline RowId rowIdForView(int vr) const {
+        return (vr >= 0 && vr < m_rowMap.size()) ? m_rowMap[vr] : kInvalidRowId;
+    }
+    // Slot actual de la fila visible (-1 si es "New", fuera de mapa o ya no existe)
     inline int dataRowForView(int vr) const {
-        return (vr >= 0 && vr < m_rowMap.size()) ? m_rowMap[vr] : -1;
+        const RowId id = rowIdForView(vr);
+        return id == kInvalidRowId ? -1 : DataModel::instance().columnTable(m_tableName).slotOf(id);
     }
 
 
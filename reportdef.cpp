@@ -89,6 +89,8 @@ QJsonObject ReportDef::toJson() const {
     }
     o["filters"] = filtsA;
 
+    if (!parameters.isEmpty()) o["parameters"] = QJsonObject::fromVariantMap(parameters);
+
     QJsonObject lo;
     lo["template"] = layout.templateName;
     lo["paper"]    = layout.paper;
@@ -169,6 +171,8 @@ ReportDef ReportDef::fromJson(const QJsonObject& o) {
         d.filters.push_back(f);
     }
 
+    d.parameters = o.value("parameters").toObject().toVariantMap();
+
     const auto lo = o.value("layout").toObject();
     d.layout.templateName = lo.value("template").toString("tabular");
     d.layout.paper        = lo.value("paper").toString("Letter");
@@ -81,6 +81,10 @@ struct ReportDef {
     QVector<AggDef>   aggregates;
     QVector<FilterDef> filters;
 
+    // Valores de los parámetros ([Nombre] / :nombre) de las consultas de origen;
+    // los que falten se piden al abrir el reporte
+    QVariantMap parameters;
+
     LayoutDef layout;
 
     // ==== Serialización a JSON (para guardar junto al resto del proyecto) ====
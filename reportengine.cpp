@@ -1,5 +1,9 @@
 #include "reportengine.h"
 #include "datamodel.h" // se usa con cuidado
+#include "sqlengine.h"
+#include "sqlcache.h"
+#include "matview.h"
+#include "sqlpredicate.h"
 
 #include <QRegularExpression>
 #include <QMetaType>
@@ -13,122 +17,145 @@
 using Row    = QMap<QString, QVariant>;
 using RowVec = QVector<Row>;
 
-Q_DECLARE_METATYPE(Row)
-Q_DECLARE_METATYPE(RowVec)
-
-// Registro estático de metatipos (necesario para QMetaObject::invokeMethod)
-static int _q_register_reportengine_metatypes_ = [](){
-    qRegisterMetaType<Row>("Row");
-    qRegisterMetaType<RowVec>("RowVec");
-    return 0;
-}();
-
 // ---------------------------------------------------------------------------
 
 ReportEngine::ReportEngine(QObject* parent) : QObject(parent) {}
 
 static QString norm(const QString& s){ return s.trimmed(); }
 
-// Convierte DataModel::rows(table) -> QVector<map col→valor>
-static RowVec rowsFromTable(const QString& table) {
+// Convierte una tabla del snapshot -> QVector<map col→valor> (solo filas vivas)
+static RowVec rowsFromTable(const DataSnapshot& snap, const QString& table) {
     RowVec out;
-    auto& dm = DataModel::instance();
-    const auto s    = dm.schema(table);
-    const auto recs = dm.rows(table);
-    for (const auto& r : recs) {
+    const Schema&      s   = snap.schema(table);
+    const ColumnTable& tab = snap.columnTable(table);
+    const int nc = qMin(int(s.size()), tab.columnCount());
+    out.reserve(tab.liveCount());
+    for (int slot = 0; slot < tab.slotCount(); ++slot) {
+        if (!tab.isLive(slot)) continue;   // tombstone
         Row m;
-        for (int i=0;i<s.size() && i<r.size();++i) {
-            m.insert(s[i].name, r[i]);
-        }
+        for (int i = 0; i < nc; ++i)
+            m.insert(s[i].name, tab.column(i).value(slot));
         out.push_back(m);
     }
     return out;
 }
 
-// Heurística: si tienes una consulta guardada, intenta recuperarla
-static bool queryToRows(const QString& queryName, RowVec& out) {
-    // Intentos no intrusivos:
-    // 1) DataModel::instance().queryRows(name)    (si existiera)
-    // 2) DataModel::instance().querySql(name) y luego DataModel::instance().executeSql(sql)
-    // 3) fallback: si el nombre coincide con una tabla, usarla
-    auto& dm = DataModel::instance();
-    bool ok = false;
-
-    // (1) método opcional
-    if (dm.metaObject()->indexOfMethod("queryRows(QString)") >= 0) {
-        QVector<QVector<QVariant>> raw; // placeholder
-        ok = QMetaObject::invokeMethod(&dm, "queryRows", Qt::DirectConnection,
-                                       Q_RETURN_ARG(QVector<QVector<QVariant>>, raw),
-                                       Q_ARG(QString, queryName));
-        if (ok && !raw.isEmpty()) {
-            // sin esquema, no podemos etiquetar columnas; saltamos a (2)
-            ok = false;
-        }
+// Resultado de SELECT (caché o consulta materializada) -> filas por nombre de columna
+static void resultToRows(const SqlResult& res, RowVec& out) {
+    out.clear();
+    out.reserve(res.rows.size());
+    for (const Record& row : res.rows) {
+        QMap<QString, QVariant> m;
+        for (int c = 0; c < res.names.size(); ++c) m.insert(res.names[c], row.value(c));
+        out.push_back(m);
     }
+}
 
-    // (2) obtener SQL y ejecutar
-    if (!ok && dm.metaObject()->indexOfMethod("querySql(QString)") >= 0 &&
-        dm.metaObject()->indexOfMethod("executeSql(QString)") >= 0)
-    {
-        QString sql;
-        ok = QMetaObject::invokeMethod(&dm, "querySql", Qt::DirectConnection,
-                                       Q_RETURN_ARG(QString, sql),
-                                       Q_ARG(QString, queryName));
-        if (ok && !sql.trimmed().isEmpty()) {
-            RowVec res;
-            bool ok2 = QMetaObject::invokeMethod(&dm, "executeSql", Qt::DirectConnection,
-                                                 Q_RETURN_ARG(RowVec, res),
-                                                 Q_ARG(QString, sql));
-            if (ok2) { out = res; return true; }
+// Consulta preparada con los valores del reporte. También pasa por la caché
+// de resultados (la clave lleva los valores)
+static bool preparedToRows(const DataSnapshot& snap, const SqlPreparedQuery& p, const QVariantMap& params,
+                           RowVec& out, QString* err) {
+    SqlSelect q;
+    if (!p.bind(params, &q, err)) return false;
+    SqlResultCache& cache = SqlResultCache::instance();
+    const QString key = p.cacheKey(params);
+    SqlResultPtr res = cache.lookup(key, snap);
+    if (!res) {
+        SqlCursor cur;
+        if (!SqlEngine().query(q, snap, &cur, err)) return false;
+        QSharedPointer<SqlResult> all(new SqlResult);
+        all->names = cur.columnNames();
+        while (cur.next()) all->rows.push_back(cur.row());
+        if (!cur.error().isEmpty()) {
+            if (err) *err = cur.error();
+            return false;
         }
+        if (!q.explain) cache.store(key, snap, p.tables(), all);
+        res = all;
+    }
+    resultToRows(*res, out);
+    return true;
+}
+
+// Ejecuta un SELECT sobre el mismo snapshot que el resto del reporte
+// Pasa por la caché de resultados: reabrir un reporte sin cambios en sus
+// tablas no vuelve a ejecutar la consulta
+static bool sqlToRows(const DataSnapshot& snap, const QString& sql, const QVariantMap& params,
+                      RowVec& out, QString* err) {
+    if (!params.isEmpty()) {
+        SqlPreparedQuery p;
+        return SqlEngine().prepare(sql, &p, err) && preparedToRows(snap, p, params, out, err);
     }
+    const SqlResultPtr res = SqlResultCache::instance().fetch(sql, snap, err);
+    if (!res) return false;
+    resultToRows(*res, out);
+    return true;
+}
 
-    // (3) fallback tabla
-    if (!ok && dm.tables().contains(queryName)) {
-        out = rowsFromTable(queryName);
+// Consulta guardada por nombre; si no existe y el nombre es una tabla, se usa la tabla.
+// Las materializadas se leen de su resultado guardado (al día con el snapshot); las
+// demás se preparan una vez por nombre y se ejecutan con los parámetros del reporte
+static bool queryToRows(const DataSnapshot& snap, const QString& queryName, const QVariantMap& params,
+                        RowVec& out, QString* err) {
+    DataModel& dm = DataModel::instance();
+    const QString sql = dm.querySql(queryName);
+    if (!sql.trimmed().isEmpty() && dm.isQueryMaterialized(queryName)) {
+        const SqlResultPtr res = MaterializedQueries::instance().result(queryName, snap, err);
+        if (!res) return false;
+        resultToRows(*res, out);
         return true;
     }
+    if (!sql.trimmed().isEmpty()) {
+        const SqlPreparedPtr p = SqlPreparedCache::instance().get(queryName, err);
+        return p && preparedToRows(snap, *p, params, out, err);
+    }
 
+    if (snap.contains(queryName)) {
+        out = rowsFromTable(snap, queryName);
+        return true;
+    }
+    if (err) *err = QString("Consulta '%1' no se pudo resolver.").arg(queryName);
     return false;
 }
 
-bool ReportEngine::loadSource(const ReportSource& s, QVector<QMap<QString,QVariant>>& outRows, QString* err) {
+bool ReportEngine::loadSource(const ReportSource& s, const DataSnapshot& snap, const QVariantMap& params,
+                              QVector<QMap<QString,QVariant>>& outRows, QString* err) {
     if (s.type == ReportSourceType::Table) {
-        if (!DataModel::instance().tables().contains(s.nameOrSql)) {
+        if (!snap.contains(s.nameOrSql)) {
             if (err) *err = QString("Tabla '%1' no existe.").arg(s.nameOrSql);
             return false;
         }
-        outRows = rowsFromTable(s.nameOrSql);
+        outRows = rowsFromTable(snap, s.nameOrSql);
         return true;
 
     } else if (s.type == ReportSourceType::Query) {
-        RowVec tmp;
-        if (!queryToRows(s.nameOrSql, tmp)) {
-            if (err) *err = QString("Consulta '%1' no se pudo resolver.").arg(s.nameOrSql);
-            return false;
-        }
-        outRows = tmp;
-        return true;
+        return queryToRows(snap, s.nameOrSql, params, outRows, err);
 
     } else { // SQL crudo
-        auto& dm = DataModel::instance();
-        if (dm.metaObject()->indexOfMethod("executeSql(QString)") < 0) {
-            if (err) *err = "El DataModel no expone executeSql(sql).";
-            return false;
-        }
-        RowVec tmp;
-        bool ok = QMetaObject::invokeMethod(&dm, "executeSql", Qt::DirectConnection,
-                                            Q_RETURN_ARG(RowVec, tmp),
-                                            Q_ARG(QString, s.nameOrSql));
-        if (!ok) {
-            if (err) *err = "Falló executeSql(sql).";
-            return false;
-        }
-        outRows = tmp;
-        return true;
+        return sqlToRows(snap, s.nameOrSql, params, outRows, err);
     }
 }
 
+QStringList ReportEngine::parameters(const ReportDef& def) {
+    QStringList out;
+    auto add = [&out](const ReportSource& s) {
+        SqlPreparedPtr p;
+        if (s.type == ReportSourceType::Query) {
+            if (DataModel::instance().querySql(s.nameOrSql).trimmed().isEmpty()) return;   // es una tabla
+            p = SqlPreparedCache::instance().get(s.nameOrSql);
+        } else if (s.type == ReportSourceType::Sql) {
+            QSharedPointer<SqlPreparedQuery> q(new SqlPreparedQuery);
+            if (SqlEngine().prepare(s.nameOrSql, q.data())) p = q;
+        }
+        if (!p) return;
+        for (const QString& n : p->parameters())
+            if (!out.contains(n, Qt::CaseInsensitive)) out << n;
+    };
+    add(def.mainSource);
+    for (const ReportSource& s : def.extraSources) add(s);
+    return out;
+}
+
 // Comparador robusto para QVariant (Qt 6 friendly)
 static inline bool variantLess(const QVariant& a, const QVariant& b)
 {
@@ -163,55 +190,84 @@ static inline bool variantLess(const QVariant& a, const QVariant& b)
 }
 
 // --------- Evaluador simple de filtros ----------
-static bool evalSimpleExpr(const QMap<QString,QVariant>& row, const QString& expr) {
-    // Soporta:
-    //  - "Campo = 10", "Campo != 5", "Campo > 3", "Campo >= 2", "Campo < 7", "Campo <= 1"
-    //  - "Campo LIKE 'Ana%'" (comodín %)
-    //  - "Campo BETWEEN '2023-01-01' AND '2023-12-31'"
-    //  - Comillas simples opcionales; números detectados
-    //  - Campos con espacios: usar tal cual (se busca la clave exacta)
+// Soporta:
+//  - "Campo = 10", "Campo != 5", "Campo > 3", "Campo >= 2", "Campo < 7", "Campo <= 1"
+//  - "Campo [NOT] LIKE 'Ana%'" (comodines % y _, el mismo LIKE del motor SQL)
+//  - "Campo BETWEEN '2023-01-01' AND '2023-12-31'"
+//  - Comillas simples opcionales; números detectados
+//  - Campos con espacios: usar tal cual (se busca la clave exacta)
+// La expresión se analiza una vez por filtro (no por fila).
+struct SimpleFilter {
+    enum class Kind { All, Between, Like, Compare };
+    Kind              kind = Kind::All;     // All: vacío o no reconocido, no filtra
+    QString           col;
+    QString           op;                   // Compare
+    QString           v1, v2;               // Between: extremos; Compare: v1 = lado derecho
+    double            num = 0;              // Compare: v1 como número
+    bool              numOk = false;
+    bool              negated = false;      // NOT LIKE
+    SqlLikeMatcherPtr like;
+};
+
+static SimpleFilter compileSimpleExpr(const QString& expr) {
+    static const QRegularExpression betweenRe(R"(^\s*(.+)\s+BETWEEN\s+(.+)\s+AND\s+(.+)\s*$)", QRegularExpression::CaseInsensitiveOption);
+    static const QRegularExpression likeRe(R"(^\s*(.+?)\s+(NOT\s+)?LIKE\s+(.+)\s*$)", QRegularExpression::CaseInsensitiveOption);
+    static const QRegularExpression cmpRe(R"(^\s*(.+?)\s*(=|!=|>=|<=|>|<)\s*(.+?)\s*$)");
+
+    SimpleFilter f;
     const QString e = expr.trimmed();
-    if (e.isEmpty()) return true;
+    if (e.isEmpty()) return f;
 
-    // BETWEEN
-    QRegularExpression betweenRe(R"(^\s*(.+)\s+BETWEEN\s+(.+)\s+AND\s+(.+)\s*$)", QRegularExpression::CaseInsensitiveOption);
     auto mb = betweenRe.match(e);
     if (mb.hasMatch()) {
-        const QString col = norm(mb.captured(1));
-        const QString v1s = norm(mb.captured(2)).remove('\'').remove('"');
-        const QString v2s = norm(mb.captured(3)).remove('\'').remove('"');
-        const QString val = row.value(col).toString();
-        return (val >= v1s && val <= v2s);
+        f.kind = SimpleFilter::Kind::Between;
+        f.col = norm(mb.captured(1));
+        f.v1 = norm(mb.captured(2)).remove('\'').remove('"');
+        f.v2 = norm(mb.captured(3)).remove('\'').remove('"');
+        return f;
     }
 
-    // LIKE
-    QRegularExpression likeRe(R"(^\s*(.+)\s+LIKE\s+(.+)\s*$)", QRegularExpression::CaseInsensitiveOption);
     auto ml = likeRe.match(e);
     if (ml.hasMatch()) {
-        const QString col = norm(ml.captured(1));
-        QString pat = norm(ml.captured(2)).remove('\'').remove('"');
-        // % -> .*
-        pat = QRegularExpression::escape(pat);
-        pat.replace("%", ".*");
-        QRegularExpression rx("^" + pat + "$", QRegularExpression::CaseInsensitiveOption);
-        return rx.match(row.value(col).toString()).hasMatch();
+        f.kind = SimpleFilter::Kind::Like;
+        f.col = norm(ml.captured(1));
+        f.negated = !ml.captured(2).isEmpty();
+        f.like.reset(new SqlLikeMatcher(norm(ml.captured(3)).remove('\'').remove('"')));
+        return f;
     }
 
-    // Comparadores simples
-    QRegularExpression cmpRe(R"(^\s*(.+?)\s*(=|!=|>=|<=|>|<)\s*(.+?)\s*$)");
     auto mc = cmpRe.match(e);
     if (mc.hasMatch()) {
-        const QString col = norm(mc.captured(1));
-        const QString op  = mc.captured(2);
-        QString rhs = norm(mc.captured(3)).remove('\'').remove('"');
+        f.kind = SimpleFilter::Kind::Compare;
+        f.col = norm(mc.captured(1));
+        f.op  = mc.captured(2);
+        f.v1  = norm(mc.captured(3)).remove('\'').remove('"');
+        f.num = f.v1.toDouble(&f.numOk);
+    }
+    return f;
+}
+
+static bool evalSimpleExpr(const QMap<QString,QVariant>& row, const SimpleFilter& f) {
+    switch (f.kind) {
+    case SimpleFilter::Kind::All:
+        return true;        // vacío o no se pudo parsear: no filtrar
 
-        const QVariant lv = row.value(col);
+    case SimpleFilter::Kind::Between: {
+        const QString val = row.value(f.col).toString();
+        return (val >= f.v1 && val <= f.v2);
+    }
+
+    case SimpleFilter::Kind::Like:
+        return f.like->matches(row.value(f.col).toString()) != f.negated;
+
+    case SimpleFilter::Kind::Compare: {
+        const QString& op = f.op;
+        const QVariant lv = row.value(f.col);
         bool okNum = false;
         const double lnum = lv.toDouble(&okNum);
-        bool rhsNumOk = false;
-        double rnum = rhs.toDouble(&rhsNumOk);
 
-        if (okNum && rhsNumOk) {
+        if (okNum && f.numOk) {
+            const double rnum = f.num;
             if (op=="=")  return lnum == rnum;
             if (op=="!=") return lnum != rnum;
             if (op==">")  return lnum >  rnum;
@@ -220,6 +276,7 @@ static bool evalSimpleExpr(const QMap<QString,QVariant>& row, const QString& exp
             if (op=="<=") return lnum <= rnum;
         } else {
             const QString ls = lv.toString();
+            const QString& rhs = f.v1;
             if (op=="=")  return ls == rhs;
             if (op=="!=") return ls != rhs;
             if (op==">")  return ls >  rhs;
@@ -227,9 +284,9 @@ static bool evalSimpleExpr(const QMap<QString,QVariant>& row, const QString& exp
             if (op=="<")  return ls <  rhs;
             if (op=="<=") return ls <= rhs;
         }
+        return true;
+    }
     }
-
-    // Si no se pudo parsear, no filtrar
     return true;
 }
 
@@ -279,12 +336,15 @@ bool ReportEngine::applyJoin(const JoinDef& j,
 
 void ReportEngine::applyFilters(const QVector<FilterDef>& filters, QVector<QMap<QString,QVariant>>& io) {
     if (filters.isEmpty()) return;
+    QVector<SimpleFilter> compiled;
+    compiled.reserve(filters.size());
+    for (const auto& f : filters) compiled.push_back(compileSimpleExpr(f.expr));
     QVector<QMap<QString,QVariant>> out;
     out.reserve(io.size());
     for (const auto& r : io) {
         bool keep = true;
-        for (const auto& f : filters) {
-            if (!evalSimpleExpr(r, f.expr)) { keep = false; break; }
+        for (const auto& f : compiled) {
+            if (!evalSimpleExpr(r, f)) { keep = false; break; }
         }
         if (keep) out.push_back(r);
     }
@@ -305,6 +365,52 @@ void ReportEngine::applySorts(const QVector<SortDef>& sorts, QVector<QMap<QStrin
     });
 }
 
+// Una pasada por ámbito: los AggDef de un mismo scope comparten el agregador
+void ReportEngine::computeAggregates(const QVector<AggDef>& aggs, const RowVec& rows,
+                                     QVector<ReportAggValue>& out) const {
+    QStringList scopes;
+    for (const auto& a : aggs)
+        if (a.fn != AggFn::None && !scopes.contains(norm(a.scope))) scopes << norm(a.scope);
+
+    for (const QString& scope : scopes) {
+        const QString groupField = scope.startsWith("group:", Qt::CaseInsensitive) ? norm(scope.mid(6)) : QString();
+        QVector<AggDef> defs;
+        QVector<SqlAggFn> fns;
+        for (const auto& a : aggs) {
+            if (a.fn == AggFn::None || norm(a.scope) != scope) continue;
+            defs << a;
+            switch (a.fn) {
+            case AggFn::Sum:   fns << SqlAggFn::Sum;   break;
+            case AggFn::Count: fns << SqlAggFn::Count; break;
+            case AggFn::Avg:   fns << SqlAggFn::Avg;   break;
+            case AggFn::Min:   fns << SqlAggFn::Min;   break;
+            default:           fns << SqlAggFn::Max;   break;
+            }
+        }
+
+        SqlAggregator agg(fns);
+        Record group, args(defs.size());
+        for (const auto& r : rows) {
+            if (!groupField.isEmpty()) group = Record{ r.value(groupField) };
+            for (int i = 0; i < defs.size(); ++i) args[i] = r.value(defs[i].field);
+            agg.add(group, args);
+        }
+        if (groupField.isEmpty()) agg.ensureGroup();
+
+        for (int g = 0; g < agg.groupCount(); ++g) {
+            const Record res = agg.results(g);
+            for (int i = 0; i < defs.size(); ++i) {
+                ReportAggValue v;
+                v.label = QString("%1(%2)").arg(aggToString(defs[i].fn), defs[i].field);
+                v.groupField = groupField;
+                v.groupValue = agg.groupValues(g).value(0);
+                v.value = res[i];
+                out.push_back(v);
+            }
+        }
+    }
+}
+
 QStringList ReportEngine::inferHeaders(const ReportDef& def, const RowVec& raw) const {
     // Si el usuario definió fields → respetar orden/alias
     if (!def.fields.isEmpty()) {
@@ -319,13 +425,18 @@ QStringList ReportEngine::inferHeaders(const ReportDef& def, const RowVec& raw)
 }
 
 bool ReportEngine::build(const ReportDef& def, ReportDataset* out, QString* err) {
+    // Un solo snapshot para todas las fuentes: joins entre tablas ven el mismo instante
+    return build(def, DataModel::instance().snapshot(), out, err);
+}
+
+bool ReportEngine::build(const ReportDef& def, const DataSnapshot& snap, ReportDataset* out, QString* err) {
     if (!out) { if(err)*err="Parámetro de salida nulo."; return false; }
 
     // 1) cargar origen principal
     RowVec cur;
     {
         QVector<QMap<QString,QVariant>> tmp;
-        if (!loadSource(def.mainSource, tmp, err)) {
+        if (!loadSource(def.mainSource, snap, def.parameters, tmp, err)) {
             // no crashear: dataset vacío
             out->clear();
             return false;
@@ -341,7 +452,7 @@ bool ReportEngine::build(const ReportDef& def, ReportDataset* out, QString* err)
     for (int i=0;i<def.extraSources.size();++i) {
         QVector<QMap<QString,QVariant>> tmp;
         QString e2;
-        if (loadSource(def.extraSources[i], tmp, &e2)) {
+        if (loadSource(def.extraSources[i], snap, def.parameters, tmp, &e2)) {
             const QString key = QString("s%1").arg(i+1);
             sources.insert(key, tmp);
         }
@@ -404,5 +515,8 @@ bool ReportEngine::build(const ReportDef& def, ReportDataset* out, QString* err)
         out->rows.push_back(rr);
     }
 
+    // 7) agregados sobre las filas finales (antes del alias de campos)
+    computeAggregates(def.aggregates, cur, out->aggregates);
+
     return true;
 }
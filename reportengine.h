@@ -11,18 +11,29 @@
 
 // Forward declaration para evitar dependencias duras
 class DataModel;
+class DataSnapshot;
 
 struct ReportRow {
     // mapa de columna→valor, resultado final tras joins/filtros
     QMap<QString, QVariant> cols;
 };
 
+// Resultado de un AggDef: uno por grupo (scope "group:<campo>") o uno solo
+// para todo el reporte (groupField vacío)
+struct ReportAggValue {
+    QString  label;        // p. ej. "sum(Importe)"
+    QString  groupField;
+    QVariant groupValue;
+    QVariant value;
+};
+
 class ReportDataset {
 public:
     QVector<ReportRow> rows;
     QStringList headers; // orden de columnas finales
+    QVector<ReportAggValue> aggregates;
 
-    void clear() { rows.clear(); headers.clear(); }
+    void clear() { rows.clear(); headers.clear(); aggregates.clear(); }
     int rowCount() const { return rows.size(); }
 
     QVariant value(int r, const QString& col) const {
@@ -41,12 +52,20 @@ public:
     // 2) joins (comparaciones entre tablas/consultas)
     // 3) filtros
     // 4) ordenaciones
+    // 5) agregados (AggDef) con el mismo agregador por hash que GROUP BY
     // Devuelve false si algo crítico falla (pero sin crashear)
     bool build(const ReportDef& def, ReportDataset* out, QString* err=nullptr);
+    // Igual, pero leyendo las tablas de un snapshot (no ve ediciones posteriores;
+    // puede correr en otro hilo sin bloquear al que escribe)
+    bool build(const ReportDef& def, const DataSnapshot& snap, ReportDataset* out, QString* err=nullptr);
+
+    // Parámetros que piden las consultas de origen (def.parameters da sus valores)
+    static QStringList parameters(const ReportDef& def);
 
 private:
     // Utils
-    bool loadSource(const ReportSource& s, QVector<QMap<QString,QVariant>>& outRows, QString* err);
+    bool loadSource(const ReportSource& s, const DataSnapshot& snap, const QVariantMap& params,
+                    QVector<QMap<QString,QVariant>>& outRows, QString* err);
     bool applyJoin(const JoinDef& j,
                    const QVector<QMap<QString,QVariant>>& left,
                    const QVector<QMap<QString,QVariant>>& right,
@@ -54,6 +73,8 @@ private:
                    QString* err);
     void applyFilters(const QVector<FilterDef>& filters, QVector<QMap<QString,QVariant>>& io);
     void applySorts(const QVector<SortDef>& sorts, QVector<QMap<QString,QVariant>>& io);
+    void computeAggregates(const QVector<AggDef>& aggs, const QVector<QMap<QString,QVariant>>& rows,
+                           QVector<ReportAggValue>& out) const;
     QStringList inferHeaders(const ReportDef& def, const QVector<QMap<QString,QVariant>>& raw) const;
 };
 
@@ -53,6 +53,18 @@ QString ReportRenderer::toHtml(const ReportDef& def, const ReportDataset& ds) co
     }
     h += "</tbody></table>";
 
+    if (!ds.aggregates.isEmpty()) {
+        h += "<table style='margin-top:8px; width:auto;'><thead><tr><th>Ámbito</th><th>Agregado</th><th>Valor</th></tr></thead><tbody>";
+        for (const auto& a : ds.aggregates) {
+            const QString scope = a.groupField.isEmpty()
+                ? QString("Reporte")
+                : QString("%1 = %2").arg(a.groupField, a.groupValue.toString());
+            h += "<tr><td>" + scope.toHtmlEscaped() + "</td><td>" + a.label.toHtmlEscaped()
+               + "</td><td>" + a.value.toString().toHtmlEscaped() + "</td></tr>";
+        }
+        h += "</tbody></table>";
+    }
+
     if (def.layout.showFooter)
         h += QString("<div style='margin-top:8px;color:#666;'>Filas: %1</div>").arg(ds.rowCount());
 
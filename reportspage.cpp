@@ -1,6 +1,7 @@
 #include "reportspage.h"
 #include "reportwizard.h"
 #include "datamodel.h"
+#include "paramprompt.h"
 #include <QHBoxLayout>
 #include <QVBoxLayout>
 #include <QListWidget>
@@ -72,8 +73,11 @@ void ReportsPage::openReport(const QString& name) {
 
 void ReportsPage::renderCurrent() {
     ds_.clear();
+    // Los parámetros sin valor guardado se piden en cada apertura
+    ReportDef def = current_;
+    if (!askQueryParameters(this, ReportEngine::parameters(def), &def.parameters)) return;
     QString err;
-    if (!engine_.build(current_, &ds_, &err)) {
+    if (!engine_.build(def, &ds_, &err)) {
         preview_->setHtml(QString("<html><body><div style='color:#900;'>%1</div></body></html>").arg(err.toHtmlEscaped()));
         return;
     }
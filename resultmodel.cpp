@@ -0,0 +1,127 @@
+#include "resultmodel.h"
+
+SqlResultModel::SqlResultModel(QObject* parent) : QAbstractTableModel(parent) {}
+
+/* ======================== Origen de filas ======================== */
+void SqlResultModel::setResult(SqlResultPtr res)
+{
+    beginResetModel();
+    m_cursor.close();
+    m_cursor = SqlCursor();
+    m_rows.clear();
+    m_result = std::move(res);
+    m_names = m_result ? m_result->names : QStringList();
+    m_sourceDone = true;
+    m_visible = 0;
+    endResetModel();
+    fetchMore(QModelIndex());
+}
+
+void SqlResultModel::setCursor(SqlCursor cur)
+{
+    beginResetModel();
+    m_cursor.close();
+    m_result.reset();
+    m_rows.clear();
+    m_names = cur.columnNames();
+    m_sourceDone = !cur.isValid();
+    m_cursor = std::move(cur);
+    m_visible = 0;
+    endResetModel();
+    fetchMore(QModelIndex());
+}
+
+void SqlResultModel::beginStream(const QStringList& names)
+{
+    beginResetModel();
+    m_cursor.close();
+    m_cursor = SqlCursor();
+    m_result.reset();
+    m_rows.clear();
+    m_names = names;
+    m_sourceDone = false;
+    m_visible = 0;
+    endResetModel();
+}
+
+void SqlResultModel::appendRows(const QVector<Record>& rows)
+{
+    m_rows += rows;
+    // La primera página se muestra sola; el resto, cuando la vista lo pida
+    if (m_visible < kFetchBatch) fetchMore(QModelIndex());
+}
+
+void SqlResultModel::endStream()
+{
+    m_sourceDone = true;
+    if (m_visible < kFetchBatch) fetchMore(QModelIndex());
+}
+
+void SqlResultModel::clear()
+{
+    beginResetModel();
+    m_cursor.close();
+    m_cursor = SqlCursor();
+    m_result.reset();
+    m_rows.clear();
+    m_names.clear();
+    m_sourceDone = true;
+    m_visible = 0;
+    endResetModel();
+}
+
+bool SqlResultModel::isComplete() const
+{
+    return m_sourceDone && m_visible >= available();
+}
+
+/* ========================= Paginación ========================= */
+bool SqlResultModel::canFetchMore(const QModelIndex& parent) const
+{
+    if (parent.isValid()) return false;
+    return m_visible < available() || (m_cursor.isValid() && !m_sourceDone);
+}
+
+void SqlResultModel::fetchMore(const QModelIndex& parent)
+{
+    if (!canFetchMore(parent)) return;
+    if (m_visible >= available()) {
+        // Cursor: se lee del motor (m_rows no es visible hasta subir m_visible)
+        int read = 0;
+        while (read < kFetchBatch && m_cursor.next()) { m_rows.push_back(m_cursor.row()); ++read; }
+        if (read < kFetchBatch) m_sourceDone = true;
+    }
+    const int n = qMin(kFetchBatch, available() - m_visible);
+    if (n > 0) {
+        beginInsertRows(QModelIndex(), m_visible, m_visible + n - 1);
+        m_visible += n;
+        endInsertRows();
+    }
+    emit rowsFetched(m_visible, isComplete());
+}
+
+/* =========================== Celdas =========================== */
+int SqlResultModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : m_visible;
+}
+
+int SqlResultModel::columnCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : m_names.size();
+}
+
+QVariant SqlResultModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_visible || index.column() >= m_names.size()) return {};
+    if (role != Qt::DisplayRole && role != Qt::ToolTipRole) return {};
+    // Texto solo de la celda pedida (lo que antes se hacía para todas al cargar)
+    return rowAt(index.row()).value(index.column()).toString();
+}
+
+QVariant SqlResultModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole) return {};
+    if (orientation == Qt::Horizontal) return m_names.value(section);
+    return section + 1;
+}
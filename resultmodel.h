@@ -0,0 +1,58 @@
+#ifndef RESULTMODEL_H
+#define RESULTMODEL_H
+
+#include <QAbstractTableModel>
+#include <QStringList>
+#include <QVector>
+
+#include "sqlengine.h"
+#include "sqlcache.h"
+
+/* ================== Modelo de resultados (vistas) ================== */
+// Resultado de un SELECT para un QTableView. No crea un ítem por celda: guarda
+// las filas (o una referencia al resultado de la caché) y convierte a texto
+// solo las celdas que la vista pinta. Las filas se exponen por páginas con
+// fetchMore; con un cursor, además, se leen del motor recién cuando la vista
+// las pide. En modo stream llegan por lotes desde otro hilo (SqlQueryJob).
+class SqlResultModel : public QAbstractTableModel {
+    Q_OBJECT
+public:
+    static constexpr int kFetchBatch = 1000;   // filas por página
+
+    explicit SqlResultModel(QObject* parent = nullptr);
+
+    void setResult(SqlResultPtr res);   // resultado completo (p. ej. de SqlResultCache)
+    void setCursor(SqlCursor cur);      // se lee a medida que la vista avanza
+    void beginStream(const QStringList& names);   // filas por appendRows hasta endStream
+    void appendRows(const QVector<Record>& rows);
+    void endStream();
+    void clear();
+
+    const QStringList& columnNames() const { return m_names; }
+    bool isComplete() const;            // no quedan filas por traer
+    QString error() const { return m_cursor.error(); }   // modo cursor: la ejecución falló
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    bool canFetchMore(const QModelIndex& parent) const override;
+    void fetchMore(const QModelIndex& parent) override;
+
+signals:
+    // Tras cada página: filas expuestas y si ya están todas
+    void rowsFetched(int rows, bool complete);
+
+private:
+    const Record& rowAt(int r) const { return m_result ? m_result->rows[r] : m_rows[r]; }
+    int available() const { return m_result ? int(m_result->rows.size()) : int(m_rows.size()); }
+
+    QStringList     m_names;
+    SqlResultPtr    m_result;       // modo resultado: filas compartidas con la caché
+    SqlCursor       m_cursor;       // modo cursor: filas traídas en m_rows
+    QVector<Record> m_rows;         // modo cursor / stream
+    bool            m_sourceDone = true;   // no llegarán más filas a m_rows
+    int             m_visible = 0;  // filas ya expuestas a la vista
+};
+
+#endif // RESULTMODEL_H
@@ -3,6 +3,7 @@
 #include "recordspage.h"
 #include "datamodel.h"
 #include "querypage.h"   // <<< NUEVO
+#include "matview.h"
 #include "accessquerydesigner.h" // <<< NUEVO: diseñador visual en clase aparte
 
 // ====== Reportes (NUEVO) ======
@@ -1170,10 +1171,11 @@ private:
 
     void loadTable(const QString& t) {
         table_ = t;
-        schema_ = DataModel::instance().schema(t);
+        tableId_ = DataModel::instance().tableId(t);   // se resuelve el nombre una sola vez
+        schema_ = DataModel::instance().schemaRef(tableId_);
         buildEditors();
         current_ = 0;
-        total_ = DataModel::instance().rowCount(t);
+        total_ = DataModel::instance().rowCount(tableId_);
         updatePos();
         mode_ = Mode::View;
         btnSave_->setEnabled(false);
@@ -1186,11 +1188,11 @@ private:
     void loadCurrentRowIntoEditors() {
         if (table_.isEmpty() || total_==0) { clearEditors(); return; }
 
-        // Tu DataModel expone rows(table) -> lista de Record
-        const auto recs = DataModel::instance().rows(table_);
-        if (current_ < 0 || current_ >= recs.size()) { clearEditors(); return; }
+        // Solo se materializa la fila actual (Record vacío si es hueco/fuera de rango)
+        const ColumnTable& tab = DataModel::instance().columnTable(tableId_);
+        if (current_ < 0 || current_ >= tab.slotCount()) { clearEditors(); return; }
 
-        const auto rec = recs.value(current_); // value() evita crash si hay out-of-range
+        const Record rec = tab.record(current_);
         for (int i=0; i<schema_.size() && i<rec.size(); ++i) {
             setEditor(editors_[i], schema_[i], rec[i]);
         }
@@ -1200,10 +1202,10 @@ private:
     void deleteCurrentRow() {
         if (table_.isEmpty() || total_==0) return;
         QString err;
-        if (!DataModel::instance().removeRows(table_, {current_}, &err)) {
+        if (!DataModel::instance().removeRows(tableId_, {current_}, &err)) {
             QMessageBox::warning(this, tr("Eliminar"), err); return;
         }
-        total_ = DataModel::instance().rowCount(table_);
+        total_ = DataModel::instance().rowCount(tableId_);
         if (current_ >= total_) current_ = qMax(0, total_-1);
         updatePos();
         loadCurrentRowIntoEditors();
@@ -1218,17 +1220,17 @@ private:
 
         QString err;
         if (mode_ == Mode::New) {
-            if (!DataModel::instance().insertRow(table_, r, &err)) {
+            if (!DataModel::instance().insertRow(tableId_, r, &err)) {
                 QMessageBox::warning(this, tr("Guardar"), err); return;
             }
-            total_ = DataModel::instance().rowCount(table_);
+            total_ = DataModel::instance().rowCount(tableId_);
             current_ = total_>0 ? total_-1 : 0;
             updatePos();
             mode_ = Mode::View;
             btnSave_->setEnabled(false);
             QMessageBox::information(this, tr("Guardar"), tr("Registro insertado."));
         } else if (mode_ == Mode::Edit) {
-            if (!DataModel::instance().updateRow(table_, current_, r, &err)) {
+            if (!DataModel::instance().updateRow(tableId_, current_, r, &err)) {
                 QMessageBox::warning(this, tr("Guardar"), err); return;
             }
             QMessageBox::information(this, tr("Guardar"), tr("Registro actualizado."));
@@ -1247,6 +1249,7 @@ private:
 
     // Estado
     QString table_;
+    TableId tableId_ = kInvalidTableId;
     Schema  schema_;
     QVector<QWidget*> editors_;
     int current_ = 0;
@@ -1646,28 +1649,48 @@ ShellWindow::ShellWindow(QWidget* parent) : QMainWindow(parent) {
     listQueries->setFrameShape(QFrame::NoFrame);
     listQueries->setStyleSheet("QListWidget{border:none;} QListWidget::item{padding:6px 8px;}");
 
+    // Las materializadas van en cursiva: se leen de su resultado guardado
     auto refreshQueries = [listQueries](){
         listQueries->clear();
-        for (auto& n : DataModel::instance().queries()) listQueries->addItem(n);
+        for (auto& n : DataModel::instance().queries()) {
+            auto *it = new QListWidgetItem(n, listQueries);
+            if (!DataModel::instance().isQueryMaterialized(n)) continue;
+            QFont f = it->font();
+            f.setItalic(true);
+            it->setFont(f);
+            it->setToolTip(MaterializedQueries::isIncremental(n)
+                               ? "Materializada: se actualiza con cada cambio de la tabla"
+                               : "Materializada: se recalcula al leerla si sus tablas cambiaron");
+        }
     };
     refreshQueries();
     QObject::connect(&DataModel::instance(), &DataModel::queriesChanged, this, refreshQueries);
+    MaterializedQueries::instance();   // desde ya escucha los cambios de filas
+
+    listQueries->setContextMenuPolicy(Qt::CustomContextMenu);
+    QObject::connect(listQueries, &QListWidget::customContextMenuRequested, this, [=](const QPoint& pos){
+        QListWidgetItem* it = listQueries->itemAt(pos);
+        if (!it) return;
+        const QString name = it->text();
+        QMenu menu;
+        QAction* mat = menu.addAction("Materializar");
+        mat->setCheckable(true);
+        mat->setChecked(DataModel::instance().isQueryMaterialized(name));
+        if (menu.exec(listQueries->viewport()->mapToGlobal(pos)) != mat) return;
+        QString err;
+        if (!DataModel::instance().setQueryMaterialized(name, mat->isChecked(), &err))
+            QMessageBox::warning(this, "Consultas", err);
+    });
 
     v->addWidget(hdrQ);
     v->addWidget(listQueries, 1);
 
-    // abrir una consulta al hacer doble‐clic
+    // abrir (y ejecutar) una consulta al hacer doble‐clic
+    queriesList = listQueries;
     QObject::connect(listQueries, &QListWidget::itemDoubleClicked, this, [=](QListWidgetItem* it){
         if (!it) return;
-        auto *stack = findChild<QStackedWidget*>("contentStack");
-        QueryPage* qp=nullptr;
-        for (int i=0;i<stack->count();++i) if ((qp=qobject_cast<QueryPage*>(stack->widget(i)))) break;
-        if (!qp) return;
-        // fuerza cargar en QueryPage:
-        // (si seguiste el snippet del combo en QueryPage, basta con setear el texto y ejecutar)
-        stack->setCurrentWidget(qp);
-        // llamar a un método helper en QueryPage (crea uno si quieres) para cargar por nombre
-        QMetaObject::invokeMethod(qp, "loadSavedByName", Qt::DirectConnection, Q_ARG(QString, it->text()));
+        listQueries->setCurrentItem(it);
+        onRunSelectedQuery();
     });
 
 
@@ -2244,6 +2267,22 @@ QWidget* ShellWindow::buildDBToolsRibbon() {
     return wrap;
 }
 
+// Carga la consulta guardada seleccionada en QueryPage y la ejecuta; si sus
+// tablas no cambiaron desde la última vez, el resultado sale de la caché
+void ShellWindow::onRunSelectedQuery()
+{
+    QListWidgetItem* it = queriesList ? queriesList->currentItem() : nullptr;
+    if (!it) return;
+    auto *stack = findChild<QStackedWidget*>("contentStack");
+    if (!stack) return;
+    QueryPage* qp=nullptr;
+    for (int i=0;i<stack->count();++i) if ((qp=qobject_cast<QueryPage*>(stack->widget(i)))) break;
+    if (!qp) return;
+    stack->setCurrentWidget(qp);
+    QMetaObject::invokeMethod(qp, "loadSavedByName", Qt::DirectConnection, Q_ARG(QString, it->text()));
+    QMetaObject::invokeMethod(qp, "runQuery", Qt::DirectConnection);
+}
+
 // ======== Stubs de compatibilidad (evitan "undefined reference") ========
 void ShellWindow::refreshSavedQueries() {}
 void ShellWindow::onQueryActivated(QListWidgetItem*) {}
@@ -2252,7 +2291,6 @@ void ShellWindow::onNewQuery() {}
 void ShellWindow::onRenameSelectedQuery() {}
 void ShellWindow::onDeleteSelectedQuery() {}
 void ShellWindow::onOpenInDesigner() {}
-void ShellWindow::onRunSelectedQuery() {}
 void ShellWindow::onDesignerSaved(const QString&) {}
 // ========================================================================
 
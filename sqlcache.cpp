@@ -0,0 +1,254 @@
+#include "sqlcache.h"
+#include "sqlengine.h"
+#include "datamodel.h"
+
+#include <QMutexLocker>
+
+// Lo que ocupa un resultado en memoria, aproximado
+static qint64 resultBytes(const SqlResult& r)
+{
+    qint64 b = 64;
+    for (const QString& n : r.names) b += 32 + n.size() * qint64(sizeof(QChar));
+    for (const Record& row : r.rows) {
+        b += 32 + row.size() * qint64(sizeof(QVariant));
+        for (const QVariant& v : row)
+            if (v.typeId() == QMetaType::QString) b += v.toString().size() * qint64(sizeof(QChar));
+    }
+    return b;
+}
+
+/* ====================== Singleton ====================== */
+SqlResultCache& SqlResultCache::instance()
+{
+    static SqlResultCache inst;
+    return inst;
+}
+
+SqlResultCache::SqlResultCache()
+{
+    // Las versiones ya impiden usar un resultado viejo; esto libera la memoria
+    // en cuanto una tabla leída cambia
+    DataModel& dm = DataModel::instance();
+    auto drop = [this](const QString& table) { invalidateTable(table); };
+    QObject::connect(&dm, &DataModel::rowsChanged,   &dm, drop);
+    QObject::connect(&dm, &DataModel::tableDropped,  &dm, drop);
+    QObject::connect(&dm, &DataModel::schemaChanged, &dm, [this](const QString& table, const Schema&) {
+        invalidateTable(table);
+    });
+}
+
+/* ====================== Normalización ====================== */
+QString SqlResultCache::normalize(const QString& sql)
+{
+    QString out;
+    out.reserve(sql.size());
+    QChar quote;            // dentro de '...', "...", `...` o [...]
+    bool pendingSpace = false;
+    for (const QChar ch : sql) {
+        if (!quote.isNull()) {
+            out += ch;
+            if (ch == quote) quote = QChar();
+            continue;
+        }
+        if (ch.isSpace()) { pendingSpace = true; continue; }
+        if (pendingSpace && !out.isEmpty()) out += ' ';
+        pendingSpace = false;
+        out += ch;
+        if (ch == '\'' || ch == '"' || ch == '`') quote = ch;
+        else if (ch == '[') quote = ']';
+    }
+    while (out.endsWith(';') || out.endsWith(' ')) out.chop(1);
+    return out;
+}
+
+/* ========================= Consulta ========================= */
+SqlResultPtr SqlResultCache::lookup(const QString& sql, const DataSnapshot& snap)
+{
+    const QString key = normalize(sql);
+    QMutexLocker lock(&m_mutex);
+    auto it = m_entries.find(key);
+    if (it != m_entries.end()) {
+        bool fresh = true;
+        for (auto v = it->versions.cbegin(); v != it->versions.cend() && fresh; ++v)
+            fresh = snap.contains(v.key()) && snap.version(v.key()) == v.value();
+        if (fresh) {
+            m_lru.splice(m_lru.begin(), m_lru, it->lru);
+            ++m_hits;
+            return it->result;
+        }
+        eraseLocked(it);
+    }
+    ++m_misses;
+    return {};
+}
+
+void SqlResultCache::store(const QString& sql, const DataSnapshot& snap, const QStringList& tables,
+                           SqlResultPtr res)
+{
+    Entry e;
+    for (const QString& t : tables) {
+        if (!snap.contains(t)) return;      // no se puede fechar: no se guarda
+        e.versions.insert(t, snap.version(t));
+    }
+    e.result = res;
+    e.bytes = resultBytes(*res);
+
+    const QString key = normalize(sql);
+    QMutexLocker lock(&m_mutex);
+    if (e.bytes > m_budget) return;
+    auto old = m_entries.find(key);
+    if (old != m_entries.end()) eraseLocked(old);
+    m_lru.push_front(key);
+    e.lru = m_lru.begin();
+    m_bytes += e.bytes;
+    m_entries.insert(key, e);
+    evictLocked();
+}
+
+SqlResultPtr SqlResultCache::fetch(const QString& sql, const DataSnapshot& snap, QString* err,
+                                   bool* hit)
+{
+    SqlResultPtr cached = lookup(sql, snap);
+    if (hit) *hit = !cached.isNull();
+    if (cached) return cached;
+
+    SqlStatement st;
+    if (!SqlParser::parse(sql, &st, err)) return {};
+    if (st.kind != SqlStatement::Kind::Select) {
+        if (err) *err = "Solo se pueden consultar sentencias SELECT.";
+        return {};
+    }
+    SqlEngine engine;
+    SqlCursor cur;
+    if (!engine.query(st.select, snap, &cur, err)) return {};
+    QSharedPointer<SqlResult> res(new SqlResult);
+    res->names = cur.columnNames();
+    while (cur.next()) res->rows.push_back(cur.row());
+    if (!cur.error().isEmpty()) {
+        if (err) *err = cur.error();
+        return {};
+    }
+    if (!st.select.explain) store(sql, snap, engine.tablesOf(st), res);
+    return res;
+}
+
+/* ======================== Invalidación ======================== */
+void SqlResultCache::invalidateTable(const QString& table)
+{
+    QMutexLocker lock(&m_mutex);
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        if (it->versions.contains(table)) {
+            m_lru.erase(it->lru);
+            m_bytes -= it->bytes;
+            it = m_entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void SqlResultCache::clear()
+{
+    QMutexLocker lock(&m_mutex);
+    m_entries.clear();
+    m_lru.clear();
+    m_bytes = 0;
+}
+
+void SqlResultCache::eraseLocked(QHash<QString, Entry>::iterator it)
+{
+    m_lru.erase(it->lru);
+    m_bytes -= it->bytes;
+    m_entries.erase(it);
+}
+
+void SqlResultCache::evictLocked()
+{
+    while (m_bytes > m_budget && !m_lru.empty())
+        eraseLocked(m_entries.find(m_lru.back()));
+}
+
+/* ====================== Presupuesto / métricas ====================== */
+void SqlResultCache::setBudget(qint64 bytes)
+{
+    QMutexLocker lock(&m_mutex);
+    m_budget = qMax<qint64>(0, bytes);
+    evictLocked();
+}
+
+qint64 SqlResultCache::budget() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_budget;
+}
+
+qint64 SqlResultCache::bytesUsed() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_bytes;
+}
+
+quint64 SqlResultCache::hits() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_hits;
+}
+
+quint64 SqlResultCache::misses() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_misses;
+}
+
+/* ================= Consultas guardadas preparadas ================= */
+SqlPreparedCache& SqlPreparedCache::instance()
+{
+    static SqlPreparedCache inst;
+    return inst;
+}
+
+SqlPreparedCache::SqlPreparedCache()
+{
+    // Un [Nombre] puede pasar de parámetro a columna (o al revés) con el esquema
+    DataModel& dm = DataModel::instance();
+    auto drop = [this](const QString& table) { invalidateTable(table); };
+    QObject::connect(&dm, &DataModel::tableDropped,  &dm, drop);
+    QObject::connect(&dm, &DataModel::schemaChanged, &dm, [this](const QString& table, const Schema&) {
+        invalidateTable(table);
+    });
+}
+
+QSharedPointer<const SqlPreparedQuery> SqlPreparedCache::get(const QString& name, QString* err)
+{
+    const QString key = name.trimmed().toLower();
+    const QString sql = DataModel::instance().querySql(name);
+    if (sql.trimmed().isEmpty()) {
+        if (err) *err = QString("Consulta '%1' no existe.").arg(name);
+        return {};
+    }
+    {
+        QMutexLocker lock(&m_mutex);
+        const auto it = m_entries.constFind(key);
+        if (it != m_entries.constEnd() && (*it)->sql() == sql) return *it;
+    }
+    QSharedPointer<SqlPreparedQuery> p(new SqlPreparedQuery);
+    if (!SqlEngine().prepare(sql, p.data(), err)) return {};
+    QMutexLocker lock(&m_mutex);
+    m_entries.insert(key, p);
+    return p;
+}
+
+void SqlPreparedCache::invalidateTable(const QString& table)
+{
+    QMutexLocker lock(&m_mutex);
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        if ((*it)->tables().contains(table, Qt::CaseInsensitive)) it = m_entries.erase(it);
+        else ++it;
+    }
+}
+
+void SqlPreparedCache::clear()
+{
+    QMutexLocker lock(&m_mutex);
+    m_entries.clear();
+}
@@ -0,0 +1,105 @@
+#ifndef SQLCACHE_H
+#define SQLCACHE_H
+
+#include <QHash>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <list>
+
+#include "columnstore.h"
+
+class DataSnapshot;
+class SqlPreparedQuery;
+
+/* ===================== Caché de resultados ===================== */
+// Filas completas de un SELECT, tal como las entregó el cursor
+struct SqlResult {
+    QStringList     names;
+    QVector<Record> rows;
+};
+using SqlResultPtr = QSharedPointer<const SqlResult>;
+
+// Resultados de SELECT por texto SQL normalizado. Cada entrada guarda la
+// versión (TableData::version) de cada tabla que leyó y solo se reutiliza si
+// el snapshot de la consulta trae exactamente esas versiones; además, al
+// cambiar una tabla se descartan de inmediato las entradas que la leen. Por
+// encima del presupuesto se desalojan las menos usadas recientemente (LRU).
+// Se puede usar desde cualquier hilo.
+class SqlResultCache {
+public:
+    static SqlResultCache& instance();
+
+    // Espacios colapsados fuera de literales y sin ';' final. No cambia
+    // mayúsculas: los encabezados salen como se escribieron.
+    static QString normalize(const QString& sql);
+
+    // Resultado del SELECT sobre 'snap': de la caché si sigue vigente, si no
+    // se ejecuta y se guarda (*hit dice cuál). EXPLAIN no se guarda.
+    SqlResultPtr fetch(const QString& sql, const DataSnapshot& snap, QString* err = nullptr,
+                       bool* hit = nullptr);
+
+    // Por partes, para quien ejecuta por su cuenta (p. ej. en otro hilo):
+    // lookup() da nulo si no hay resultado vigente; store() guarda uno
+    // completo fechado con las versiones de 'tables' en 'snap'
+    SqlResultPtr lookup(const QString& sql, const DataSnapshot& snap);
+    void store(const QString& sql, const DataSnapshot& snap, const QStringList& tables, SqlResultPtr res);
+
+    void invalidateTable(const QString& table);
+    void clear();
+
+    void   setBudget(qint64 bytes);   // aprox., en bytes
+    qint64 budget() const;
+    qint64 bytesUsed() const;
+    quint64 hits() const;
+    quint64 misses() const;
+
+private:
+    SqlResultCache();
+    Q_DISABLE_COPY(SqlResultCache)
+
+    struct Entry {
+        SqlResultPtr                    result;
+        QHash<QString, quint64>         versions;   // tabla -> versión leída
+        qint64                          bytes = 0;
+        std::list<QString>::iterator    lru;
+    };
+
+    void eraseLocked(QHash<QString, Entry>::iterator it);
+    void evictLocked();
+
+    mutable QMutex          m_mutex;
+    QHash<QString, Entry>   m_entries;
+    std::list<QString>      m_lru;          // al frente, la usada más recientemente
+    qint64                  m_budget = qint64(32) * 1024 * 1024;
+    qint64                  m_bytes = 0;
+    quint64                 m_hits = 0;
+    quint64                 m_misses = 0;
+};
+
+/* ================= Consultas guardadas preparadas ================= */
+// Una SqlPreparedQuery por consulta guardada (DataModel::querySql): se
+// analiza, resuelve y comprueba la primera vez que se ejecuta y se reutiliza
+// mientras no cambien su SQL ni el esquema de las tablas que lee. Se puede
+// usar desde cualquier hilo.
+class SqlPreparedCache {
+public:
+    static SqlPreparedCache& instance();
+
+    // Nulo (con *err) si la consulta no existe o no es un SELECT válido
+    QSharedPointer<const SqlPreparedQuery> get(const QString& name, QString* err = nullptr);
+
+    void invalidateTable(const QString& table);
+    void clear();
+
+private:
+    SqlPreparedCache();
+    Q_DISABLE_COPY(SqlPreparedCache)
+
+    mutable QMutex m_mutex;
+    QHash<QString, QSharedPointer<const SqlPreparedQuery>> m_entries;   // nombre en minúsculas
+};
+
+#endif // SQLCACHE_H
@@ -0,0 +1,2973 @@
+#include "sqlengine.h"
+#include "sqlpredicate.h"
+#include "sqlplanner.h"
+
+#include <QDate>
+#include <QHash>
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QSet>
+#include <QTemporaryFile>
+#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
+#include <QtNumeric>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+/* ============================ Enlace ============================ */
+// Copia profunda: el plan enlaza ordinales sin tocar la sentencia analizada
+static SqlExprPtr cloneExpr(const SqlExprPtr& e)
+{
+    if (!e) return {};
+    auto c = SqlExprPtr::create(*e);
+    for (SqlExprPtr& a : c->args) a = cloneExpr(a);
+    return c;
+}
+
+// Cada nodo de la expresión (sin entrar en sus subconsultas)
+static void visitExpr(const SqlExprPtr& e, const std::function<void(SqlExpr&)>& f)
+{
+    f(*e);
+    for (const SqlExprPtr& a : e->args) visitExpr(a, f);
+}
+
+// Un SELECT, sus ramas UNION... y las subconsultas de sus expresiones, a
+// cualquier profundidad
+static void forEachSelect(const SqlSelect& q, const std::function<void(const SqlSelect&)>& f)
+{
+    f(q);
+    auto inExpr = [&](const SqlExprPtr& e) {
+        if (e) visitExpr(e, [&](SqlExpr& x) { if (x.subquery) forEachSelect(*x.subquery, f); });
+    };
+    for (const SqlSelectItem& it : q.items) inExpr(it.expr);
+    for (const SqlJoin& j : q.joins) inExpr(j.on);
+    inExpr(q.where);
+    for (const SqlExprPtr& g : q.groupBy) inExpr(g);
+    inExpr(q.having);
+    for (const SqlOrderItem& o : q.orderBy) inExpr(o.expr);
+    for (const SqlSetOp& op : q.compound) forEachSelect(*op.select, f);
+}
+
+static bool bindExpr(SqlExpr& e, const QVector<SqlColumn>& cols, QString* err)
+{
+    if (e.kind == SqlExpr::Kind::Column) {
+        e.index = -1;
+        for (int i = 0; i < cols.size(); ++i) {
+            const SqlColumn& c = cols[i];
+            if (c.name.compare(e.name, Qt::CaseInsensitive) != 0) continue;
+            if (!e.table.isEmpty() && e.table.compare(c.table, Qt::CaseInsensitive) != 0
+                                   && e.table.compare(c.alias, Qt::CaseInsensitive) != 0) continue;
+            if (e.index >= 0) {
+                if (err) *err = QString("Columna ambigua: '%1'.").arg(e.text);
+                return false;
+            }
+            e.index = i;
+        }
+        if (e.index < 0) {
+            if (err) *err = QString("Columna '%1' no existe.").arg(e.text.isEmpty() ? e.name : e.text);
+            return false;
+        }
+        return true;
+    }
+    if (e.kind == SqlExpr::Kind::Param) {
+        if (err) *err = QString("Falta el valor del parámetro '%1'.").arg(e.name);
+        return false;
+    }
+    if (e.kind == SqlExpr::Kind::InSelect || e.kind == SqlExpr::Kind::Exists) {
+        // planSelect aparta las del WHERE de nivel superior: aquí llegan las demás
+        if (err) *err = QString("Las subconsultas solo se admiten en el WHERE, unidas con AND: '%1'.").arg(e.text);
+        return false;
+    }
+    for (const SqlExprPtr& a : e.args)
+        if (!bindExpr(*a, cols, err)) return false;
+
+    if (e.kind == SqlExpr::Kind::Like && e.args[1]->kind == SqlExpr::Kind::Literal
+        && !sqlIsNull(e.args[1]->value))
+        e.like.reset(new SqlLikeMatcher(e.args[1]->value.toString()));
+    if (e.kind == SqlExpr::Kind::InList) {
+        QVector<QVariant> items;
+        for (int i = 1; i < e.args.size(); ++i) {
+            if (e.args[i]->kind != SqlExpr::Kind::Literal) return true;   // se compara uno a uno
+            items.push_back(e.args[i]->value);
+        }
+        e.inSet.reset(new SqlInSet(items));
+    }
+    return true;
+}
+
+// Conjunciones de nivel superior: a AND (b AND c) -> [a, b, c]
+static void splitAnd(const SqlExprPtr& e, QVector<SqlExprPtr>* out)
+{
+    if (e->kind == SqlExpr::Kind::Binary && e->op == "AND") {
+        splitAnd(e->args[0], out);
+        splitAnd(e->args[1], out);
+    } else {
+        out->push_back(e);
+    }
+}
+
+static SqlExprPtr joinAnd(const QVector<SqlExprPtr>& conds)
+{
+    if (conds.isEmpty()) return {};
+    SqlExprPtr e = conds[0];
+    QStringList text{ e->text };
+    for (int i = 1; i < conds.size(); ++i) {
+        e = SqlExpr::binary("AND", e, conds[i]);
+        text << conds[i]->text;
+    }
+    e->text = text.join(" AND ");
+    return e;
+}
+
+// Aparta las subconsultas (IN / EXISTS) de las conjunciones de nivel superior
+// del WHERE, que se planifican como semi / anti joins; devuelve el resto
+// (nulo si no queda nada)
+static SqlExprPtr splitSubqueries(const SqlExprPtr& where, QVector<SqlExprPtr>* subConds)
+{
+    QVector<SqlExprPtr> conds, plain;
+    splitAnd(where, &conds);
+    for (const SqlExprPtr& c : conds) {
+        const bool sub = c->kind == SqlExpr::Kind::InSelect || c->kind == SqlExpr::Kind::Exists;
+        (sub ? *subConds : plain) << c;
+    }
+    return subConds->isEmpty() ? where : joinAnd(plain);
+}
+
+// Tablas (bit por posición en el FROM) que usa una expresión ya enlazada
+static quint64 tablesUsed(const SqlExpr& e, const QVector<int>& tableOfCol)
+{
+    if (e.kind == SqlExpr::Kind::Column) return quint64(1) << tableOfCol[e.index];
+    quint64 m = 0;
+    for (const SqlExprPtr& a : e.args) m |= tablesUsed(*a, tableOfCol);
+    return m;
+}
+
+// Copia con los ordinales desplazados (del registro combinado al de una tabla)
+static SqlExprPtr shiftColumns(const SqlExprPtr& e, int delta)
+{
+    SqlExprPtr c = cloneExpr(e);
+    std::function<void(SqlExpr&)> walk = [&](SqlExpr& x) {
+        if (x.kind == SqlExpr::Kind::Column) x.index += delta;
+        for (const SqlExprPtr& a : x.args) walk(*a);
+    };
+    walk(*c);
+    return c;
+}
+
+static bool hasAggregate(const SqlExpr& e)
+{
+    if (e.kind == SqlExpr::Kind::Aggregate) return true;
+    for (const SqlExprPtr& a : e.args)
+        if (hasAggregate(*a)) return true;
+    return false;
+}
+
+// Igualdad estructural de dos expresiones enlazadas (p. ej. GROUP BY contra SELECT)
+static bool sameExpr(const SqlExpr& a, const SqlExpr& b)
+{
+    if (a.kind != b.kind || a.negated != b.negated || a.args.size() != b.args.size()) return false;
+    if (a.op.compare(b.op, Qt::CaseInsensitive) != 0) return false;
+    if (a.kind == SqlExpr::Kind::Column && a.index != b.index) return false;
+    if (a.kind == SqlExpr::Kind::Literal
+        && (a.value.typeId() != b.value.typeId() || a.value != b.value)) return false;
+    for (int i = 0; i < a.args.size(); ++i)
+        if (!sameExpr(*a.args[i], *b.args[i])) return false;
+    return true;
+}
+
+// GROUP BY: las expresiones que se evalúan después de agregar (SELECT, HAVING,
+// ORDER BY) se reescriben sobre la fila agregada [grupos..., agregados...]
+struct AggRewriter {
+    QVector<SqlExprPtr>       groups;   // enlazadas contra el input
+    QVector<SqlExprPtr>       aggs;     // idem; se agregan según aparecen
+    const QVector<SqlColumn>* input = nullptr;
+
+    SqlExprPtr outColumn(int i, const SqlExpr& like) const {
+        const bool col = like.kind == SqlExpr::Kind::Column;
+        SqlExprPtr c = SqlExpr::column(col ? like.table : QString(), col ? like.name : like.text);
+        c->index = i;
+        c->text = like.text;
+        return c;
+    }
+
+    SqlExprPtr rewrite(const SqlExprPtr& e, QString* err) {
+        for (int g = 0; g < groups.size(); ++g)
+            if (sameExpr(*e, *groups[g])) return outColumn(g, *e);
+        if (e->kind == SqlExpr::Kind::Aggregate) {
+            for (const SqlExprPtr& a : e->args) {
+                if (hasAggregate(*a)) {
+                    if (err) *err = QString("No se pueden anidar funciones de agregado: '%1'.").arg(e->text);
+                    return {};
+                }
+            }
+            int a = 0;
+            while (a < aggs.size() && !sameExpr(*aggs[a], *e)) ++a;
+            if (a == aggs.size()) aggs << e;
+            return outColumn(groups.size() + a, *e);
+        }
+        if (e->kind == SqlExpr::Kind::Column) {
+            if (err) *err = QString("La columna '%1' debe estar en GROUP BY o dentro de una función de agregado.")
+                                .arg(e->text.isEmpty() ? e->name : e->text);
+            return {};
+        }
+        SqlExprPtr c = SqlExprPtr::create(*e);
+        for (SqlExprPtr& a : c->args)
+            if (!(a = rewrite(a, err))) return {};
+        return c;
+    }
+
+    QVector<SqlColumn> columns() const {
+        QVector<SqlColumn> out;
+        for (const SqlExprPtr& g : groups)
+            out << (g->kind == SqlExpr::Kind::Column ? (*input)[g->index] : SqlColumn{ QString(), QString(), g->text });
+        for (const SqlExprPtr& a : aggs)
+            out << SqlColumn{ QString(), QString(), a->text };
+        return out;
+    }
+};
+
+static SqlAggFn aggFnOf(const SqlExpr& a)
+{
+    const QString& f = a.op;
+    return f == "COUNT" ? (a.args.isEmpty() ? SqlAggFn::CountAll : SqlAggFn::Count)
+         : f == "SUM"   ? SqlAggFn::Sum
+         : f == "AVG"   ? SqlAggFn::Avg
+         : f == "MIN"   ? SqlAggFn::Min : SqlAggFn::Max;
+}
+
+/* ========================== Paralelismo ========================== */
+static std::atomic<int> g_scanParallelism{0};
+
+// Pool propio: los scans no compiten con otras tareas de QThreadPool::globalInstance()
+static QThreadPool* scanPool()
+{
+    static QThreadPool pool;
+    return &pool;
+}
+
+void SqlEngine::setScanParallelism(int threads)
+{
+    g_scanParallelism = qMax(0, threads);
+    scanPool()->setMaxThreadCount(scanParallelism());
+}
+
+int SqlEngine::scanParallelism()
+{
+    const int n = g_scanParallelism;
+    return n > 0 ? n : qMax(1, QThread::idealThreadCount());
+}
+
+static std::atomic<qint64> g_spillBudget{ qint64(64) * 1024 * 1024 };
+
+void SqlEngine::setSpillBudget(qint64 bytes)
+{
+    g_spillBudget = qMax<qint64>(0, bytes);
+}
+
+qint64 SqlEngine::spillBudget()
+{
+    return g_spillBudget;
+}
+
+/* ====================== Operadores físicos ====================== */
+namespace {
+
+// Lo que ocupa una fila en memoria, aproximado (EXPLAIN ANALYZE)
+qint64 recordBytes(const Record& r)
+{
+    qint64 b = 32 + r.size() * qint64(sizeof(QVariant));
+    for (const QVariant& v : r)
+        if (v.typeId() == QMetaType::QString) b += v.toString().size() * qint64(sizeof(QChar));
+    return b;
+}
+
+// Filtrado por tramos ("morsels"): cada tarea del pool evalúa el predicado
+// sobre un tramo de slots y deja los que pasan; el consumidor los toma en
+// orden de tramo, así el resultado sale en el mismo orden que el scan
+// secuencial. Hay a lo sumo 'window' tramos en vuelo por delante del
+// consumidor, para que un LIMIT no obligue a filtrar la tabla entera.
+class MorselFilter {
+public:
+    static constexpr int kMorselSlots = 16384;
+
+    MorselFilter(const ColumnTable& tab, const SqlPredicate& pred, const SqlAccessPath& path, int threads)
+        : m_tab(tab), m_pred(pred), m_path(path), m_sh(new Shared), m_window(threads * 2) {
+        m_total = byIndex() ? m_path.candidates.size() : m_tab.slotCount();
+        const int morsels = (m_total + kMorselSlots - 1) / kMorselSlots;
+        m_sh->out.resize(morsels);
+        m_sh->done.fill(false, morsels);
+    }
+    ~MorselFilter() { cancel(); }
+
+    // Siguiente slot que cumple el predicado; false al terminar
+    bool next(int* slot) {
+        while (m_idx >= m_block.size()) {
+            if (++m_cur >= m_sh->out.size()) return false;
+            submitUpTo(m_cur + m_window);
+            QMutexLocker lk(&m_sh->mutex);
+            while (!m_sh->done[m_cur]) m_sh->cond.wait(&m_sh->mutex);
+            m_block.swap(m_sh->out[m_cur]);
+            m_sh->out[m_cur].clear();
+            m_idx = 0;
+        }
+        *slot = m_block[m_idx++];
+        return true;
+    }
+
+    // Las tareas en curso leen la tabla y el predicado del operador: se
+    // espera a que terminen (las que aún no empezaron salen sin trabajar)
+    void cancel() {
+        m_sh->cancelled = true;
+        QMutexLocker lk(&m_sh->mutex);
+        while (m_sh->pending > 0) m_sh->cond.wait(&m_sh->mutex);
+    }
+
+private:
+    struct Shared {
+        QMutex               mutex;
+        QWaitCondition       cond;
+        QVector<QVector<int>> out;
+        QVector<bool>        done;
+        int                  pending = 0;
+        std::atomic<bool>    cancelled{false};
+    };
+
+    bool byIndex() const { return m_path.kind == SqlAccessPath::Kind::Index; }
+
+    void submitUpTo(int last) {
+        last = qMin(last, int(m_sh->out.size()) - 1);
+        for (; m_submitted < last + 1; ++m_submitted) {
+            const int m = m_submitted;
+            const int begin = m * kMorselSlots;
+            const int end = qMin(m_total, begin + kMorselSlots);
+            { QMutexLocker lk(&m_sh->mutex); ++m_sh->pending; }
+            QSharedPointer<Shared> sh = m_sh;
+            const ColumnTable& tab = m_tab;
+            const SqlPredicate& pred = m_pred;
+            const QVector<int>* cand = byIndex() ? &m_path.candidates : nullptr;
+            scanPool()->start([sh, &tab, &pred, cand, m, begin, end]() {
+                QVector<int> hits;
+                if (!sh->cancelled) {
+                    for (int i = begin; i < end; ++i) {
+                        const int slot = cand ? (*cand)[i] : i;
+                        if (tab.isLive(slot) && pred.matches(slot)) hits.push_back(slot);
+                    }
+                }
+                QMutexLocker lk(&sh->mutex);
+                sh->out[m].swap(hits);
+                sh->done[m] = true;
+                --sh->pending;
+                sh->cond.wakeAll();
+            });
+        }
+    }
+
+    const ColumnTable&     m_tab;
+    const SqlPredicate&    m_pred;
+    const SqlAccessPath&   m_path;
+    QSharedPointer<Shared> m_sh;
+    int                    m_window;
+    int                    m_total = 0;
+    int                    m_submitted = 0;
+    int                    m_cur = -1;
+    QVector<int>           m_block;
+    int                    m_idx = 0;
+};
+
+// Recorre los slots vivos de una tabla (del snapshot), todos o solo los
+// candidatos que dio un índice. El WHERE llega compilado y se evalúa entero
+// sobre las columnas: solo se arma el Record de las filas que pasan.
+//
+// Si hay WHERE y la tabla es grande, el predicado se evalúa en paralelo por
+// tramos (MorselFilter); las filas salen igual en orden de slot.
+//
+// Con setOrder() recorre en el orden del índice ordenado de una columna, con
+// la misma salida que Sort sobre ella (NULL primero en ASC y último en DESC;
+// empates en orden de slot): ORDER BY + LIMIT lee solo las filas que entrega.
+class ScanOp : public SqlOperator {
+public:
+    ScanOp(const ColumnTable& tab, const QString& table, QVector<SqlColumn> cols,
+           SqlPredicate pred = {}, const QString& predText = {}, SqlAccessPath path = {})
+        : m_tab(tab), m_table(table), m_pred(std::move(pred)), m_predText(predText),
+          m_path(std::move(path)) {
+        m_columns = std::move(cols);
+    }
+
+    void setOrder(int col, bool desc) { m_orderCol = col; m_desc = desc; }
+
+    const ColumnTable& table() const { return m_tab; }
+    int lastSlot() const { return m_lastSlot; }   // slot de la última fila entregada
+
+    void open() override {
+        m_pos = -1;
+        m_morsels.reset();
+        if (m_orderCol < 0) {
+            if (parallel()) m_morsels.reset(new MorselFilter(m_tab, m_pred, m_path, SqlEngine::scanParallelism()));
+            return;
+        }
+        m_order = m_tab.sortedSlots(m_orderCol);
+        m_nullsLeft = m_tab.liveCount() - m_order.size();
+        m_nullSlot = -1;
+        m_runBegin = m_runEnd = m_runPos = m_order.size();
+        m_inNulls = !m_desc && m_nullsLeft > 0;
+    }
+    void close() override { m_morsels.reset(); m_order.clear(); }
+    bool next(Record& row) override {
+        if (m_morsels) {
+            int slot;
+            if (cancelled() || !m_morsels->next(&slot)) return false;
+            row = m_tab.record(m_lastSlot = slot);
+            return true;
+        }
+        for (;;) {
+            if (cancelled()) return false;
+            const int slot = nextSlot();
+            if (slot < 0) return false;
+            if (!m_tab.isLive(slot) || !m_pred.matches(slot)) continue;
+            row = m_tab.record(m_lastSlot = slot);
+            return true;
+        }
+    }
+    qint64 estimatedRows() const override { return m_path.estimatedRows; }   // antes del WHERE
+    QString describe() const override {
+        QString d = QString("Scan %1 [%2]").arg(m_table, m_path.describe());
+        if (m_orderCol >= 0)
+            d += QString(" en orden de %1%2").arg(m_columns[m_orderCol].name, m_desc ? " DESC" : "");
+        if (!m_pred.isEmpty()) d += QString(" WHERE %1").arg(m_predText);
+        if (parallel()) d += QString(" en paralelo (%1 hilos)").arg(SqlEngine::scanParallelism());
+        return d;
+    }
+
+private:
+    bool parallel() const {
+        if (m_orderCol >= 0 || m_pred.isEmpty() || SqlEngine::scanParallelism() < 2) return false;
+        const int n = m_path.kind == SqlAccessPath::Kind::Index ? m_path.candidates.size() : m_tab.slotCount();
+        return n >= 4 * MorselFilter::kMorselSlots;
+    }
+
+    int nextSlot() {
+        if (m_orderCol < 0) {
+            const bool byIndex = m_path.kind == SqlAccessPath::Kind::Index;
+            const int n = byIndex ? m_path.candidates.size() : m_tab.slotCount();
+            if (++m_pos >= n) return -1;
+            return byIndex ? m_path.candidates[m_pos] : m_pos;
+        }
+        if (m_inNulls) {
+            const Column& c = m_tab.column(m_orderCol);
+            while (m_nullsLeft > 0 && ++m_nullSlot < m_tab.slotCount()) {
+                if (!m_tab.isLive(m_nullSlot) || !c.isNull(m_nullSlot)) continue;
+                --m_nullsLeft;
+                return m_nullSlot;
+            }
+            m_inNulls = false;
+            if (m_desc) return -1;                     // DESC: los NULL van al final
+        }
+        if (!m_desc) return (++m_pos < m_order.size()) ? m_order[m_pos] : -1;
+
+        // DESC: grupos de valores iguales de atrás hacia adelante, cada uno en
+        // orden de slot (como el sort estable)
+        if (m_runPos >= m_runEnd) {
+            if (m_runBegin == 0) {
+                m_inNulls = m_nullsLeft > 0;
+                return m_inNulls ? nextSlot() : -1;
+            }
+            const Column& c = m_tab.column(m_orderCol);
+            m_runEnd = m_runBegin;
+            m_runBegin = m_runEnd - 1;
+            while (m_runBegin > 0 && c.compareSlots(m_order[m_runBegin - 1], m_order[m_runEnd - 1]) == 0)
+                --m_runBegin;
+            m_runPos = m_runBegin;
+        }
+        return m_order[m_runPos++];
+    }
+
+    const ColumnTable& m_tab;
+    QString            m_table;
+    SqlPredicate       m_pred;
+    QString            m_predText;
+    SqlAccessPath      m_path;
+    int                m_pos = -1;
+    int                m_lastSlot = -1;
+
+    // Recorrido ordenado (m_orderCol >= 0)
+    int          m_orderCol = -1;
+    bool         m_desc = false;
+    QVector<int> m_order;
+    qint64       m_nullsLeft = 0;
+    int          m_nullSlot = -1;
+    bool         m_inNulls = false;
+    int          m_runBegin = 0, m_runEnd = 0, m_runPos = 0;
+
+    // Último: se destruye antes que el predicado y el camino que usan sus tareas
+    std::unique_ptr<MorselFilter> m_morsels;
+};
+
+// Clave de una sola columna de texto codificada por diccionario, leída en el
+// slot que acaba de entregar un scan (que es directamente la entrada del
+// operador). Cada código se resuelve una sola vez a su grupo o cubo con la
+// clave de siempre (SqlKeyPart, texto plegado); las demás filas con ese código
+// solo indexan un vector por qint32.
+struct DictKey {
+    const ScanOp* scan = nullptr;
+    const Column* col = nullptr;
+
+    explicit operator bool() const { return col; }
+    int    codes() const { return col->dictionary().size(); }
+    qint32 code() const {                       // -1 si la celda es NULL
+        const int slot = scan->lastSlot();
+        return col->isNull(slot) ? -1 : col->codeAt(slot);
+    }
+};
+
+DictKey dictKey(const SqlOperatorPtr& input, const ScanOp* scan, const QVector<SqlExprPtr>& keys)
+{
+    if (input.data() != scan || keys.size() != 1 || keys[0]->kind != SqlExpr::Kind::Column) return {};
+    const Column& c = scan->table().column(keys[0]->index);
+    if (c.kind() != ColumnKind::Text || !c.isDictEncoded()) return {};
+    return { scan, &c };
+}
+
+// Filas ya calculadas (la salida de EXPLAIN)
+class ValuesOp : public SqlOperator {
+public:
+    ValuesOp(QVector<SqlColumn> cols, QVector<Record> rows) : m_rows(std::move(rows)) {
+        m_columns = std::move(cols);
+    }
+    void open() override { m_pos = 0; }
+    bool next(Record& row) override {
+        if (m_pos >= m_rows.size()) return false;
+        row = m_rows[m_pos++];
+        return true;
+    }
+    qint64 estimatedRows() const override { return m_rows.size(); }
+    QString describe() const override { return QString("Values (%1 filas)").arg(m_rows.size()); }
+
+private:
+    QVector<Record> m_rows;
+    int             m_pos = 0;
+};
+
+// Clave de orden calculada una vez por fila: la clase del valor se decide al
+// armarla y la comparación entre clases iguales es directa (sin convertir ni
+// parsear). Los pares mixtos (texto contra fecha...) van por sqlCompare.
+struct SortKey {
+    enum Cls : quint8 { Null, Int, Num, Date, Text };
+    Cls      cls = Null;
+    qint64   i = 0;          // Int, Date (día juliano)
+    double   d = 0;          // Int, Num
+    QString  s;              // Text, ya sin mayúsculas
+    QVariant raw;
+
+    static SortKey of(const QVariant& v) {
+        SortKey k;
+        if (sqlIsNull(v)) return k;
+        k.raw = v;
+        if (v.typeId() == QMetaType::LongLong) {
+            k.cls = Int; k.i = v.toLongLong(); k.d = double(k.i);
+        } else if (v.typeId() == QMetaType::QDate) {
+            k.cls = Date; k.i = v.toDate().toJulianDay();
+        } else {
+            bool ok = false;
+            k.d = v.toDouble(&ok);
+            if (ok) k.cls = Num;
+            else  { k.cls = Text; k.s = v.toString().toCaseFolded(); }
+        }
+        return k;
+    }
+};
+
+// Igual que sqlCompareForSort (NULL primero)
+int compareKeys(const SortKey& a, const SortKey& b)
+{
+    if (a.cls == SortKey::Null || b.cls == SortKey::Null)
+        return (a.cls == b.cls) ? 0 : (a.cls == SortKey::Null) ? -1 : 1;
+    auto cmp = [](auto x, auto y) { return (x < y) ? -1 : (x > y) ? 1 : 0; };
+    if (a.cls == b.cls) {
+        switch (a.cls) {
+        case SortKey::Int:
+        case SortKey::Date: return cmp(a.i, b.i);
+        case SortKey::Num:  return cmp(a.d, b.d);
+        case SortKey::Text: return a.s.compare(b.s);
+        case SortKey::Null: break;
+        }
+    }
+    const bool numA = a.cls == SortKey::Int || a.cls == SortKey::Num;
+    const bool numB = b.cls == SortKey::Int || b.cls == SortKey::Num;
+    if (numA && numB) return cmp(a.d, b.d);
+    return sqlCompare(a.raw, b.raw);
+}
+
+// Ordena su input. Con 'keep' >= 0 (ORDER BY + LIMIT) solo guarda las 'keep'
+// primeras en un heap acotado: O(n log k) y memoria O(k).
+class SortOp : public SqlOperator {
+public:
+    SortOp(SqlOperatorPtr child, QVector<SqlExprPtr> keys, QVector<bool> desc, qint64 keep = -1)
+        : m_keys(std::move(keys)), m_desc(std::move(desc)), m_keep(keep) {
+        m_columns = child->columns();
+        m_children << child;
+    }
+    void open() override {
+        m_rows.clear();
+        m_pos = 0;
+        // Orden total y estable: a igualdad de claves, el orden de llegada
+        auto less = [this](const Entry& a, const Entry& b) {
+            for (int k = 0; k < m_keys.size(); ++k) {
+                const int c = compareKeys(a.keys[k], b.keys[k]);
+                if (c != 0) return m_desc[k] ? c > 0 : c < 0;
+            }
+            return a.seq < b.seq;
+        };
+        SqlOperator& in = *m_children[0];
+        in.open();
+        Record row;
+        Entry en;
+        en.keys.resize(m_keys.size());
+        for (qint64 seq = 0; m_keep != 0 && in.next(row); ++seq) {
+            en.seq = seq;
+            for (int k = 0; k < m_keys.size(); ++k) en.keys[k] = SortKey::of(sqlEval(*m_keys[k], row));
+            if (m_keep < 0 || m_rows.size() < m_keep) {
+                en.row = row;
+                m_rows.push_back(en);
+                if (m_keep >= 0) std::push_heap(m_rows.begin(), m_rows.end(), less);
+            } else if (less(en, m_rows.front())) {   // mejor que la peor guardada
+                std::pop_heap(m_rows.begin(), m_rows.end(), less);
+                en.row = row;
+                m_rows.back() = en;
+                std::push_heap(m_rows.begin(), m_rows.end(), less);
+            }
+        }
+        in.close();
+        if (m_keep >= 0) std::sort_heap(m_rows.begin(), m_rows.end(), less);
+        else             std::sort(m_rows.begin(), m_rows.end(), less);
+        qint64 bytes = 0;
+        for (const Entry& e : m_rows) bytes += recordBytes(e.row) + e.keys.size() * qint64(sizeof(SortKey));
+        m_memBytes = qMax(m_memBytes, bytes);
+    }
+    void close() override { m_rows.clear(); }
+    bool next(Record& row) override {
+        if (m_pos >= m_rows.size()) return false;
+        row = m_rows[m_pos++].row;
+        return true;
+    }
+    qint64 estimatedRows() const override {
+        const qint64 in = m_children[0]->estimatedRows();
+        return (m_keep >= 0 && (in < 0 || in > m_keep)) ? m_keep : in;
+    }
+    QString describe() const override {
+        QStringList k;
+        for (int i = 0; i < m_keys.size(); ++i) k << m_keys[i]->text + (m_desc[i] ? " DESC" : "");
+        return m_keep >= 0 ? QString("Sort %1 (top %2)").arg(k.join(", ")).arg(m_keep)
+                           : QString("Sort %1").arg(k.join(", "));
+    }
+
+private:
+    struct Entry { Record row; QVector<SortKey> keys; qint64 seq = 0; };
+    QVector<SqlExprPtr> m_keys;
+    QVector<bool>       m_desc;
+    qint64              m_keep;
+    QVector<Entry>      m_rows;
+    int                 m_pos = 0;
+};
+
+class LimitOp : public SqlOperator {
+public:
+    LimitOp(SqlOperatorPtr child, qint64 limit, qint64 offset) : m_limit(limit), m_offset(offset) {
+        m_columns = child->columns();
+        m_children << child;
+    }
+    void open() override  { m_children[0]->open(); m_seen = 0; }
+    void close() override { m_children[0]->close(); }
+    bool next(Record& row) override {
+        while (m_limit < 0 || m_seen < m_offset + m_limit) {
+            if (!m_children[0]->next(row)) return false;
+            if (m_seen++ >= m_offset) return true;
+        }
+        return false;   // alcanzado el límite: no se sigue leyendo el input
+    }
+    qint64 estimatedRows() const override {
+        const qint64 in = m_children[0]->estimatedRows();
+        if (m_limit < 0) return in < 0 ? -1 : qMax<qint64>(0, in - m_offset);
+        return in < 0 ? m_limit : qMin(m_limit, qMax<qint64>(0, in - m_offset));
+    }
+    QString describe() const override {
+        return m_offset > 0 ? QString("Limit %1 offset %2").arg(m_limit).arg(m_offset)
+                            : QString("Limit %1").arg(m_limit);
+    }
+
+private:
+    qint64 m_limit, m_offset, m_seen = 0;
+};
+
+class ProjectOp : public SqlOperator {
+public:
+    ProjectOp(SqlOperatorPtr child, QVector<SqlExprPtr> exprs, const QStringList& names)
+        : m_exprs(std::move(exprs)) {
+        for (int i = 0; i < m_exprs.size(); ++i) {
+            const SqlExpr& e = *m_exprs[i];
+            const bool col = e.kind == SqlExpr::Kind::Column;
+            m_columns.push_back({ col ? child->columns()[e.index].table : QString(),
+                                  col ? child->columns()[e.index].alias : QString(),
+                                  names.value(i) });
+        }
+        m_children << child;
+    }
+    void open() override  { m_children[0]->open(); }
+    void close() override { m_children[0]->close(); }
+    bool next(Record& row) override {
+        if (!m_children[0]->next(m_in)) return false;
+        row.resize(m_exprs.size());
+        for (int i = 0; i < m_exprs.size(); ++i) row[i] = sqlEval(*m_exprs[i], m_in);
+        return true;
+    }
+    qint64 estimatedRows() const override { return m_children[0]->estimatedRows(); }
+    QString describe() const override {
+        QStringList n;
+        for (const SqlColumn& c : m_columns) n << c.name;
+        return QString("Project %1").arg(n.join(", "));
+    }
+
+private:
+    QVector<SqlExprPtr> m_exprs;
+    Record              m_in;
+};
+
+// Deja pasar las filas cuyo predicado es verdadero (condiciones sobre varias
+// tablas, que no se pueden bajar a un scan)
+class FilterOp : public SqlOperator {
+public:
+    FilterOp(SqlOperatorPtr child, SqlExprPtr pred) : m_pred(std::move(pred)) {
+        m_columns = child->columns();
+        m_children << child;
+    }
+    void open() override  { m_children[0]->open(); }
+    void close() override { m_children[0]->close(); }
+    bool next(Record& row) override {
+        while (m_children[0]->next(row))
+            if (sqlIsTrue(sqlEval(*m_pred, row))) return true;
+        return false;
+    }
+    QString describe() const override { return QString("Filter %1").arg(m_pred->text); }
+
+private:
+    SqlExprPtr m_pred;
+};
+
+// Clave de join de una fila; false si alguna parte es NULL (no coincide con nada)
+bool joinKey(const QVector<SqlExprPtr>& exprs, const Record& row, SqlKey* out)
+{
+    out->resize(exprs.size());
+    for (int i = 0; i < exprs.size(); ++i) {
+        (*out)[i] = SqlKeyPart::of(sqlEval(*exprs[i], row));
+        if ((*out)[i].cls == SqlKeyPart::Null) return false;
+    }
+    return true;
+}
+
+// Hash join: materializa el lado de construcción en una tabla hash por clave
+// y recorre el otro en streaming. La salida es siempre izquierda + derecha.
+// LEFT JOIN construye siempre a la derecha (cada fila izquierda sondea una vez
+// y si nada coincide sale con la derecha en NULL). Sin claves de igualdad
+// todas las filas caen en el mismo cubo (producto filtrado por el residuo).
+class HashJoinOp : public SqlOperator {
+public:
+    HashJoinOp(SqlOperatorPtr left, SqlOperatorPtr right,
+               QVector<SqlExprPtr> leftKeys, QVector<SqlExprPtr> rightKeys,
+               SqlExprPtr residual, bool leftOuter, bool buildLeft, const QString& onText)
+        : m_leftKeys(std::move(leftKeys)), m_rightKeys(std::move(rightKeys)),
+          m_residual(std::move(residual)), m_leftOuter(leftOuter),
+          m_buildLeft(buildLeft && !leftOuter), m_onText(onText) {
+        m_columns = left->columns() + right->columns();
+        m_leftWidth = left->columns().size();
+        m_rightWidth = right->columns().size();
+        m_children << left << right;
+    }
+
+    // Claves por código de diccionario de cada lado (vacías si no aplican)
+    void setDictKeys(DictKey left, DictKey right) { m_leftDict = left; m_rightDict = right; }
+
+    void open() override {
+        SqlOperator& build = *m_children[m_buildLeft ? 0 : 1];
+        const QVector<SqlExprPtr>& keys = m_buildLeft ? m_leftKeys : m_rightKeys;
+        const DictKey& dict = m_buildLeft ? m_leftDict : m_rightDict;
+        const DictKey& probeDict = m_buildLeft ? m_rightDict : m_leftDict;
+        QVector<int> byCode(dict ? dict.codes() : 0, kUnresolved);
+        m_rows.clear();
+        m_index.clear();
+        m_buckets.clear();
+        build.open();
+        Record row;
+        SqlKey k;
+        while (build.next(row)) {
+            int b = kNoMatch;
+            const qint32 c = dict ? dict.code() : -1;
+            if (!dict) b = joinKey(keys, row, &k) ? bucketOf(k) : kNoMatch;
+            else if (c >= 0 && (b = byCode[c]) == kUnresolved)
+                b = byCode[c] = joinKey(keys, row, &k) ? bucketOf(k) : kNoMatch;
+            if (b < 0) continue;
+            m_buckets[b].push_back(m_rows.size());
+            m_rows.push_back(row);
+        }
+        build.close();
+        qint64 bytes = m_index.size() * qint64(64);
+        for (const Record& r : std::as_const(m_rows)) bytes += recordBytes(r) + qint64(sizeof(int));
+        m_memBytes = qMax(m_memBytes, bytes);
+        m_probeCodes = QVector<int>(probeDict ? probeDict.codes() : 0, kUnresolved);
+        m_children[m_buildLeft ? 1 : 0]->open();
+        m_matches = nullptr;
+        m_pos = 0;
+    }
+    void close() override {
+        m_children[m_buildLeft ? 1 : 0]->close();
+        m_rows.clear();
+        m_index.clear();
+        m_buckets.clear();
+        m_probeCodes.clear();
+    }
+    bool next(Record& row) override {
+        SqlOperator& probe = *m_children[m_buildLeft ? 1 : 0];
+        for (;;) {
+            while (m_matches && m_pos < m_matches->size()) {
+                const Record& b = m_rows[(*m_matches)[m_pos++]];
+                row = m_buildLeft ? b + m_probe : m_probe + b;
+                if (!m_residual || sqlIsTrue(sqlEval(*m_residual, row))) {
+                    m_matched = true;
+                    return true;
+                }
+            }
+            if (m_matches && m_leftOuter && !m_matched) {
+                m_matches = nullptr;
+                row = m_probe;
+                row.resize(m_leftWidth + m_rightWidth);   // derecha en NULL
+                return true;
+            }
+            if (!probe.next(m_probe)) return false;
+            static const QVector<int> none;
+            const DictKey& dict = m_buildLeft ? m_rightDict : m_leftDict;
+            const qint32 c = dict ? dict.code() : -1;
+            int b = kNoMatch;
+            if (!dict) b = probeBucket();
+            else if (c >= 0 && (b = m_probeCodes[c]) == kUnresolved) b = m_probeCodes[c] = probeBucket();
+            m_matches = b >= 0 ? &m_buckets[b] : &none;
+            m_pos = 0;
+            m_matched = false;
+        }
+    }
+    QString describe() const override {
+        QString d = QString("Hash join %1 (construye %2) ON %3")
+            .arg(m_leftOuter ? "LEFT" : "INNER", m_buildLeft ? "izquierda" : "derecha", m_onText);
+        if (m_leftDict || m_rightDict) d += " por código de diccionario";
+        return d;
+    }
+
+private:
+    static constexpr int kUnresolved = -1, kNoMatch = -2;   // código -> cubo, aún sin mirar / sin cubo
+
+    int bucketOf(const SqlKey& k) {
+        auto it = m_index.constFind(k);
+        if (it != m_index.constEnd()) return *it;
+        m_buckets.push_back({});
+        m_index.insert(k, m_buckets.size() - 1);
+        return m_buckets.size() - 1;
+    }
+    int probeBucket() const {
+        SqlKey k;
+        return joinKey(m_buildLeft ? m_rightKeys : m_leftKeys, m_probe, &k) ? m_index.value(k, kNoMatch) : kNoMatch;
+    }
+
+    QVector<SqlExprPtr>          m_leftKeys, m_rightKeys;
+    SqlExprPtr                   m_residual;
+    bool                         m_leftOuter, m_buildLeft;
+    QString                      m_onText;
+    int                          m_leftWidth = 0, m_rightWidth = 0;
+    DictKey                      m_leftDict, m_rightDict;
+    QVector<Record>              m_rows;
+    QHash<SqlKey, int>           m_index;        // clave -> cubo
+    QVector<QVector<int>>        m_buckets;      // filas de construcción por cubo
+    QVector<int>                 m_probeCodes;   // código del lado que sondea -> cubo
+    const QVector<int>*          m_matches = nullptr;
+    int                          m_pos = 0;
+    bool                         m_matched = false;
+    Record                       m_probe;
+};
+
+// Merge join sobre dos entradas ya ordenadas por la clave (scans en orden de
+// índice, NULL primero): avanza ambas a la vez y cruza cada fila izquierda
+// con el grupo de derechas de igual clave, que se reutiliza mientras la
+// izquierda repita valor.
+class MergeJoinOp : public SqlOperator {
+public:
+    MergeJoinOp(SqlOperatorPtr left, SqlOperatorPtr right, int leftKey, int rightKey,
+                SqlExprPtr residual, bool leftOuter, const QString& onText)
+        : m_leftKey(leftKey), m_rightKey(rightKey), m_residual(std::move(residual)),
+          m_leftOuter(leftOuter), m_onText(onText) {
+        m_columns = left->columns() + right->columns();
+        m_rightWidth = right->columns().size();
+        m_children << left << right;
+    }
+
+    void open() override {
+        m_children[0]->open();
+        m_children[1]->open();
+        m_haveRight = m_children[1]->next(m_right);
+        m_group.clear();
+        m_groupKey = SortKey();
+        m_inGroup = false;
+    }
+    void close() override {
+        m_children[0]->close();
+        m_children[1]->close();
+        m_group.clear();
+    }
+    bool next(Record& row) override {
+        for (;;) {
+            if (m_inGroup) {
+                while (m_pos < m_group.size()) {
+                    row = m_left + m_group[m_pos++];
+                    if (!m_residual || sqlIsTrue(sqlEval(*m_residual, row))) {
+                        m_matched = true;
+                        return true;
+                    }
+                }
+                m_inGroup = false;
+                if (m_leftOuter && !m_matched) {
+                    row = m_left;
+                    row.resize(row.size() + m_rightWidth);
+                    return true;
+                }
+            }
+            if (!m_children[0]->next(m_left)) return false;
+            const SortKey lk = SortKey::of(m_left.value(m_leftKey));
+            if (lk.cls == SortKey::Null) {
+                m_group.clear();
+                m_groupKey = SortKey();
+            } else if (m_groupKey.cls == SortKey::Null || compareKeys(m_groupKey, lk) != 0) {
+                // Nuevo valor: se descartan las derechas menores y se junta el grupo igual
+                m_group.clear();
+                m_groupKey = lk;
+                SortKey rk;
+                while (m_haveRight) {
+                    rk = SortKey::of(m_right.value(m_rightKey));
+                    if (rk.cls != SortKey::Null && compareKeys(rk, lk) >= 0) break;
+                    m_haveRight = m_children[1]->next(m_right);
+                }
+                while (m_haveRight && compareKeys(rk, lk) == 0) {
+                    m_group.push_back(m_right);
+                    if ((m_haveRight = m_children[1]->next(m_right)))
+                        rk = SortKey::of(m_right.value(m_rightKey));
+                }
+            }
+            m_inGroup = true;
+            m_pos = 0;
+            m_matched = false;
+        }
+    }
+    QString describe() const override {
+        return QString("Merge join %1 ON %2").arg(m_leftOuter ? "LEFT" : "INNER", m_onText);
+    }
+
+private:
+    int             m_leftKey, m_rightKey;
+    SqlExprPtr      m_residual;
+    bool            m_leftOuter;
+    QString         m_onText;
+    int             m_rightWidth = 0;
+    Record          m_left, m_right;
+    bool            m_haveRight = false;
+    QVector<Record> m_group;
+    SortKey         m_groupKey;
+    bool            m_inGroup = false;
+    int             m_pos = 0;
+    bool            m_matched = false;
+};
+
+// Agregación por hash. El input se lee en lotes; con paralelismo cada lote se
+// agrega en su propio SqlAggregator en el pool (parcial por hilo, sin nada
+// compartido) y al final los parciales se combinan en orden de lote: los
+// grupos salen en orden de primera aparición, igual que en secuencial.
+class HashAggOp : public SqlOperator {
+public:
+    static constexpr int kBatchRows = 8192;
+
+    HashAggOp(SqlOperatorPtr child, QVector<SqlExprPtr> groups, QVector<SqlExprPtr> aggs,
+              QVector<SqlColumn> outCols)
+        : m_groups(std::move(groups)), m_aggs(std::move(aggs)) {
+        m_columns = std::move(outCols);
+        m_children << child;
+        for (const SqlExprPtr& a : m_aggs) m_fns << aggFnOf(*a);
+    }
+
+    // GROUP BY de una columna por diccionario: se agrupa por código
+    void setDictKey(DictKey key) { m_dict = key; }
+
+    void open() override {
+        struct Pending { QMutex mutex; QWaitCondition cond; int count = 0; };
+        const int threads = SqlEngine::scanParallelism();
+        auto pending = QSharedPointer<Pending>::create();
+        QVector<QSharedPointer<SqlAggregator>> parts;
+        QVector<Record> batch;
+        QVector<qint32> codes;   // con m_dict: código de la clave de cada fila del lote
+
+        auto flush = [&](bool inlineRun) {
+            auto part = QSharedPointer<SqlAggregator>::create(m_fns);
+            parts << part;
+            if (inlineRun) {
+                aggregate(m_groups, m_aggs, batch, codes, part.data());
+            } else {
+                {
+                    QMutexLocker lk(&pending->mutex);
+                    while (pending->count >= 2 * threads) pending->cond.wait(&pending->mutex);
+                    ++pending->count;
+                }
+                scanPool()->start([pending, part, groups = m_groups, aggs = m_aggs, rows = batch, codes]() {
+                    aggregate(groups, aggs, rows, codes, part.data());
+                    QMutexLocker lk(&pending->mutex);
+                    --pending->count;
+                    pending->cond.wakeAll();
+                });
+            }
+            batch.clear();
+            codes.clear();
+        };
+
+        SqlOperator& in = *m_children[0];
+        in.open();
+        Record row;
+        while (in.next(row)) {
+            batch.push_back(row);
+            if (m_dict) codes.push_back(m_dict.code());
+            if (batch.size() == kBatchRows) flush(threads < 2);
+        }
+        in.close();
+        if (!batch.isEmpty()) flush(true);
+        {
+            QMutexLocker lk(&pending->mutex);
+            while (pending->count > 0) pending->cond.wait(&pending->mutex);
+        }
+
+        m_result = SqlAggregator(m_fns);
+        for (const auto& p : parts) m_result.merge(*p);
+        if (m_groups.isEmpty()) m_result.ensureGroup();   // sin GROUP BY: una fila aunque no haya input
+        m_pos = 0;
+        qint64 bytes = 0;
+        for (int g = 0; g < m_result.groupCount(); ++g)
+            bytes += recordBytes(m_result.groupValues(g)) + m_fns.size() * qint64(64);
+        m_memBytes = qMax(m_memBytes, bytes);
+    }
+    void close() override { m_result = SqlAggregator(); }
+    bool next(Record& row) override {
+        if (m_pos >= m_result.groupCount()) return false;
+        row = m_result.groupValues(m_pos) + m_result.results(m_pos);
+        ++m_pos;
+        return true;
+    }
+    QString describe() const override {
+        QStringList g, a;
+        for (const SqlExprPtr& e : m_groups) g << e->text;
+        for (const SqlExprPtr& e : m_aggs) a << e->text;
+        QString d = g.isEmpty() ? QString("HashAggregate %1").arg(a.join(", "))
+                                : QString("HashAggregate GROUP BY %1: %2").arg(g.join(", "), a.join(", "));
+        if (m_dict) d += " por código de diccionario";
+        if (SqlEngine::scanParallelism() > 1) d += QString(" (parciales en %1 hilos)").arg(SqlEngine::scanParallelism());
+        return d;
+    }
+
+private:
+    // codes: vacío, o el código de diccionario de la clave por fila (-1 = NULL)
+    static void aggregate(const QVector<SqlExprPtr>& groups, const QVector<SqlExprPtr>& aggs,
+                          const QVector<Record>& rows, const QVector<qint32>& codes, SqlAggregator* out) {
+        Record g(groups.size()), args(aggs.size());
+        for (int r = 0; r < rows.size(); ++r) {
+            const Record& row = rows[r];
+            for (int i = 0; i < aggs.size(); ++i)
+                args[i] = aggs[i]->args.isEmpty() ? QVariant() : sqlEval(*aggs[i]->args[0], row);
+            const qint32 code = codes.isEmpty() ? -1 : codes[r];
+            int gi = code >= 0 ? out->groupOfCode(code) : -1;
+            if (gi < 0) {
+                for (int i = 0; i < groups.size(); ++i) g[i] = sqlEval(*groups[i], row);
+                gi = code >= 0 ? out->bindCode(code, g) : out->groupOf(g);
+            }
+            out->addTo(gi, args);
+        }
+    }
+
+    QVector<SqlExprPtr> m_groups, m_aggs;
+    QVector<SqlAggFn>   m_fns;
+    DictKey             m_dict;
+    SqlAggregator       m_result;
+    int                 m_pos = 0;
+};
+
+/* ---------- Conjuntos (DISTINCT, UNION, INTERSECT, EXCEPT) ---------- */
+SqlKey rowKey(const Record& r)
+{
+    SqlKey k(r.size());
+    for (int i = 0; i < r.size(); ++i) k[i] = SqlKeyPart::of(r[i]);
+    return k;
+}
+
+// Lo que ocupa una clave en un QSet, aproximado
+qint64 keyBytes(const SqlKey& k)
+{
+    qint64 b = 48 + k.size() * qint64(sizeof(SqlKeyPart));
+    for (const SqlKeyPart& p : k) b += p.text.size() * qint64(sizeof(QChar));
+    return b;
+}
+
+// Error de los operadores que vuelcan a disco cuando una escritura falla
+const char* const kSpillError = "No se pudo escribir el volcado temporal a disco.";
+
+// Filas en archivos temporales, repartidas por hash de su clave: cada
+// partición se procesa luego por separado con un conjunto más chico
+class SpillFiles {
+public:
+    static constexpr int kParts = 16;
+
+    bool write(const SqlKey& k, const Record& r) {
+        Part& p = m_parts[int(qHash(k, 0x9e3779b9u) % kParts)];
+        if (!p.file) {
+            p.file.reset(new QTemporaryFile);
+            if (!p.file->open()) { p.file.reset(); return false; }
+            p.stream.setDevice(p.file.data());
+        }
+        p.stream << r;
+        return p.stream.status() == QDataStream::Ok;
+    }
+    void rewind(int part) {
+        m_reading = part;
+        Part& p = m_parts[part];
+        if (p.file) { p.file->seek(0); p.stream.resetStatus(); }
+    }
+    bool read(Record* r) {
+        Part& p = m_parts[m_reading];
+        if (!p.file || p.stream.atEnd()) return false;
+        p.stream >> *r;
+        return p.stream.status() == QDataStream::Ok;
+    }
+
+private:
+    struct Part {
+        QScopedPointer<QTemporaryFile> file;
+        QDataStream                    stream;
+    };
+    Part m_parts[kParts];
+    int  m_reading = 0;
+};
+
+// DISTINCT por hash de la fila completa (NULL igual a NULL), en streaming.
+// Si las claves vistas pasan del presupuesto, el conjunto se congela: lo que
+// no está en él va a disco por partición y se deduplica al final, partición
+// a partición (esas filas salen después; sin ORDER BY no hay orden).
+class DistinctOp : public SqlOperator {
+public:
+    DistinctOp(SqlOperatorPtr child, qint64 budget) : m_budget(budget) {
+        m_columns = child->columns();
+        m_children << child;
+    }
+    void open() override {
+        m_children[0]->open();
+        m_inputDone = false;
+        m_seen.clear();
+        m_bytes = 0;
+        m_spill.reset();
+        m_part = -1;
+    }
+    void close() override {
+        if (!m_inputDone) m_children[0]->close();
+        m_inputDone = true;
+        m_seen.clear();
+        m_spill.reset();
+    }
+    bool next(Record& row) override {
+        if (!m_inputDone) {
+            SqlOperator& in = *m_children[0];
+            while (in.next(row)) {
+                const SqlKey k = rowKey(row);
+                if (m_seen.contains(k)) continue;
+                if (!m_spill) {
+                    const qint64 cost = keyBytes(k);
+                    if (m_bytes + cost <= m_budget) {
+                        m_seen.insert(k);
+                        m_bytes += cost;
+                        m_memBytes = qMax(m_memBytes, m_bytes);
+                        return true;
+                    }
+                    m_spill.reset(new SpillFiles);
+                }
+                if (!m_spill->write(k, row)) {   // seguir en memoria repetiría filas ya volcadas
+                    in.close();
+                    m_inputDone = true;
+                    m_spill.reset();
+                    return fail(kSpillError);
+                }
+            }
+            in.close();
+            m_inputDone = true;
+            m_seen.clear();     // lo que se escribió no estaba entre lo ya devuelto
+        }
+        if (!m_spill) return false;
+        for (;;) {
+            if (m_part >= 0) {
+                while (m_spill->read(&row)) {
+                    const SqlKey k = rowKey(row);
+                    if (m_seen.contains(k)) continue;
+                    m_seen.insert(k);
+                    return true;
+                }
+            }
+            if (++m_part >= SpillFiles::kParts) { m_spill.reset(); return false; }
+            m_seen.clear();
+            m_spill->rewind(m_part);
+        }
+    }
+    QString describe() const override { return "Distinct (hash)"; }
+
+private:
+    qint64                      m_budget;
+    bool                        m_inputDone = true;
+    QSet<SqlKey>                m_seen;
+    qint64                      m_bytes = 0;
+    QScopedPointer<SpillFiles>  m_spill;
+    int                         m_part = -1;
+};
+
+// UNION ALL: la izquierda y después la derecha
+class ConcatOp : public SqlOperator {
+public:
+    ConcatOp(SqlOperatorPtr left, SqlOperatorPtr right) {
+        m_columns = left->columns();
+        m_children << left << right;
+    }
+    void open() override { m_side = 0; m_children[0]->open(); }
+    void close() override {
+        if (m_side < 2) m_children[m_side]->close();
+        m_side = 2;
+    }
+    bool next(Record& row) override {
+        while (m_side < 2) {
+            if (m_children[m_side]->next(row)) return true;
+            m_children[m_side]->close();
+            if (++m_side < 2) m_children[m_side]->open();
+        }
+        return false;
+    }
+    QString describe() const override { return "Union all"; }
+
+private:
+    int m_side = 2;
+};
+
+// INTERSECT (keep = true) / EXCEPT (keep = false): conjunto hash de la
+// derecha y la izquierda (ya sin duplicados) en streaming. Si la derecha no
+// cabe en el presupuesto, ambos lados se parten en disco por hash y se
+// procesa partición contra partición.
+class SetMatchOp : public SqlOperator {
+public:
+    SetMatchOp(SqlOperatorPtr left, SqlOperatorPtr right, bool keep, qint64 budget)
+        : m_keep(keep), m_budget(budget) {
+        m_columns = left->columns();
+        m_children << left << right;
+    }
+    void open() override {
+        m_right.clear();
+        m_rightSpill.reset();
+        m_leftSpill.reset();
+        qint64 bytes = 0;
+        SqlOperator& rin = *m_children[1];
+        rin.open();
+        Record r;
+        bool spilled = true;
+        while (spilled && rin.next(r)) {
+            const SqlKey k = rowKey(r);
+            if (m_rightSpill) { spilled = m_rightSpill->write(k, r); continue; }
+            if (m_right.contains(k)) continue;
+            const qint64 cost = keyBytes(k);
+            if (bytes + cost <= m_budget) {
+                m_right.insert(k);
+                bytes += cost;
+                m_memBytes = qMax(m_memBytes, bytes);
+                continue;
+            }
+            // Pasa a disco: las claves ya vistas (como filas representativas) y el resto
+            m_rightSpill.reset(new SpillFiles);
+            for (const SqlKey& kk : std::as_const(m_right)) {
+                Record rep(kk.size());
+                for (int i = 0; i < kk.size(); ++i) rep[i] = kk[i].value();
+                spilled = spilled && m_rightSpill->write(kk, rep);
+            }
+            m_right.clear();
+            spilled = spilled && m_rightSpill->write(k, r);
+        }
+        rin.close();
+
+        m_children[0]->open();
+        m_leftOpen = true;
+        if (m_rightSpill) {
+            m_leftSpill.reset(new SpillFiles);
+            Record l;
+            while (spilled && m_children[0]->next(l)) spilled = m_leftSpill->write(rowKey(l), l);
+            m_children[0]->close();
+            m_leftOpen = false;
+            m_part = -1;
+        }
+        // Con una partición incompleta el resultado sería incorrecto: la consulta falla
+        if (!spilled) {
+            m_rightSpill.reset();
+            m_leftSpill.reset();
+            fail(kSpillError);
+        }
+    }
+    void close() override {
+        if (m_leftOpen) m_children[0]->close();
+        m_leftOpen = false;
+        m_right.clear();
+        m_rightSpill.reset();
+        m_leftSpill.reset();
+    }
+    bool next(Record& row) override {
+        if (!m_error.isEmpty()) return false;
+        if (!m_rightSpill) {
+            while (m_children[0]->next(row))
+                if (m_right.contains(rowKey(row)) == m_keep) return true;
+            return false;
+        }
+        for (;;) {
+            if (m_part >= 0) {
+                while (m_leftSpill->read(&row))
+                    if (m_right.contains(rowKey(row)) == m_keep) return true;
+            }
+            if (++m_part >= SpillFiles::kParts) return false;
+            m_right.clear();
+            m_rightSpill->rewind(m_part);
+            Record r;
+            while (m_rightSpill->read(&r)) m_right.insert(rowKey(r));
+            m_leftSpill->rewind(m_part);
+        }
+    }
+    QString describe() const override { return m_keep ? "Intersect (hash)" : "Except (hash)"; }
+
+private:
+    bool                        m_keep;
+    qint64                      m_budget;
+    QSet<SqlKey>                m_right;
+    QScopedPointer<SpillFiles>  m_rightSpill, m_leftSpill;
+    bool                        m_leftOpen = false;
+    int                         m_part = -1;
+};
+
+/* ---------- Subconsultas (semi / anti join) ---------- */
+// IN (SELECT ...) y [NOT] EXISTS del WHERE: la subconsulta (derecha) se
+// materializa una vez como conjunto hash de claves y cada fila izquierda sale
+// o no según esté la suya; la salida son solo las columnas izquierdas. Las
+// primeras claves son las de correlación (igualdades con la consulta
+// exterior) y, en IN, la última es el valor buscado: la derecha entrega sus
+// columnas en ese mismo orden. NOT IN sigue la lógica de tres valores: si el
+// grupo de correlación tiene un NULL, o el valor de la izquierda lo es, lo
+// que no coincide queda desconocido y no sale.
+class SemiJoinOp : public SqlOperator {
+public:
+    enum class Mode { Semi, Anti, NotIn };   // IN / EXISTS, NOT EXISTS, NOT IN
+
+    SemiJoinOp(SqlOperatorPtr left, SqlOperatorPtr sub, QVector<SqlExprPtr> probeKeys, Mode mode,
+               const QString& text)
+        : m_probeKeys(std::move(probeKeys)), m_mode(mode), m_text(text) {
+        m_columns = left->columns();
+        m_children << left << sub;
+    }
+
+    void open() override {
+        m_keys.clear();
+        m_groups.clear();
+        m_nullGroups.clear();
+        const int n = m_probeKeys.size();
+        const int corr = (m_mode == Mode::NotIn) ? n - 1 : n;
+        qint64 bytes = 0;
+        SqlOperator& sub = *m_children[1];
+        sub.open();
+        Record r;
+        SqlKey k(n);
+        while (sub.next(r)) {
+            bool null = false;
+            for (int i = 0; i < n; ++i) {
+                k[i] = SqlKeyPart::of(r.value(i));
+                null = null || (i < corr && k[i].cls == SqlKeyPart::Null);
+            }
+            if (null) continue;                         // correlación con NULL: no coincide con nada
+            if (m_mode == Mode::NotIn) {
+                const SqlKey g = k.mid(0, corr);
+                if (!m_groups.contains(g)) { m_groups.insert(g); bytes += keyBytes(g); }
+                if (k[corr].cls == SqlKeyPart::Null) { m_nullGroups.insert(g); continue; }
+            }
+            if (m_keys.contains(k)) continue;
+            m_keys.insert(k);
+            bytes += keyBytes(k);
+            if (n == 0) break;                          // EXISTS sin correlación: basta una fila
+        }
+        sub.close();
+        m_memBytes = qMax(m_memBytes, bytes);
+        m_children[0]->open();
+    }
+    void close() override {
+        m_children[0]->close();
+        m_keys.clear();
+        m_groups.clear();
+        m_nullGroups.clear();
+    }
+    bool next(Record& row) override {
+        while (m_children[0]->next(row))
+            if (passes(row)) return true;
+        return false;
+    }
+    QString describe() const override {
+        return QString("Hash %1 join (construye la subconsulta) %2")
+            .arg(m_mode == Mode::Semi ? "semi" : "anti", m_text);
+    }
+
+private:
+    bool passes(const Record& row) const {
+        const int n = m_probeKeys.size();
+        const int corr = (m_mode == Mode::NotIn) ? n - 1 : n;
+        SqlKey k(n);
+        bool corrNull = false;                          // en IN / EXISTS cuentan todas las claves
+        for (int i = 0; i < n; ++i) {
+            k[i] = SqlKeyPart::of(sqlEval(*m_probeKeys[i], row));
+            corrNull = corrNull || (i < corr && k[i].cls == SqlKeyPart::Null);
+        }
+        switch (m_mode) {
+        case Mode::Semi:
+            return !corrNull && m_keys.contains(k);
+        case Mode::Anti:
+            return corrNull || !m_keys.contains(k);
+        case Mode::NotIn: {
+            if (corrNull) return true;                  // grupo vacío: NOT IN es cierto
+            const SqlKey g = k.mid(0, corr);
+            if (!m_groups.contains(g)) return true;
+            if (k[corr].cls == SqlKeyPart::Null || m_keys.contains(k)) return false;
+            return !m_nullGroups.contains(g);
+        }
+        }
+        return false;
+    }
+
+    QVector<SqlExprPtr> m_probeKeys;    // enlazadas contra la izquierda
+    Mode                m_mode;
+    QString             m_text;
+    QSet<SqlKey>        m_keys;         // claves completas sin NULL
+    QSet<SqlKey>        m_groups;       // NOT IN: grupos de correlación con alguna fila
+    QSet<SqlKey>        m_nullGroups;   // NOT IN: grupos con un NULL en el valor
+};
+
+/* ---------- EXPLAIN ANALYZE ---------- */
+// Envuelve un operador y mide lo que pasa por él: tiempo inclusivo de
+// open/next/close (lo de sus hijos incluido), filas y bytes de salida
+class ProfileOp : public SqlOperator {
+public:
+    explicit ProfileOp(SqlOperatorPtr inner) {
+        m_columns = inner->columns();
+        m_children << inner;
+    }
+    void open() override {
+        QElapsedTimer t; t.start();
+        m_children[0]->open();
+        m_nanos += t.nsecsElapsed();
+    }
+    bool next(Record& row) override {
+        QElapsedTimer t; t.start();
+        const bool ok = m_children[0]->next(row);
+        m_nanos += t.nsecsElapsed();
+        if (ok) { ++m_rows; m_bytes += recordBytes(row); }
+        return ok;
+    }
+    void close() override {
+        QElapsedTimer t; t.start();
+        m_children[0]->close();
+        m_nanos += t.nsecsElapsed();
+    }
+    QString describe() const override { return m_children[0]->describe(); }
+
+    const SqlOperator& inner() const { return *m_children[0]; }
+    qint64 rows() const  { return m_rows; }
+    qint64 nanos() const { return m_nanos; }
+    qint64 bytes() const { return m_bytes; }
+
+private:
+    qint64 m_rows = 0, m_nanos = 0, m_bytes = 0;
+};
+
+// El plan con un ProfileOp sobre cada operador
+SqlOperatorPtr profiled(const SqlOperatorPtr& op)
+{
+    op->wrapChildren(profiled);
+    return SqlOperatorPtr(new ProfileOp(op));
+}
+
+QString bytesText(qint64 b)
+{
+    if (b < 1024) return QString("%1 B").arg(b);
+    if (b < 1024 * 1024) return QString("%1 KB").arg(b / 1024.0, 0, 'f', 1);
+    return QString("%1 MB").arg(b / (1024.0 * 1024.0), 0, 'f', 1);
+}
+
+// Una línea por operador: estimadas contra reales, tiempo (total y propio,
+// sin el de sus hijos), bytes de salida y memoria retenida
+void analyzeLines(const ProfileOp& p, int depth, QVector<Record>* out)
+{
+    const SqlOperator& op = p.inner();
+    qint64 childNanos = 0;
+    for (const SqlOperatorPtr& c : op.children()) childNanos += static_cast<const ProfileOp&>(*c).nanos();
+    const qint64 est = op.estimatedRows();
+    QString line = QString(depth * 2, ' ') + op.describe()
+                 + QString(" — filas est. %1, reales %2; %3 ms (propio %4 ms); salida %5")
+                       .arg(est < 0 ? QString("?") : QString::number(est))
+                       .arg(p.rows())
+                       .arg(p.nanos() / 1e6, 0, 'f', 2)
+                       .arg(qMax<qint64>(0, p.nanos() - childNanos) / 1e6, 0, 'f', 2)
+                       .arg(bytesText(p.bytes()));
+    if (op.memoryBytes() > 0) line += QString("; memoria %1").arg(bytesText(op.memoryBytes()));
+    out->push_back(Record{ line });
+    for (const SqlOperatorPtr& c : op.children())
+        analyzeLines(static_cast<const ProfileOp&>(*c), depth + 1, out);
+}
+
+// EXPLAIN ANALYZE: al abrirse ejecuta el plan medido hasta el final
+// (descartando las filas) y entrega el informe, una fila por operador
+class AnalyzeOp : public SqlOperator {
+public:
+    explicit AnalyzeOp(const SqlOperatorPtr& plan) {
+        m_columns = { SqlColumn{ QString(), QString(), "Plan" } };
+        m_children << profiled(plan);
+    }
+    void open() override {
+        m_lines.clear();
+        m_pos = 0;
+        QElapsedTimer total; total.start();
+        SqlOperator& root = *m_children[0];
+        root.open();
+        Record row;
+        while (root.next(row)) {}
+        root.close();
+        const qint64 ns = total.nsecsElapsed();
+        analyzeLines(static_cast<const ProfileOp&>(root), 0, &m_lines);
+        m_lines.push_back(Record{ QString("Total: %1 ms%2").arg(ns / 1e6, 0, 'f', 2)
+                                      .arg(cancelled() ? " (cancelado)" : "") });
+    }
+    bool next(Record& row) override {
+        if (m_pos >= m_lines.size()) return false;
+        row = m_lines[m_pos++];
+        return true;
+    }
+    QString describe() const override { return "Explain analyze"; }
+
+private:
+    QVector<Record> m_lines;
+    int             m_pos = 0;
+};
+
+// Árbol de operadores, una línea por operador, sangrado por nivel
+void planLines(const SqlOperator& op, int depth, QVector<Record>* out)
+{
+    out->push_back(Record{ QString(depth * 2, ' ') + op.describe() });
+    for (const SqlOperatorPtr& c : op.children()) planLines(*c, depth + 1, out);
+}
+
+// Nombre real de una tabla dentro de una lista (sin distinguir mayúsculas)
+QString matchTable(const QStringList& names, const QString& raw)
+{
+    if (names.contains(raw)) return raw;
+    for (const QString& n : names)
+        if (n.compare(raw, Qt::CaseInsensitive) == 0) return n;
+    return {};
+}
+
+} // namespace
+
+/* ========================== SqlAggregator ========================== */
+int SqlAggregator::groupOf(const Record& values)
+{
+    SqlKey key(values.size());
+    for (int i = 0; i < values.size(); ++i) key[i] = SqlKeyPart::of(values[i]);
+    const auto it = m_index.constFind(key);
+    if (it != m_index.constEnd()) return *it;
+    m_groups.push_back({ values, QVector<Acc>(m_fns.size()), 0 });
+    m_index.insert(key, m_groups.size() - 1);
+    return m_groups.size() - 1;
+}
+
+void SqlAggregator::addValue(Acc& a, SqlAggFn fn, const QVariant& v) const
+{
+    if (fn == SqlAggFn::CountAll) { ++a.count; return; }
+    if (sqlIsNull(v)) return;
+    switch (fn) {
+    case SqlAggFn::Count:
+        ++a.count;
+        break;
+    case SqlAggFn::Sum:
+    case SqlAggFn::Avg: {
+        const bool isInt = v.typeId() == QMetaType::LongLong;
+        if (isInt && a.intSum) {
+            qint64 r;
+            if (!qAddOverflow(a.isum, v.toLongLong(), &r)) { a.isum = r; ++a.count; break; }
+        }
+        bool ok = false;
+        const double d = v.toDouble(&ok);
+        if (!ok) break;                    // texto no numérico: no suma
+        a.intSum = false;
+        a.dsum += d;
+        ++a.count;
+        break;
+    }
+    case SqlAggFn::Min:
+    case SqlAggFn::Max:
+        ++a.count;
+        if (sqlIsNull(a.best) || (fn == SqlAggFn::Min ? sqlCompare(v, a.best) < 0 : sqlCompare(v, a.best) > 0))
+            a.best = v;
+        break;
+    case SqlAggFn::CountAll:
+        break;
+    }
+}
+
+// Inverso de addValue. Las sumas se descuentan del total (isum + dsum): da
+// igual en cuál de las dos partes había entrado el valor.
+bool SqlAggregator::removeValue(Acc& a, SqlAggFn fn, const QVariant& v) const
+{
+    if (fn == SqlAggFn::CountAll) { --a.count; return true; }
+    if (sqlIsNull(v)) return true;
+    switch (fn) {
+    case SqlAggFn::Count:
+        --a.count;
+        break;
+    case SqlAggFn::Sum:
+    case SqlAggFn::Avg: {
+        const bool isInt = v.typeId() == QMetaType::LongLong;
+        if (isInt && a.intSum) {
+            qint64 r;
+            if (qSubOverflow(a.isum, v.toLongLong(), &r)) return false;
+            a.isum = r;
+            --a.count;
+            break;
+        }
+        bool ok = false;
+        const double d = v.toDouble(&ok);
+        if (!ok) break;                    // no había sumado
+        a.dsum -= d;
+        --a.count;
+        break;
+    }
+    case SqlAggFn::Min:
+    case SqlAggFn::Max:
+        if (!sqlIsNull(a.best) && sqlCompare(v, a.best) == 0 && a.count > 1) return false;
+        --a.count;
+        break;
+    case SqlAggFn::CountAll:
+        break;
+    }
+    if (a.count <= 0) a = Acc();           // grupo vacío: como recién creado
+    return true;
+}
+
+void SqlAggregator::mergeAcc(Acc& a, SqlAggFn fn, const Acc& b) const
+{
+    a.count += b.count;
+    if (fn == SqlAggFn::Sum || fn == SqlAggFn::Avg) {
+        qint64 r;
+        if (a.intSum && b.intSum && !qAddOverflow(a.isum, b.isum, &r)) {
+            a.isum = r;
+        } else {
+            a.intSum = false;
+            a.dsum += b.dsum + double(b.isum);
+        }
+    } else if ((fn == SqlAggFn::Min || fn == SqlAggFn::Max) && !sqlIsNull(b.best)) {
+        if (sqlIsNull(a.best) || (fn == SqlAggFn::Min ? sqlCompare(b.best, a.best) < 0
+                                                      : sqlCompare(b.best, a.best) > 0))
+            a.best = b.best;
+    }
+}
+
+void SqlAggregator::add(const Record& groupValues, const Record& args)
+{
+    addTo(groupOf(groupValues), args);
+}
+
+void SqlAggregator::addTo(int group, const Record& args)
+{
+    Group& g = m_groups[group];
+    ++g.rows;
+    for (int i = 0; i < m_fns.size(); ++i) addValue(g.accs[i], m_fns[i], args.value(i));
+}
+
+int SqlAggregator::groupOfCode(qint32 code) const
+{
+    return code < m_byCode.size() ? m_byCode[code] : -1;
+}
+
+int SqlAggregator::bindCode(qint32 code, const Record& groupValues)
+{
+    if (code >= m_byCode.size()) m_byCode.resize(code + 1, -1);
+    return m_byCode[code] = groupOf(groupValues);
+}
+
+bool SqlAggregator::remove(const Record& groupValues, const Record& args)
+{
+    SqlKey key(groupValues.size());
+    for (int i = 0; i < groupValues.size(); ++i) key[i] = SqlKeyPart::of(groupValues[i]);
+    const auto it = m_index.constFind(key);
+    if (it == m_index.constEnd() || m_groups[*it].rows <= 0) return false;
+    Group& g = m_groups[*it];
+    --g.rows;
+    for (int i = 0; i < m_fns.size(); ++i)
+        if (!removeValue(g.accs[i], m_fns[i], args.value(i))) return false;
+    return true;
+}
+
+void SqlAggregator::merge(const SqlAggregator& other)
+{
+    for (const Group& og : other.m_groups) {
+        Group& g = m_groups[groupOf(og.values)];
+        g.rows += og.rows;
+        for (int i = 0; i < m_fns.size(); ++i) mergeAcc(g.accs[i], m_fns[i], og.accs[i]);
+    }
+}
+
+void SqlAggregator::ensureGroup(const Record& groupValues)
+{
+    groupOf(groupValues);
+}
+
+Record SqlAggregator::results(int g) const
+{
+    Record out(m_fns.size());
+    const QVector<Acc>& accs = m_groups[g].accs;
+    for (int i = 0; i < m_fns.size(); ++i) {
+        const Acc& a = accs[i];
+        switch (m_fns[i]) {
+        case SqlAggFn::Count:
+        case SqlAggFn::CountAll:
+            out[i] = a.count;
+            break;
+        case SqlAggFn::Sum:
+            if (a.count > 0) out[i] = a.intSum ? QVariant(a.isum) : QVariant(double(a.isum) + a.dsum);
+            break;
+        case SqlAggFn::Avg:
+            if (a.count > 0) out[i] = (double(a.isum) + a.dsum) / double(a.count);
+            break;
+        case SqlAggFn::Min:
+        case SqlAggFn::Max:
+            out[i] = a.best;
+            break;
+        }
+    }
+    return out;
+}
+
+/* ============================ SqlCursor ============================ */
+bool SqlCursor::next()
+{
+    if (!m_root || m_done) return false;
+    if (isCancelled()) { close(); return false; }
+    if (!m_open) { m_root->open(); m_open = true; }
+    if (m_root->next(m_row)) return true;
+    m_root->close();
+    m_done = true;
+    m_row.clear();
+    return false;
+}
+
+QMap<QString, QVariant> SqlCursor::rowMap() const
+{
+    QMap<QString, QVariant> m;
+    for (int i = 0; i < m_names.size(); ++i) m.insert(m_names[i], m_row.value(i));
+    return m;
+}
+
+void SqlCursor::close()
+{
+    if (m_root && m_open && !m_done) m_root->close();
+    m_done = true;
+    m_row.clear();
+}
+
+void SqlCursor::cancel()
+{
+    if (m_cancel) m_cancel->store(true);
+}
+
+bool SqlCursor::isCancelled() const
+{
+    return m_cancel && m_cancel->load();
+}
+
+QString SqlCursor::error() const
+{
+    return m_root ? m_root->error() : QString();
+}
+
+/* ============================ SqlEngine ============================ */
+QString SqlEngine::resolveTable(const QString& raw) const
+{
+    return matchTable(m_dm.tables(), raw);
+}
+
+QStringList SqlEngine::tablesOf(const SqlStatement& st) const
+{
+    QStringList raw;
+    auto fromOf = [&](const SqlSelect& q) {
+        raw << q.from.name;
+        for (const SqlJoin& j : q.joins) raw << j.table.name;
+    };
+    auto subqueryTables = [&](const SqlExprPtr& where) {
+        if (where) visitExpr(where, [&](SqlExpr& x) { if (x.subquery) forEachSelect(*x.subquery, fromOf); });
+    };
+    switch (st.kind) {
+    case SqlStatement::Kind::Select:
+        forEachSelect(st.select, fromOf);
+        break;
+    case SqlStatement::Kind::Insert: raw << st.insert.table;     break;
+    case SqlStatement::Kind::Update: raw << st.update.table.name; subqueryTables(st.update.where); break;
+    case SqlStatement::Kind::Delete: raw << st.del.table.name;    subqueryTables(st.del.where);    break;
+    case SqlStatement::Kind::Invalid: break;
+    }
+    QStringList out;
+    for (const QString& r : raw) {
+        const QString t = resolveTable(r);
+        if (!t.isEmpty() && !out.contains(t)) out << t;
+    }
+    return out;
+}
+
+bool SqlEngine::query(const QString& sql, SqlCursor* out, QString* err) const
+{
+    SqlStatement st;
+    if (!SqlParser::parse(sql, &st, err)) return false;
+    if (st.kind != SqlStatement::Kind::Select) {
+        if (err) *err = "Solo se pueden consultar sentencias SELECT.";
+        return false;
+    }
+    return query(st.select, m_dm.snapshot(tablesOf(st)), out, err);
+}
+
+bool SqlEngine::query(const QString& sql, const DataSnapshot& snap, SqlCursor* out, QString* err) const
+{
+    SqlStatement st;
+    if (!SqlParser::parse(sql, &st, err)) return false;
+    if (st.kind != SqlStatement::Kind::Select) {
+        if (err) *err = "Solo se pueden consultar sentencias SELECT.";
+        return false;
+    }
+    return query(st.select, snap, out, err);
+}
+
+// Lista de salida de un SELECT: las estrellas se expanden a columnas; 'post'
+// reescribe cada expresión ya enlazada (sobre la fila agregada si hay GROUP BY)
+static bool outputList(const SqlSelect& q, const QVector<SqlColumn>& cols,
+                       const std::function<SqlExprPtr(SqlExprPtr)>& post,
+                       QVector<SqlExprPtr>* exprs, QStringList* names, QHash<QString, int>* aliases,
+                       QString* err)
+{
+    for (const SqlSelectItem& it : q.items) {
+        if (it.star) {
+            bool any = false;
+            for (int i = 0; i < cols.size(); ++i) {
+                if (!it.starTable.isEmpty() && it.starTable.compare(cols[i].table, Qt::CaseInsensitive) != 0
+                                            && it.starTable.compare(cols[i].alias, Qt::CaseInsensitive) != 0) continue;
+                SqlExprPtr c = SqlExpr::column(cols[i].table, cols[i].name);
+                c->index = i; c->text = cols[i].name;
+                if (!(c = post(c))) return false;
+                int same = 0;
+                for (const SqlColumn& o : cols) same += (o.name.compare(cols[i].name, Qt::CaseInsensitive) == 0);
+                const QString label = cols[i].alias.isEmpty() ? cols[i].table : cols[i].alias;
+                *exprs << c; *names << (same > 1 ? label + "." + cols[i].name : cols[i].name);
+                any = true;
+            }
+            if (!any) {
+                if (err) *err = QString("Tabla '%1' no está en la consulta.").arg(it.starTable);
+                return false;
+            }
+            continue;
+        }
+        SqlExprPtr e = cloneExpr(it.expr);
+        if (!bindExpr(*e, cols, err) || !(e = post(e))) return false;
+        if (!it.alias.isEmpty()) aliases->insert(it.alias.toLower(), exprs->size());
+        *exprs << e;
+        // Encabezado: alias, columna tal como se escribió (sin [..]) o el texto de la expresión
+        if (!it.alias.isEmpty())
+            *names << it.alias;
+        else if (e->kind == SqlExpr::Kind::Column)
+            *names << (e->table.isEmpty() ? e->name : e->table + "." + e->name);
+        else
+            *names << e->text;
+    }
+    return true;
+}
+
+static bool planQuery(const SqlSelect& q, const DataSnapshot& snap,
+                      SqlOperatorPtr* outRoot, QStringList* outNames, QString* err);
+
+// ¿Hay entre 'cols' una columna como la referencia (sin enlazar) 'e'?
+static bool hasColumn(const QVector<SqlColumn>& cols, const SqlExpr& e)
+{
+    for (const SqlColumn& c : cols) {
+        if (c.name.compare(e.name, Qt::CaseInsensitive) != 0) continue;
+        if (e.table.isEmpty() || e.table.compare(c.table, Qt::CaseInsensitive) == 0
+                              || e.table.compare(c.alias, Qt::CaseInsensitive) == 0) return true;
+    }
+    return false;
+}
+
+// Semi / anti join de una condición IN (SELECT ...) o [NOT] EXISTS del WHERE
+// sobre 'outer' (filas con las columnas 'outerCols'). La subconsulta puede
+// usar columnas de la exterior solo en conjunciones de su WHERE de la forma
+// interior = exterior: salen de ahí y pasan a ser claves del join, así la
+// subconsulta se calcula una vez y no por cada fila de fuera.
+static SqlOperatorPtr semiJoin(const SqlExpr& c, const SqlOperatorPtr& outer, const QVector<SqlColumn>& outerCols,
+                               const DataSnapshot& snap, QString* err)
+{
+    const bool in = c.kind == SqlExpr::Kind::InSelect;
+    SqlSelect sub = *c.subquery;
+
+    QVector<SqlColumn> innerCols;
+    QVector<SqlTableRef> refs{ sub.from };
+    for (const SqlJoin& j : sub.joins) refs << j.table;
+    for (const SqlTableRef& r : refs) {
+        const QString t = matchTable(snap.tables(), r.name);
+        if (t.isEmpty()) {
+            if (err) *err = QString("Tabla '%1' no existe.").arg(r.name);
+            return {};
+        }
+        for (const FieldDef& f : snap.schema(t)) innerCols.push_back({ t, r.alias, f.name });
+    }
+
+    // Correlación: columna que no es de la subconsulta pero sí de la exterior
+    auto refsOf = [&](const SqlExprPtr& e, int* inner, int* outerRefs) {
+        *inner = *outerRefs = 0;
+        visitExpr(e, [&](SqlExpr& x) {
+            if (x.kind != SqlExpr::Kind::Column) return;
+            if (hasColumn(innerCols, x)) ++*inner;
+            else if (hasColumn(outerCols, x)) ++*outerRefs;
+        });
+    };
+    QVector<SqlExprPtr> probeKeys, innerKeys, kept;
+    if (sub.where) {
+        QVector<SqlExprPtr> conds;
+        splitAnd(sub.where, &conds);
+        for (const SqlExprPtr& k : conds) {
+            int ni = 0, no = 0;
+            refsOf(k, &ni, &no);
+            if (no == 0) { kept << k; continue; }
+            int li = 0, lo = 0, ri = 0, ro = 0;
+            const bool eq = k->kind == SqlExpr::Kind::Binary && k->op == "=";
+            if (eq) { refsOf(k->args[0], &li, &lo); refsOf(k->args[1], &ri, &ro); }
+            const bool leftOuter  = eq && lo > 0 && li == 0 && ro == 0;
+            const bool rightOuter = eq && ro > 0 && ri == 0 && lo == 0;
+            if (!leftOuter && !rightOuter) {
+                if (err) *err = QString("En una subconsulta, la consulta exterior solo se puede usar en "
+                                        "igualdades unidas con AND: '%1'.").arg(k->text);
+                return {};
+            }
+            SqlExprPtr o = cloneExpr(k->args[leftOuter ? 0 : 1]);
+            if (!bindExpr(*o, outerCols, err)) return {};
+            probeKeys << o;
+            innerKeys << k->args[leftOuter ? 1 : 0];
+        }
+    }
+
+    // Correlacionada: sin esas igualdades, la subconsulta entrega sus claves
+    // (y en IN el valor) y el join hace el resto
+    if (!probeKeys.isEmpty()) {
+        bool aggregate = !sub.groupBy.isEmpty() || sub.having;
+        for (const SqlSelectItem& it : sub.items) aggregate = aggregate || (!it.star && hasAggregate(*it.expr));
+        if (aggregate || !sub.compound.isEmpty() || sub.limit >= 0 || sub.offset > 0) {
+            if (err) *err = QString("Una subconsulta que usa la consulta exterior no admite agregados, "
+                                    "UNION... ni LIMIT: '%1'.").arg(c.text);
+            return {};
+        }
+        QVector<SqlSelectItem> items;
+        for (const SqlExprPtr& k : innerKeys) {
+            SqlSelectItem it;
+            it.expr = k;
+            items << it;
+        }
+        if (in) items += sub.items;
+        sub.items = items;
+        sub.where = joinAnd(kept);
+        sub.distinct = false;
+        sub.orderBy.clear();
+    }
+
+    SqlOperatorPtr root;
+    QStringList names;
+    if (!planQuery(sub, snap, &root, &names, err)) return {};
+    if (in) {
+        if (names.size() != innerKeys.size() + 1) {
+            if (err) *err = QString("La subconsulta de IN debe devolver una sola columna: '%1'.").arg(c.text);
+            return {};
+        }
+        SqlExprPtr v = cloneExpr(c.args[0]);
+        if (!bindExpr(*v, outerCols, err)) return {};
+        probeKeys << v;
+    }
+    const auto mode = !c.negated ? SemiJoinOp::Mode::Semi
+                    : in         ? SemiJoinOp::Mode::NotIn : SemiJoinOp::Mode::Anti;
+    return SqlOperatorPtr(new SemiJoinOp(outer, root, probeKeys, mode, c.text));
+}
+
+// Plan de un SELECT simple hasta la proyección. Con ordered = false no se
+// planifican ORDER BY ni LIMIT: DISTINCT y las operaciones de conjuntos los
+// aplican después, sobre las filas ya proyectadas.
+static bool planSelect(const SqlSelect& q, const DataSnapshot& snap, bool ordered,
+                       SqlOperatorPtr* outRoot, QStringList* outNames, QString* err)
+{
+    // FROM y JOINs: cada tabla ocupa un tramo de columnas del registro combinado
+    struct Source {
+        QString            table;
+        const ColumnTable* tab = nullptr;
+        int                offset = 0, width = 0;
+        QVector<SqlExprPtr> pushed;      // condiciones solo sobre esta tabla (van al scan)
+    };
+    QVector<SqlTableRef> refs{ q.from };
+    for (const SqlJoin& j : q.joins) refs << j.table;
+    if (refs.size() > 64) {
+        if (err) *err = "Demasiadas tablas en la consulta.";
+        return false;
+    }
+    QVector<Source> srcs;
+    QVector<SqlColumn> cols;
+    QVector<int> tableOfCol;
+    for (const SqlTableRef& r : refs) {
+        Source src;
+        src.table = matchTable(snap.tables(), r.name);
+        if (src.table.isEmpty()) {
+            if (err) *err = QString("Tabla '%1' no existe.").arg(r.name);
+            return false;
+        }
+        const Schema& sch = snap.schema(src.table);
+        src.tab = &snap.columnTable(src.table);
+        src.offset = cols.size();
+        src.width = qMin(int(sch.size()), src.tab->columnCount());
+        for (int i = 0; i < src.width; ++i) {
+            cols.push_back({ src.table, r.alias, sch[i].name });
+            tableOfCol.push_back(srcs.size());
+        }
+        srcs << src;
+    }
+
+    // WHERE: cada conjunción que usa una sola tabla baja a su scan (a la
+    // derecha de un LEFT JOIN no: filtraría antes de completar con NULL);
+    // el resto queda en un Filter sobre el registro combinado.
+    QVector<SqlExprPtr> rest;
+    auto pushOrKeep = [&](const SqlExprPtr& c) {
+        const quint64 used = tablesUsed(*c, tableOfCol);
+        for (int t = 0; t < srcs.size(); ++t) {
+            if (used != (quint64(1) << t)) continue;
+            if (t > 0 && q.joins[t - 1].kind == SqlJoin::Kind::Left) break;
+            srcs[t].pushed << shiftColumns(c, -srcs[t].offset);
+            return;
+        }
+        rest << c;
+    };
+    for (const SqlJoin& j : q.joins) {
+        if (hasAggregate(*j.on)) {
+            if (err) *err = "No se permiten funciones de agregado en ON.";
+            return false;
+        }
+    }
+    // Las subconsultas (IN / EXISTS) de nivel superior se apartan: van como
+    // semi / anti joins sobre el resultado de los joins.
+    SqlExprPtr where;
+    QVector<SqlExprPtr> subConds;
+    if (q.where) {
+        if (hasAggregate(*q.where)) {
+            if (err) *err = "No se permiten funciones de agregado en WHERE (use HAVING).";
+            return false;
+        }
+        where = cloneExpr(splitSubqueries(q.where, &subConds));
+    }
+    if (where) {
+        if (!bindExpr(*where, cols, err)) return false;
+        if (q.joins.isEmpty()) srcs[0].pushed << where;
+        else {
+            QVector<SqlExprPtr> conds;
+            splitAnd(where, &conds);
+            for (const SqlExprPtr& c : conds) pushOrKeep(c);
+        }
+    }
+
+    // ON: igualdades izquierda = derecha son claves; en INNER el resto equivale
+    // a WHERE; en LEFT lo que es solo de la derecha filtra su scan y lo demás
+    // queda como residuo del join.
+    struct JoinPlan {
+        QVector<SqlExprPtr> leftKeys, rightKeys;
+        QVector<SqlExprPtr> residual;
+    };
+    QVector<JoinPlan> jplans(q.joins.size());
+    for (int j = 0; j < q.joins.size(); ++j) {
+        const int t = j + 1;
+        const QVector<SqlColumn> visible = cols.mid(0, srcs[t].offset + srcs[t].width);
+        SqlExprPtr on = cloneExpr(q.joins[j].on);
+        if (!bindExpr(*on, visible, err)) return false;
+        const bool left = q.joins[j].kind == SqlJoin::Kind::Left;
+        const quint64 rightBit = quint64(1) << t, leftBits = rightBit - 1;
+        QVector<SqlExprPtr> conds;
+        splitAnd(on, &conds);
+        for (const SqlExprPtr& c : conds) {
+            if (c->kind == SqlExpr::Kind::Binary && c->op == "=") {
+                const quint64 a = tablesUsed(*c->args[0], tableOfCol), b = tablesUsed(*c->args[1], tableOfCol);
+                const bool ab = a && !(a & ~leftBits) && b == rightBit;
+                const bool ba = b && !(b & ~leftBits) && a == rightBit;
+                if (ab || ba) {
+                    jplans[j].leftKeys  << (ab ? c->args[0] : c->args[1]);
+                    jplans[j].rightKeys << shiftColumns(ab ? c->args[1] : c->args[0], -srcs[t].offset);
+                    continue;
+                }
+            }
+            if (!left) pushOrKeep(c);
+            else if (tablesUsed(*c, tableOfCol) == rightBit) srcs[t].pushed << shiftColumns(c, -srcs[t].offset);
+            else jplans[j].residual << c;
+        }
+    }
+
+    // Scans: predicado compilado contra su tabla; el planificador decide si
+    // cada uno parte de un índice
+    QVector<ScanOp*> scans;
+    QVector<SqlAccessPath> paths;
+    for (const Source& src : srcs) {
+        SqlPredicate pred;
+        SqlAccessPath path;
+        path.estimatedRows = src.tab->liveCount();
+        const SqlExprPtr w = joinAnd(src.pushed);
+        if (w) {
+            pred = SqlPredicate::compile(w, *src.tab);
+            path = SqlPlanner::chooseAccessPath(w, *src.tab);
+        }
+        scans << new ScanOp(*src.tab, src.table, cols.mid(src.offset, src.width), pred,
+                            w ? w->text : QString(), path);
+        paths << path;
+    }
+    const bool fullScan = paths[0].kind == SqlAccessPath::Kind::FullScan;
+    auto* scan = scans[0];
+    SqlOperatorPtr root(scan);
+
+    for (int j = 0; j < q.joins.size(); ++j) {
+        const int t = j + 1;
+        const JoinPlan& jp = jplans[j];
+        const bool left = q.joins[j].kind == SqlJoin::Kind::Left;
+        const SqlExprPtr residual = joinAnd(jp.residual);
+        SqlOperatorPtr right(scans[t]);
+
+        // Una sola clave columna = columna, con índice ordenado en ambos lados
+        // y sin filtro por índice: los dos scans salen ordenados y se mezclan
+        const bool oneColKey = jp.leftKeys.size() == 1
+                            && jp.leftKeys[0]->kind == SqlExpr::Kind::Column
+                            && jp.rightKeys[0]->kind == SqlExpr::Kind::Column;
+        if (t == 1 && oneColKey && fullScan && paths[t].kind == SqlAccessPath::Kind::FullScan) {
+            const int lc = jp.leftKeys[0]->index, rc = jp.rightKeys[0]->index;
+            const ColumnKind lk = srcs[0].tab->column(lc).kind(), rk = srcs[t].tab->column(rc).kind();
+            auto numeric = [](ColumnKind k) { return k == ColumnKind::Int64 || k == ColumnKind::Double; };
+            const bool comparable = (numeric(lk) && numeric(rk)) || (lk == ColumnKind::Date && rk == ColumnKind::Date);
+            if (comparable && srcs[0].tab->hasIndex(lc) && srcs[t].tab->hasIndex(rc)) {
+                scan->setOrder(lc, false);
+                scans[t]->setOrder(rc, false);
+                root = SqlOperatorPtr(new MergeJoinOp(root, right, lc, rc, residual, left, q.joins[j].on->text));
+                continue;
+            }
+        }
+
+        // Hash join: se construye sobre la tabla padre de una FK entre las dos
+        // claves (valores únicos, la hija sondea); si no hay FK, sobre el lado
+        // menor (la izquierda solo cuenta como menor si es un scan)
+        bool buildLeft = false;
+        if (!left && oneColKey) {
+            const int lc = jp.leftKeys[0]->index, rc = jp.rightKeys[0]->index;
+            const Source& ls = srcs[tableOfCol[lc]];
+            const Source& rs = srcs[t];
+            bool decided = false;
+            for (const ForeignKey& fk : snap.relationshipsFor(rs.table)) {
+                if (fk.childCol == rc && fk.parentTable == ls.table && fk.parentCol == lc - ls.offset) {
+                    buildLeft = decided = true;   // la derecha es la hija
+                    break;
+                }
+            }
+            for (const ForeignKey& fk : snap.relationshipsFor(ls.table)) {
+                if (decided) break;
+                if (fk.childCol == lc - ls.offset && fk.parentTable == rs.table && fk.parentCol == rc)
+                    decided = true;               // la izquierda es la hija: se construye la derecha
+            }
+            if (!decided && t == 1) buildLeft = paths[0].estimatedRows < paths[t].estimatedRows;
+        }
+        auto* join = new HashJoinOp(root, right, jp.leftKeys, jp.rightKeys, residual,
+                                    left, buildLeft, q.joins[j].on->text);
+        join->setDictKeys(dictKey(root, scan, jp.leftKeys), dictKey(right, scans[t], jp.rightKeys));
+        root = SqlOperatorPtr(join);
+    }
+    if (!rest.isEmpty()) root = SqlOperatorPtr(new FilterOp(root, joinAnd(rest)));
+    for (const SqlExprPtr& c : subConds)
+        if (!(root = semiJoin(*c, root, cols, snap, err))) return false;
+
+    // GROUP BY / agregados: lo que se evalúa después de agregar se reescribe
+    // sobre la fila agregada
+    bool aggregate = !q.groupBy.isEmpty() || q.having;
+    for (const SqlSelectItem& it : q.items) aggregate = aggregate || (!it.star && hasAggregate(*it.expr));
+    if (ordered)
+        for (const SqlOrderItem& o : q.orderBy) aggregate = aggregate || hasAggregate(*o.expr);
+    AggRewriter agg;
+    agg.input = &cols;
+    for (const SqlExprPtr& g : q.groupBy) {
+        if (hasAggregate(*g)) {
+            if (err) *err = "No se permiten funciones de agregado en GROUP BY.";
+            return false;
+        }
+        SqlExprPtr b = cloneExpr(g);
+        if (!bindExpr(*b, cols, err)) return false;
+        agg.groups << b;
+    }
+    auto post = [&](SqlExprPtr e) { return aggregate ? agg.rewrite(e, err) : e; };
+
+    // Lista de salida (las estrellas se expanden a columnas)
+    QVector<SqlExprPtr> exprs;
+    QStringList names;
+    QHash<QString, int> aliases;   // alias (en minúsculas) -> posición en exprs
+    if (!outputList(q, cols, post, &exprs, &names, &aliases, err)) return false;
+
+    SqlExprPtr having;
+    if (q.having) {
+        having = cloneExpr(q.having);
+        if (!bindExpr(*having, cols, err) || !(having = post(having))) return false;
+    }
+
+    // ORDER BY: alias de salida, posición (1..n) o expresión sobre la tabla
+    QVector<SqlExprPtr> keys;
+    QVector<bool> desc;
+    for (const SqlOrderItem& o : ordered ? q.orderBy : QVector<SqlOrderItem>()) {
+        SqlExprPtr k;
+        if (o.expr->kind == SqlExpr::Kind::Literal && o.expr->value.typeId() == QMetaType::LongLong) {
+            const qint64 n = o.expr->value.toLongLong();
+            if (n < 1 || n > exprs.size()) {
+                if (err) *err = QString("ORDER BY %1 fuera de rango.").arg(n);
+                return false;
+            }
+            k = exprs[int(n - 1)];
+        } else if (o.expr->kind == SqlExpr::Kind::Column && o.expr->table.isEmpty()
+                   && aliases.contains(o.expr->name.toLower())) {
+            k = exprs[aliases.value(o.expr->name.toLower())];
+        }
+        if (!k) {
+            k = cloneExpr(o.expr);
+            if (!bindExpr(*k, cols, err) || !(k = post(k))) return false;
+        }
+        keys << k; desc << o.desc;
+    }
+
+    if (aggregate) {
+        auto* hashAgg = new HashAggOp(root, agg.groups, agg.aggs, agg.columns());
+        hashAgg->setDictKey(dictKey(root, scan, agg.groups));
+        root = SqlOperatorPtr(hashAgg);
+        if (having) root = SqlOperatorPtr(new FilterOp(root, having));
+    }
+
+    if (!keys.isEmpty()) {
+        // ORDER BY col LIMIT n sin índice de filtro: si la columna tiene índice
+        // ordenado, el scan ya entrega en orden y LIMIT corta al llegar a n.
+        // Texto no: el orden del índice es alfabético y sqlCompare compara
+        // como números los textos numéricos.
+        const SqlExprPtr& k0 = keys[0];
+        const bool byIndex = keys.size() == 1 && q.limit >= 0 && fullScan && q.joins.isEmpty() && !aggregate
+                          && k0->kind == SqlExpr::Kind::Column && srcs[0].tab->hasIndex(k0->index)
+                          && srcs[0].tab->column(k0->index).kind() != ColumnKind::Text;
+        if (byIndex) {
+            scan->setOrder(k0->index, desc[0]);
+        } else {
+            const qint64 keep = (q.limit >= 0) ? q.offset + q.limit : -1;
+            root = SqlOperatorPtr(new SortOp(root, keys, desc, keep));
+        }
+    }
+
+    if (ordered && (q.limit >= 0 || q.offset > 0))
+        root = SqlOperatorPtr(new LimitOp(root, q.limit, q.offset));
+
+    *outRoot = SqlOperatorPtr(new ProjectOp(root, exprs, names));
+    *outNames = names;
+    return true;
+}
+
+// Plan completo de un SELECT, con DISTINCT, UNION... y el ORDER BY / LIMIT
+// del final (también el de cada subconsulta)
+static bool planQuery(const SqlSelect& q, const DataSnapshot& snap,
+                      SqlOperatorPtr* outRoot, QStringList* outNames, QString* err)
+{
+    // DISTINCT y UNION / INTERSECT / EXCEPT trabajan sobre filas proyectadas;
+    // el ORDER BY y el LIMIT del final van sobre el resultado combinado
+    const bool setMode = q.distinct || !q.compound.isEmpty();
+    SqlOperatorPtr root;
+    QStringList names;
+    if (!planSelect(q, snap, !setMode, &root, &names, err)) return false;
+
+    if (setMode) {
+        const qint64 budget = SqlEngine::spillBudget();
+        bool unique = q.distinct;
+        if (unique) root = SqlOperatorPtr(new DistinctOp(root, budget));
+        for (const SqlSetOp& op : q.compound) {
+            SqlOperatorPtr rhs;
+            QStringList rhsNames;
+            if (!planSelect(*op.select, snap, false, &rhs, &rhsNames, err)) return false;
+            if (rhsNames.size() != names.size()) {
+                if (err) *err = QString("Las consultas combinadas deben tener el mismo número de columnas (%1 y %2).")
+                                    .arg(names.size()).arg(rhsNames.size());
+                return false;
+            }
+            // A la derecha, DISTINCT solo cambia algo en UNION ALL
+            if (op.select->distinct && op.kind == SqlSetOp::Kind::UnionAll)
+                rhs = SqlOperatorPtr(new DistinctOp(rhs, budget));
+            switch (op.kind) {
+            case SqlSetOp::Kind::UnionAll:
+                root = SqlOperatorPtr(new ConcatOp(root, rhs));
+                unique = false;
+                break;
+            case SqlSetOp::Kind::Union:
+                root = SqlOperatorPtr(new DistinctOp(SqlOperatorPtr(new ConcatOp(root, rhs)), budget));
+                unique = true;
+                break;
+            case SqlSetOp::Kind::Intersect:
+            case SqlSetOp::Kind::Except:
+                if (!unique) root = SqlOperatorPtr(new DistinctOp(root, budget));
+                root = SqlOperatorPtr(new SetMatchOp(root, rhs, op.kind == SqlSetOp::Kind::Intersect, budget));
+                unique = true;
+                break;
+            }
+        }
+
+        // ORDER BY sobre el resultado: posición, encabezado de salida o
+        // expresión sobre las columnas de salida
+        const QVector<SqlColumn> outCols = root->columns();
+        QVector<SqlExprPtr> keys;
+        QVector<bool> desc;
+        for (const SqlOrderItem& o : q.orderBy) {
+            if (hasAggregate(*o.expr)) {
+                if (err) *err = "ORDER BY de una consulta combinada o DISTINCT no admite agregados.";
+                return false;
+            }
+            SqlExprPtr k;
+            if (o.expr->kind == SqlExpr::Kind::Literal && o.expr->value.typeId() == QMetaType::LongLong) {
+                const qint64 n = o.expr->value.toLongLong();
+                if (n < 1 || n > names.size()) {
+                    if (err) *err = QString("ORDER BY %1 fuera de rango.").arg(n);
+                    return false;
+                }
+                k = SqlExpr::column(QString(), names[int(n - 1)]);
+                k->index = int(n - 1);
+            } else if (o.expr->kind == SqlExpr::Kind::Column) {
+                const QString written = o.expr->table.isEmpty() ? o.expr->name
+                                                                : o.expr->table + "." + o.expr->name;
+                for (int i = 0; i < names.size() && !k; ++i) {
+                    if (names[i].compare(written, Qt::CaseInsensitive) != 0) continue;
+                    k = SqlExpr::column(QString(), names[i]);
+                    k->index = i;
+                }
+            }
+            if (!k) {
+                k = cloneExpr(o.expr);
+                if (!bindExpr(*k, outCols, err)) return false;
+            }
+            keys << k; desc << o.desc;
+        }
+        if (!keys.isEmpty()) {
+            const qint64 keep = (q.limit >= 0) ? q.offset + q.limit : -1;
+            root = SqlOperatorPtr(new SortOp(root, keys, desc, keep));
+        }
+        if (q.limit >= 0 || q.offset > 0)
+            root = SqlOperatorPtr(new LimitOp(root, q.limit, q.offset));
+    }
+    *outRoot = root;
+    *outNames = names;
+    return true;
+}
+
+bool SqlEngine::query(const SqlSelect& q, const DataSnapshot& snap, SqlCursor* out, QString* err) const
+{
+    SqlOperatorPtr root;
+    QStringList names;
+    if (!planQuery(q, snap, &root, &names, err)) return false;
+
+    // EXPLAIN: en vez de las filas, el plan (una fila por operador). Con
+    // ANALYZE se ejecuta al leer el cursor, así se puede cancelar como un SELECT.
+    if (q.explain) {
+        names = QStringList{ "Plan" };
+        if (q.analyze) {
+            root = SqlOperatorPtr(new AnalyzeOp(root));
+        } else {
+            QVector<Record> lines;
+            planLines(*root, 0, &lines);
+            root = SqlOperatorPtr(new ValuesOp({ SqlColumn{ QString(), QString(), names[0] } }, lines));
+        }
+    }
+
+    SqlCursor c;
+    c.m_cancel.reset(new std::atomic<bool>(false));
+    root->setCancelFlag(c.m_cancel.data());
+    c.m_root  = root;
+    c.m_snap  = snap;
+    c.m_names = names;
+    *out = c;
+    return true;
+}
+
+/* ---------- Consultas preparadas ---------- */
+// Cada expresión de nivel superior de un SELECT y de sus UNION...; con
+// 'detach' las ramas compuestas se copian antes (para reescribir una copia)
+static void forEachExpr(SqlSelect& q, bool detach, const std::function<void(SqlExprPtr&)>& f)
+{
+    for (SqlSelectItem& it : q.items)
+        if (it.expr) f(it.expr);
+    for (SqlJoin& j : q.joins) f(j.on);
+    if (q.where) f(q.where);
+    for (SqlExprPtr& g : q.groupBy) f(g);
+    if (q.having) f(q.having);
+    for (SqlOrderItem& o : q.orderBy) f(o.expr);
+    for (SqlSetOp& op : q.compound) {
+        if (detach) op.select = QSharedPointer<SqlSelect>::create(*op.select);
+        forEachExpr(*op.select, detach, f);
+    }
+}
+
+// Valores por nombre en minúsculas (los parámetros no distinguen mayúsculas)
+static QHash<QString, QVariant> paramsByName(const QVariantMap& values)
+{
+    QHash<QString, QVariant> out;
+    for (auto v = values.cbegin(); v != values.cend(); ++v) out.insert(v.key().toLower(), v.value());
+    return out;
+}
+
+// Valor de un parámetro con los tipos del parser: enteros qlonglong, reales double
+static QVariant paramLiteral(const QVariant& v)
+{
+    switch (v.typeId()) {
+    case QMetaType::Int:
+    case QMetaType::UInt:
+    case QMetaType::Long:
+    case QMetaType::ULong:
+    case QMetaType::Short:
+    case QMetaType::UShort:
+    case QMetaType::ULongLong:
+        return v.toLongLong();
+    case QMetaType::Float:
+        return v.toDouble();
+    default:
+        return v;
+    }
+}
+
+// Copia de 'e' con cada parámetro convertido en literal (conserva su texto
+// fuente: sigue siendo el encabezado si va en la lista del SELECT)
+static SqlExprPtr withParams(const SqlExprPtr& e, const QHash<QString, QVariant>& values)
+{
+    if (e->kind == SqlExpr::Kind::Param) {
+        SqlExprPtr l = SqlExpr::literal(paramLiteral(values.value(e->name.toLower())));
+        l->text = e->text;
+        return l;
+    }
+    auto c = SqlExprPtr::create(*e);
+    for (SqlExprPtr& a : c->args) a = withParams(a, values);
+    if (c->subquery) {
+        c->subquery = QSharedPointer<SqlSelect>::create(*c->subquery);
+        forEachExpr(*c->subquery, true, [&](SqlExprPtr& x) { x = withParams(x, values); });
+    }
+    return c;
+}
+
+bool SqlEngine::prepare(const QString& sql, SqlPreparedQuery* out, QString* err) const
+{
+    SqlStatement st;
+    if (!SqlParser::parse(sql, &st, err)) return false;
+    if (st.kind != SqlStatement::Kind::Select) {
+        if (err) *err = "Solo se pueden preparar sentencias SELECT.";
+        return false;
+    }
+    SqlPreparedQuery p;
+    p.m_sql = sql;
+    p.m_tables = tablesOf(st);
+    const DataSnapshot snap = m_dm.snapshot(p.m_tables);
+
+    // [Nombre] sin calificar que no es columna de ninguna tabla de la
+    // consulta (ni de sus subconsultas) ni alias de salida: parámetro, como en Access
+    QSet<QString> known;
+    for (const QString& t : p.m_tables)
+        for (const FieldDef& f : snap.schema(t)) known.insert(f.name.toLower());
+    forEachSelect(st.select, [&](const SqlSelect& q) {
+        for (const SqlSelectItem& it : q.items)
+            if (!it.alias.isEmpty()) known.insert(it.alias.toLower());
+    });
+
+    QSet<QString> seen;
+    std::function<void(SqlSelect&)> resolve = [&](SqlSelect& q) {
+        forEachExpr(q, false, [&](SqlExprPtr& top) {
+            visitExpr(top, [&](SqlExpr& e) {
+                if (e.kind == SqlExpr::Kind::Column && e.quoted && e.table.isEmpty()
+                    && !known.contains(e.name.toLower()))
+                    e.kind = SqlExpr::Kind::Param;
+                if (e.kind == SqlExpr::Kind::Param && !seen.contains(e.name.toLower())) {
+                    seen.insert(e.name.toLower());
+                    p.m_params << e.name;
+                }
+                if (e.subquery) resolve(*e.subquery);
+            });
+        });
+    };
+    resolve(st.select);
+    p.m_select = st.select;
+
+    // Se planifica una vez con los parámetros en NULL: los errores de tablas,
+    // columnas o agregados salen al preparar y no en cada ejecución
+    QVariantMap nulls;
+    for (const QString& n : p.m_params) nulls.insert(n, QVariant());
+    SqlSelect probe;
+    SqlCursor cur;
+    if (!p.bind(nulls, &probe, err) || !query(probe, snap, &cur, err)) return false;
+    cur.close();
+    *out = p;
+    return true;
+}
+
+bool SqlEngine::query(const SqlPreparedQuery& p, const QVariantMap& params, SqlCursor* out, QString* err) const
+{
+    return query(p, params, m_dm.snapshot(p.tables()), out, err);
+}
+
+bool SqlEngine::query(const SqlPreparedQuery& p, const QVariantMap& params, const DataSnapshot& snap,
+                      SqlCursor* out, QString* err) const
+{
+    SqlSelect q;
+    if (!p.bind(params, &q, err)) return false;
+    return query(q, snap, out, err);
+}
+
+int SqlEngine::execute(const QString& sql, QString* err)
+{
+    SqlStatement st;
+    if (!SqlParser::parse(sql, &st, err)) return -1;
+    return execute(st, err);
+}
+
+int SqlEngine::execute(const SqlStatement& st, QString* err)
+{
+    switch (st.kind) {
+    case SqlStatement::Kind::Insert: return execInsert(st.insert, err);
+    case SqlStatement::Kind::Update: return execUpdate(st.update, err);
+    case SqlStatement::Kind::Delete: return execDelete(st.del, err);
+    case SqlStatement::Kind::Select:
+        if (err) *err = "Un SELECT se ejecuta con query().";
+        return -1;
+    case SqlStatement::Kind::Invalid: break;
+    }
+    if (err) *err = "Sentencia vacía.";
+    return -1;
+}
+
+int SqlEngine::execInsert(const SqlInsert& q, QString* err)
+{
+    const QString table = resolveTable(q.table);
+    const TableId id = m_dm.tableId(table);
+    if (id == kInvalidTableId) {
+        if (err) *err = QString("Tabla '%1' no existe.").arg(q.table);
+        return -1;
+    }
+    const Schema s = m_dm.schema(table);
+
+    // Columnas destino (sin lista => todas, en orden de esquema)
+    QVector<int> target;
+    if (q.columns.isEmpty()) {
+        for (int i = 0; i < s.size(); ++i) target << i;
+    } else {
+        for (const QString& c : q.columns) {
+            int ix = -1;
+            for (int i = 0; i < s.size(); ++i)
+                if (s[i].name.compare(c, Qt::CaseInsensitive) == 0) { ix = i; break; }
+            if (ix < 0) {
+                if (err) *err = QString("Columna '%1' no existe.").arg(c);
+                return -1;
+            }
+            target << ix;
+        }
+    }
+
+    int inserted = 0;
+    for (const QVector<SqlExprPtr>& vals : q.rows) {
+        if (vals.size() != target.size()) {
+            if (err) *err = "# de columnas no coincide con # de valores";
+            return -1;
+        }
+        Record rec(s.size());   // NULLs por defecto
+        for (int i = 0; i < vals.size(); ++i) {
+            SqlExprPtr v = cloneExpr(vals[i]);
+            if (!bindExpr(*v, {}, err)) return -1;   // VALUES no admite columnas
+            rec[target[i]] = sqlEval(*v, Record());
+        }
+        if (!m_dm.insertRow(id, rec, err)) return -1;
+        ++inserted;
+    }
+    return inserted;
+}
+
+// Filas de la tabla que cumplen el WHERE de un UPDATE/DELETE, con el mismo
+// camino de acceso que elegiría un SELECT (índice o recorrido completo).
+// 'w' ya viene enlazado contra las columnas de la tabla.
+static QVector<int> targetSlots(const ColumnTable& tab, const SqlExprPtr& w)
+{
+    SqlPredicate pred;
+    SqlAccessPath path;
+    if (w) {
+        pred = SqlPredicate::compile(w, tab);
+        path = SqlPlanner::chooseAccessPath(w, tab);
+    }
+    QVector<int> out;
+    if (path.kind == SqlAccessPath::Kind::Index) {
+        for (int slot : path.candidates)
+            if (tab.isLive(slot) && pred.matches(slot)) out << slot;
+    } else {
+        for (int slot = 0; slot < tab.slotCount(); ++slot)
+            if (tab.isLive(slot) && pred.matches(slot)) out << slot;
+    }
+    return out;
+}
+
+// Las subconsultas del WHERE quedan aparte, en 'subConds' (ver semiFilter)
+static bool bindWhere(const SqlExprPtr& where, const QVector<SqlColumn>& cols, SqlExprPtr* out,
+                      QVector<SqlExprPtr>* subConds, QString* err)
+{
+    out->reset();
+    if (!where) return true;
+    if (hasAggregate(*where)) {
+        if (err) *err = "No se permiten funciones de agregado en WHERE.";
+        return false;
+    }
+    *out = cloneExpr(splitSubqueries(where, subConds));
+    return !*out || bindExpr(**out, cols, err);
+}
+
+// Deja en 'targets' las filas que además pasan las subconsultas (IN / EXISTS):
+// las candidatas, con su slot en una columna más, van por los mismos semi /
+// anti joins que en un SELECT
+static bool semiFilter(const DataSnapshot& snap, const ColumnTable& tab, const QVector<SqlColumn>& cols,
+                       const QVector<SqlExprPtr>& subConds, QVector<int>* targets, QString* err)
+{
+    if (subConds.isEmpty() || targets->isEmpty()) return true;
+    QVector<SqlColumn> withSlot = cols;
+    withSlot.push_back({ QString(), QString(), QString() });
+    QVector<Record> rows;
+    rows.reserve(targets->size());
+    for (int slot : std::as_const(*targets)) {
+        Record r = tab.record(slot);
+        r.resize(cols.size());
+        r << slot;
+        rows << r;
+    }
+    SqlOperatorPtr root(new ValuesOp(withSlot, rows));
+    for (const SqlExprPtr& c : subConds)
+        if (!(root = semiJoin(*c, root, cols, snap, err))) return false;
+    targets->clear();
+    root->open();
+    Record r;
+    while (root->next(r)) *targets << r.last().toInt();
+    root->close();
+    if (!root->error().isEmpty()) {
+        if (err) *err = root->error();
+        return false;
+    }
+    return true;
+}
+
+int SqlEngine::execUpdate(const SqlUpdate& q, QString* err)
+{
+    const QString table = resolveTable(q.table.name);
+    const TableId id = m_dm.tableId(table);
+    if (id == kInvalidTableId) {
+        if (err) *err = QString("Tabla '%1' no existe.").arg(q.table.name);
+        return -1;
+    }
+
+    // Como DELETE: se decide sobre un snapshot y se escribe por RowId
+    SqlStatement st;
+    st.kind = SqlStatement::Kind::Update;
+    st.update = q;
+    const DataSnapshot snap = m_dm.snapshot(tablesOf(st));
+    const Schema& s = snap.schema(table);
+    const ColumnTable& tab = snap.columnTable(table);
+
+    QVector<SqlColumn> cols;
+    for (int i = 0; i < qMin(int(s.size()), tab.columnCount()); ++i)
+        cols.push_back({ table, q.table.alias, s[i].name });
+
+    // SET: columna destino + expresión enlazada contra la fila vieja
+    QVector<int> target;
+    QVector<SqlExprPtr> values;
+    for (const SqlAssignment& a : q.set) {
+        int ix = -1;
+        for (int i = 0; i < cols.size(); ++i)
+            if (cols[i].name.compare(a.column, Qt::CaseInsensitive) == 0) { ix = i; break; }
+        if (ix < 0) {
+            if (err) *err = QString("Columna '%1' no existe.").arg(a.column);
+            return -1;
+        }
+        if (target.contains(ix)) {
+            if (err) *err = QString("Columna '%1' asignada más de una vez.").arg(a.column);
+            return -1;
+        }
+        if (hasAggregate(*a.value)) {
+            if (err) *err = "No se permiten funciones de agregado en SET.";
+            return -1;
+        }
+        SqlExprPtr v = cloneExpr(a.value);
+        if (!bindExpr(*v, cols, err)) return -1;
+        target << ix;
+        values << v;
+    }
+
+    SqlExprPtr w;
+    QVector<SqlExprPtr> subConds;
+    if (!bindWhere(q.where, cols, &w, &subConds, err)) return -1;
+    QVector<int> matched = targetSlots(tab, w);
+    if (!semiFilter(snap, tab, cols, subConds, &matched, err)) return -1;
+    if (matched.isEmpty()) return 0;
+
+    // Registros nuevos de todo el conjunto; DataModel los valida juntos y los
+    // escribe en una sola operación (o ninguno)
+    QVector<RowId> ids;
+    QVector<Record> recs;
+    ids.reserve(matched.size());
+    recs.reserve(matched.size());
+    for (int slot : matched) {
+        const Record old = tab.record(slot);
+        Record rec = old;
+        for (int i = 0; i < target.size(); ++i) rec[target[i]] = sqlEval(*values[i], old);
+        ids << tab.rowIdAt(slot);
+        recs << rec;
+    }
+    if (!m_dm.updateRowsById(id, ids, recs, err)) return -1;
+    return matched.size();
+}
+
+int SqlEngine::execDelete(const SqlDelete& q, QString* err)
+{
+    const QString table = resolveTable(q.table.name);
+    const TableId id = m_dm.tableId(table);
+    if (id == kInvalidTableId) {
+        if (err) *err = QString("Tabla '%1' no existe.").arg(q.table.name);
+        return -1;
+    }
+
+    // Se evalúa sobre un snapshot y se borra por RowId: lo que otro escritor
+    // haya borrado entretanto simplemente ya no está. Lleva también las
+    // tablas de las subconsultas del WHERE.
+    SqlStatement st;
+    st.kind = SqlStatement::Kind::Delete;
+    st.del = q;
+    const DataSnapshot snap = m_dm.snapshot(tablesOf(st));
+    const Schema& s = snap.schema(table);
+    const ColumnTable& tab = snap.columnTable(table);
+
+    QVector<SqlColumn> cols;
+    for (int i = 0; i < qMin(int(s.size()), tab.columnCount()); ++i)
+        cols.push_back({ table, q.table.alias, s[i].name });
+
+    SqlExprPtr w;
+    QVector<SqlExprPtr> subConds;
+    if (!bindWhere(q.where, cols, &w, &subConds, err)) return -1;
+    QVector<int> matched = targetSlots(tab, w);
+    if (!semiFilter(snap, tab, cols, subConds, &matched, err)) return -1;
+    QList<RowId> victims;
+    for (int slot : matched) victims << tab.rowIdAt(slot);
+    if (victims.isEmpty()) return 0;
+    if (!m_dm.removeRowsById(id, victims, err)) return -1;
+    return victims.size();
+}
+
+/* ======================= SqlIncrementalView ======================= */
+bool SqlIncrementalView::supports(const SqlSelect& q)
+{
+    bool subqueries = false;
+    forEachSelect(q, [&](const SqlSelect& s) { subqueries = subqueries || &s != &q; });   // o ramas UNION
+    return q.joins.isEmpty() && q.compound.isEmpty() && !q.distinct && q.orderBy.isEmpty()
+        && q.limit < 0 && q.offset == 0 && !q.explain && !subqueries;
+}
+
+bool SqlIncrementalView::build(const SqlSelect& q, const DataSnapshot& snap, QString* err)
+{
+    *this = SqlIncrementalView();
+    if (!supports(q)) {
+        if (err) *err = "La consulta no se puede mantener de forma incremental.";
+        return false;
+    }
+    m_table = matchTable(snap.tables(), q.from.name);
+    if (m_table.isEmpty()) {
+        if (err) *err = QString("Tabla '%1' no existe.").arg(q.from.name);
+        return false;
+    }
+    const Schema& sch = snap.schema(m_table);
+    const ColumnTable& tab = snap.columnTable(m_table);
+    QVector<SqlColumn> cols;
+    for (int i = 0; i < qMin(int(sch.size()), tab.columnCount()); ++i)
+        cols.push_back({ m_table, q.from.alias, sch[i].name });
+
+    if (q.where) {
+        if (hasAggregate(*q.where)) {
+            if (err) *err = "No se permiten funciones de agregado en WHERE (use HAVING).";
+            return false;
+        }
+        m_where = cloneExpr(q.where);
+        if (!bindExpr(*m_where, cols, err)) return false;
+    }
+
+    // Igual que planSelect: con agregados, la salida se evalúa sobre la fila agregada
+    m_aggregate = !q.groupBy.isEmpty() || q.having;
+    for (const SqlSelectItem& it : q.items) m_aggregate = m_aggregate || (!it.star && hasAggregate(*it.expr));
+    AggRewriter agg;
+    agg.input = &cols;
+    for (const SqlExprPtr& g : q.groupBy) {
+        if (hasAggregate(*g)) {
+            if (err) *err = "No se permiten funciones de agregado en GROUP BY.";
+            return false;
+        }
+        SqlExprPtr b = cloneExpr(g);
+        if (!bindExpr(*b, cols, err)) return false;
+        agg.groups << b;
+    }
+    auto post = [&](SqlExprPtr e) { return m_aggregate ? agg.rewrite(e, err) : e; };
+    QHash<QString, int> aliases;
+    if (!outputList(q, cols, post, &m_exprs, &m_names, &aliases, err)) return false;
+    if (q.having) {
+        m_having = cloneExpr(q.having);
+        if (!bindExpr(*m_having, cols, err) || !(m_having = post(m_having))) return false;
+    }
+    m_groups = agg.groups;
+    m_aggs = agg.aggs;
+    QVector<SqlAggFn> fns;
+    for (const SqlExprPtr& a : m_aggs) fns << aggFnOf(*a);
+    m_agg = SqlAggregator(fns);
+    if (m_aggregate && m_groups.isEmpty()) m_agg.ensureGroup();   // sin GROUP BY: una fila siempre
+
+    for (int slot = 0; slot < tab.slotCount(); ++slot)
+        if (tab.isLive(slot)) insertRow(tab.rowIdAt(slot), tab.record(slot));
+    return true;
+}
+
+bool SqlIncrementalView::apply(const QVector<RowChange>& changes)
+{
+    for (const RowChange& c : changes) {
+        switch (c.kind) {
+        case RowChange::Kind::Insert:
+            insertRow(c.row, c.after);
+            break;
+        case RowChange::Kind::Update:
+            if (!removeRow(c.row, c.before)) return false;
+            insertRow(c.row, c.after);
+            break;
+        case RowChange::Kind::Delete:
+            if (!removeRow(c.row, c.before)) return false;
+            break;
+        }
+    }
+    return true;
+}
+
+QVector<Record> SqlIncrementalView::rows() const
+{
+    QVector<Record> out;
+    if (!m_aggregate) {
+        out.reserve(m_rows.size());
+        for (const Record& r : m_rows) out << r;
+        return out;
+    }
+    for (int g = 0; g < m_agg.groupCount(); ++g) {
+        if (!m_groups.isEmpty() && m_agg.groupRows(g) == 0) continue;   // grupo que se vació
+        const Record row = m_agg.groupValues(g) + m_agg.results(g);
+        if (m_having && !sqlIsTrue(sqlEval(*m_having, row))) continue;
+        Record o(m_exprs.size());
+        for (int i = 0; i < m_exprs.size(); ++i) o[i] = sqlEval(*m_exprs[i], row);
+        out << o;
+    }
+    return out;
+}
+
+bool SqlIncrementalView::passes(const Record& row) const
+{
+    return !m_where || sqlIsTrue(sqlEval(*m_where, row));
+}
+
+void SqlIncrementalView::insertRow(RowId id, const Record& row)
+{
+    if (!passes(row)) return;
+    if (!m_aggregate) {
+        Record o(m_exprs.size());
+        for (int i = 0; i < m_exprs.size(); ++i) o[i] = sqlEval(*m_exprs[i], row);
+        m_rows.insert(id, o);
+        return;
+    }
+    Record g(m_groups.size()), args(m_aggs.size());
+    for (int i = 0; i < m_groups.size(); ++i) g[i] = sqlEval(*m_groups[i], row);
+    for (int i = 0; i < m_aggs.size(); ++i)
+        args[i] = m_aggs[i]->args.isEmpty() ? QVariant() : sqlEval(*m_aggs[i]->args[0], row);
+    m_agg.add(g, args);
+}
+
+bool SqlIncrementalView::removeRow(RowId id, const Record& row)
+{
+    if (!m_aggregate) {
+        m_rows.remove(id);
+        return true;
+    }
+    if (!passes(row)) return true;
+    Record g(m_groups.size()), args(m_aggs.size());
+    for (int i = 0; i < m_groups.size(); ++i) g[i] = sqlEval(*m_groups[i], row);
+    for (int i = 0; i < m_aggs.size(); ++i)
+        args[i] = m_aggs[i]->args.isEmpty() ? QVariant() : sqlEval(*m_aggs[i]->args[0], row);
+    return m_agg.remove(g, args);
+}
+
+/* ======================== SqlPreparedQuery ======================== */
+bool SqlPreparedQuery::bind(const QVariantMap& values, SqlSelect* out, QString* err) const
+{
+    const QHash<QString, QVariant> byName = paramsByName(values);
+    for (const QString& n : m_params) {
+        if (!byName.contains(n.toLower())) {
+            if (err) *err = QString("Falta el valor del parámetro '%1'.").arg(n);
+            return false;
+        }
+    }
+    *out = m_select;
+    if (!m_params.isEmpty())
+        forEachExpr(*out, true, [&](SqlExprPtr& e) { e = withParams(e, byName); });
+    return true;
+}
+
+QString SqlPreparedQuery::cacheKey(const QVariantMap& values) const
+{
+    if (m_params.isEmpty()) return m_sql;
+    // Nombre y valor tipado de cada parámetro serializados con QDataStream (los
+    // textos van con su longitud: ningún valor puede imitar el separador de
+    // otro) y en base64, que no tiene espacios ni comillas para normalize()
+    const QHash<QString, QVariant> byName = paramsByName(values);
+    QByteArray bytes;
+    QDataStream out(&bytes, QIODevice::WriteOnly);
+    for (const QString& n : m_params) out << n << paramLiteral(byName.value(n.toLower()));
+    return m_sql + "\n-- params:" + QString::fromLatin1(bytes.toBase64());
+}
+
+QVariant SqlPreparedQuery::parseValue(const QString& text)
+{
+    const QString t = text.trimmed();
+    const QString up = t.toUpper();
+    if (t.isEmpty() || up == "NULL") return {};
+    if (up == "TRUE")  return true;
+    if (up == "FALSE") return false;
+    if (t.size() >= 2 && t.startsWith('\'') && t.endsWith('\''))
+        return t.mid(1, t.size() - 2).replace("''", "'");
+    const QString d = (t.size() >= 2 && t.startsWith('#') && t.endsWith('#')) ? t.mid(1, t.size() - 2).trimmed() : t;
+    const QDate date = QDate::fromString(d, "yyyy-MM-dd");
+    if (date.isValid()) return date;
+    bool ok = false;
+    const qlonglong i = t.toLongLong(&ok);
+    if (ok) return i;
+    const double x = t.toDouble(&ok);
+    if (ok) return x;
+    return t;
+}
@@ -0,0 +1,290 @@
+#ifndef SQLENGINE_H
+#define SQLENGINE_H
+
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QVector>
+#include <QMap>
+#include <QHash>
+#include <QSharedPointer>
+#include <atomic>
+#include <functional>
+
+#include "sqlparser.h"
+#include "sqlpredicate.h"
+#include "datamodel.h"
+
+/* ========================= Plan físico ========================= */
+// Columna de salida de un operador (para enlazar Tabla.Columna por ordinal)
+struct SqlColumn {
+    QString table;   // nombre real de la tabla (vacío si es calculada)
+    QString alias;   // alias de la tabla en la consulta (vacío => table)
+    QString name;
+};
+
+// Operador estilo iterador (open/next/close): cada next() produce una fila,
+// así el resultado fluye sin materializarse salvo donde hace falta (Sort).
+class SqlOperator {
+public:
+    virtual ~SqlOperator() = default;
+
+    virtual void open() = 0;
+    virtual bool next(Record& row) = 0;    // false al terminar
+    virtual void close() {}
+    virtual QString describe() const = 0;  // una línea para EXPLAIN
+
+    const QVector<SqlColumn>& columns() const { return m_columns; }
+    const QVector<QSharedPointer<SqlOperator>>& children() const { return m_children; }
+
+    // Para EXPLAIN ANALYZE: filas que el plan espera producir (-1 = sin
+    // estimación) y memoria retenida por el operador (aprox., el máximo de la
+    // ejecución; solo los que materializan: Sort, hash join, agregación...)
+    virtual qint64 estimatedRows() const { return -1; }
+    qint64 memoryBytes() const { return m_memBytes; }
+
+    // Reemplaza cada hijo por f(hijo) (EXPLAIN ANALYZE los envuelve para medir)
+    void wrapChildren(const std::function<QSharedPointer<SqlOperator>(const QSharedPointer<SqlOperator>&)>& f) {
+        for (auto& c : m_children) c = f(c);
+    }
+
+    // Bandera de cancelación de todo el árbol (la mira el scan: al activarse
+    // deja de entregar filas y los operadores de arriba terminan enseguida)
+    void setCancelFlag(const std::atomic<bool>* flag) {
+        m_cancel = flag;
+        for (const auto& c : m_children) c->setCancelFlag(flag);
+    }
+
+    // Error de ejecución del árbol (p. ej. no se pudo escribir a disco), vacío
+    // si no hubo: el operador que falla deja de entregar filas, así que quien
+    // recorre el plan lo mira al terminar
+    QString error() const {
+        if (!m_error.isEmpty()) return m_error;
+        for (const auto& c : m_children) {
+            const QString e = c->error();
+            if (!e.isEmpty()) return e;
+        }
+        return {};
+    }
+
+protected:
+    bool cancelled() const { return m_cancel && m_cancel->load(std::memory_order_relaxed); }
+    bool fail(const QString& err) { m_error = err; return false; }
+
+    QVector<SqlColumn>                   m_columns;
+    QVector<QSharedPointer<SqlOperator>> m_children;
+    const std::atomic<bool>*             m_cancel = nullptr;
+    qint64                               m_memBytes = 0;
+    QString                              m_error;
+};
+using SqlOperatorPtr = QSharedPointer<SqlOperator>;
+
+/* ========================= Agregación ========================= */
+enum class SqlAggFn { Count, CountAll, Sum, Avg, Min, Max };
+
+// Agregación por hash con acumuladores tipados: cada fila aporta sus valores
+// de agrupación y un argumento por función (ignorado en CountAll). Las sumas
+// de enteros se mantienen enteras mientras no desborden. Dos agregadores con
+// las mismas funciones se combinan con merge() (parciales por hilo). Los
+// grupos quedan en orden de primera aparición. remove() descuenta una fila ya
+// agregada (mantenimiento incremental); un grupo que queda sin filas sigue en
+// su lugar con groupRows() == 0.
+class SqlAggregator {
+public:
+    explicit SqlAggregator(QVector<SqlAggFn> fns = {}) : m_fns(std::move(fns)) {}
+
+    void add(const Record& groupValues, const Record& args);
+    // Camino por código de diccionario (GROUP BY de una columna codificada):
+    // groupOfCode da -1 si el código aún no tiene grupo; bindCode lo resuelve
+    // una vez con los valores de la fila y addTo suma directo al grupo
+    int  groupOf(const Record& values);
+    int  groupOfCode(qint32 code) const;
+    int  bindCode(qint32 code, const Record& groupValues);
+    void addTo(int group, const Record& args);
+    // false si el resultado ya no se puede deducir (se quitó el MIN/MAX vigente
+    // de un grupo, o la fila no estaba): hay que volver a agregar todo
+    bool remove(const Record& groupValues, const Record& args);
+    void merge(const SqlAggregator& other);
+    void ensureGroup(const Record& groupValues = {});   // sin GROUP BY: un grupo aunque no haya filas
+
+    int           groupCount() const { return m_groups.size(); }
+    const Record& groupValues(int g) const { return m_groups[g].values; }
+    qint64        groupRows(int g) const { return m_groups[g].rows; }
+    Record        results(int g) const;                 // un valor por función
+
+private:
+    struct Acc {
+        qint64   count = 0;       // valores no nulos (filas en CountAll)
+        qint64   isum = 0;
+        double   dsum = 0;
+        bool     intSum = true;   // todo lo sumado era entero y cabe en isum
+        QVariant best;            // Min / Max
+    };
+    struct Group {
+        Record       values;
+        QVector<Acc> accs;
+        qint64       rows = 0;    // filas de entrada
+    };
+    void addValue(Acc& a, SqlAggFn fn, const QVariant& v) const;
+    bool removeValue(Acc& a, SqlAggFn fn, const QVariant& v) const;
+    void mergeAcc(Acc& a, SqlAggFn fn, const Acc& b) const;
+
+    QVector<SqlAggFn>   m_fns;
+    QVector<Group>      m_groups;
+    QHash<SqlKey, int>  m_index;
+    QVector<int>        m_byCode;   // código de diccionario -> grupo (-1 sin resolver)
+};
+
+/* =========================== Cursor =========================== */
+// Resultado de un SELECT recorrido fila a fila. Mantiene vivo el snapshot del
+// que lee, así que puede consumirse sin prisa (y desde otro hilo). Las copias
+// comparten la posición: se itera con una sola. cancel() se puede llamar
+// desde cualquier hilo mientras otro itera: next() devuelve false en breve.
+class SqlCursor {
+public:
+    SqlCursor() = default;
+
+    bool isValid() const { return !m_root.isNull(); }
+    const QStringList& columnNames() const { return m_names; }
+    int  columnCount() const { return m_names.size(); }
+
+    bool next();                                 // avanza; false al terminar
+    const Record& row() const { return m_row; }
+    QVariant value(int col) const { return m_row.value(col); }
+    QMap<QString, QVariant> rowMap() const;      // fila actual por nombre de columna
+
+    void close();
+    void cancel();
+    bool isCancelled() const;
+    QString error() const;                       // tras next() == false: vacío si terminó bien
+    const SqlOperatorPtr& plan() const { return m_root; }
+
+private:
+    friend class SqlEngine;
+    SqlOperatorPtr m_root;
+    QSharedPointer<std::atomic<bool>> m_cancel;
+    DataSnapshot   m_snap;
+    QStringList    m_names;
+    Record         m_row;
+    bool           m_open = false;
+    bool           m_done = false;
+};
+
+/* ======================= Vista incremental ======================= */
+// Resultado de un SELECT que se mantiene al día con los cambios fila a fila
+// de su tabla (DataModel::rowsModified) en vez de recalcularse. Cubre filtro
+// y proyección sobre una tabla y, con GROUP BY o agregados, COUNT/SUM/AVG
+// siempre y MIN/MAX mientras no se quite el valor vigente de un grupo. Sin
+// JOIN, DISTINCT, UNION..., ORDER BY ni LIMIT (supports() da false).
+class SqlIncrementalView {
+public:
+    static bool supports(const SqlSelect& q);
+
+    // Enlaza la consulta y la calcula entera sobre el snapshot
+    bool build(const SqlSelect& q, const DataSnapshot& snap, QString* err = nullptr);
+    // false si algún cambio no se puede aplicar: hay que volver a build()
+    bool apply(const QVector<RowChange>& changes);
+
+    const QString&     table() const { return m_table; }
+    const QStringList& columnNames() const { return m_names; }
+    QVector<Record>    rows() const;
+
+private:
+    bool passes(const Record& row) const;
+    void insertRow(RowId id, const Record& row);
+    bool removeRow(RowId id, const Record& row);
+
+    QString             m_table;
+    QStringList         m_names;
+    SqlExprPtr          m_where;       // sobre la fila de la tabla
+    QVector<SqlExprPtr> m_exprs;       // sobre la fila de la tabla o la agregada
+    bool                m_aggregate = false;
+    QVector<SqlExprPtr> m_groups, m_aggs;
+    SqlExprPtr          m_having;      // sobre la fila agregada
+    SqlAggregator       m_agg;
+    QMap<RowId, Record> m_rows;        // sin agregados: fila de salida por id
+};
+
+/* ======================= Consulta preparada ======================= */
+// SELECT analizado y resuelto una sola vez (SqlEngine::prepare), con sus
+// parámetros: :nombre, o [Nombre] que no es columna de ninguna tabla. Cada
+// ejecución trae sus valores (por nombre, sin distinguir mayúsculas), que
+// entran al plan como literales: el árbol de operadores se arma sobre el
+// snapshot de esa ejecución (lee sus columnas y guarda el estado de la
+// iteración), y con valores concretos el planificador elige índices, compila
+// LIKE y arma los conjuntos de IN igual que con el SQL escrito a mano.
+class SqlPreparedQuery {
+public:
+    const QString&     sql() const { return m_sql; }
+    const SqlSelect&   select() const { return m_select; }
+    const QStringList& parameters() const { return m_params; }   // en orden de aparición
+    const QStringList& tables() const { return m_tables; }
+
+    // Copia del SELECT con los valores en lugar de los parámetros (false si falta alguno)
+    bool bind(const QVariantMap& values, SqlSelect* out, QString* err = nullptr) const;
+    // Clave para SqlResultCache: el SQL más los valores usados (nombre y valor
+    // tipado de cada uno, codificados sin ambigüedad)
+    QString cacheKey(const QVariantMap& values) const;
+
+    // Valor tecleado por el usuario, como lo leería el SQL: número, fecha
+    // (yyyy-MM-dd o #yyyy-MM-dd#), TRUE/FALSE, NULL o, si no, texto
+    static QVariant parseValue(const QString& text);
+
+private:
+    friend class SqlEngine;
+    QString     m_sql;
+    SqlSelect   m_select;      // con nodos Param
+    QStringList m_params;
+    QStringList m_tables;
+};
+using SqlPreparedPtr = QSharedPointer<const SqlPreparedQuery>;
+
+/* =========================== Motor =========================== */
+class SqlEngine {
+public:
+    explicit SqlEngine(DataModel& dm = DataModel::instance()) : m_dm(dm) {}
+
+    // SELECT sobre un snapshot de las tablas que usa (o sobre uno dado)
+    bool query(const QString& sql, SqlCursor* out, QString* err = nullptr) const;
+    bool query(const QString& sql, const DataSnapshot& snap, SqlCursor* out, QString* err = nullptr) const;
+    bool query(const SqlSelect& q, const DataSnapshot& snap, SqlCursor* out, QString* err = nullptr) const;
+
+    // SELECT con parámetros: se analiza y resuelve contra el esquema actual
+    // (y se comprueba que se pueda planificar) una vez; luego se ejecuta con
+    // los valores de cada vez
+    bool prepare(const QString& sql, SqlPreparedQuery* out, QString* err = nullptr) const;
+    bool query(const SqlPreparedQuery& p, const QVariantMap& params, SqlCursor* out,
+               QString* err = nullptr) const;
+    bool query(const SqlPreparedQuery& p, const QVariantMap& params, const DataSnapshot& snap,
+               SqlCursor* out, QString* err = nullptr) const;
+
+    // INSERT / UPDATE / DELETE sobre el DataModel: filas afectadas, -1 si falla.
+    // UPDATE y DELETE buscan las filas con el planificador y las cambian en
+    // bloque (todo o nada, una notificación por tabla).
+    int execute(const QString& sql, QString* err = nullptr);
+    int execute(const SqlStatement& st, QString* err = nullptr);
+
+    // Tablas que lee la sentencia, con el nombre real (sin distinguir mayúsculas)
+    QStringList tablesOf(const SqlStatement& st) const;
+    // Nombre real de una tabla del modelo (vacío si no existe)
+    QString resolveTable(const QString& raw) const;
+
+    // Hilos con que se filtran las tablas grandes (por tramos de slots, en el
+    // pool del motor). 0 = uno por núcleo; 1 = sin paralelismo.
+    static void setScanParallelism(int threads);
+    static int  scanParallelism();
+
+    // Memoria (aprox., en bytes) que puede ocupar cada conjunto hash de
+    // DISTINCT / UNION / INTERSECT / EXCEPT antes de pasar a disco
+    static void   setSpillBudget(qint64 bytes);
+    static qint64 spillBudget();
+
+private:
+    int execInsert(const SqlInsert& q, QString* err);
+    int execUpdate(const SqlUpdate& q, QString* err);
+    int execDelete(const SqlDelete& q, QString* err);
+
+    DataModel& m_dm;
+};
+
+#endif // SQLENGINE_H
@@ -0,0 +1,635 @@
+#include "sqlparser.h"
+
+#include <QDate>
+
+/* ============================== Léxico ============================== */
+namespace {
+
+struct Token {
+    enum Type { End, Ident, Keyword, Number, String, Date, Symbol, Param };
+    Type     type = End;
+    QString  text;      // Keyword en mayúsculas; Ident sin delimitadores; Param sin ':'
+    bool     bracket = false;   // Ident escrito como [..]
+    QVariant value;     // Number/String/Date
+    int      pos = 0;   // offset en el texto fuente
+    int      end = 0;
+};
+
+const QStringList& keywords()
+{
+    static const QStringList kw = {
+        "SELECT","FROM","WHERE","AND","OR","NOT","ORDER","BY","ASC","DESC",
+        "LIMIT","OFFSET","AS","INSERT","INTO","VALUES","DELETE","NULL","IS",
+        "TRUE","FALSE","BETWEEN","IN","LIKE","EXPLAIN",
+        "JOIN","INNER","LEFT","OUTER","ON","GROUP","HAVING",
+        "DISTINCT","ALL","UNION","INTERSECT","EXCEPT","ANALYZE","UPDATE","SET",
+        "EXISTS"
+    };
+    return kw;
+}
+
+bool isIdentStart(QChar c) { return c.isLetter() || c == '_'; }
+bool isIdentChar(QChar c)  { return c.isLetterOrNumber() || c == '_'; }
+
+// yyyy-MM-dd a partir de i (sin comillas): 4 dígitos, '-', 2 dígitos, '-', 2 dígitos
+bool bareDateAt(const QString& s, int i, QDate* out)
+{
+    if (i + 10 > s.size()) return false;
+    static const char* shape = "dddd-dd-dd";
+    for (int k = 0; k < 10; ++k) {
+        const QChar c = s[i + k];
+        if (shape[k] == 'd' ? !c.isDigit() : c != '-') return false;
+    }
+    if (i + 10 < s.size() && isIdentChar(s[i + 10])) return false;
+    const QDate d = QDate::fromString(s.mid(i, 10), "yyyy-MM-dd");
+    if (!d.isValid()) return false;
+    *out = d;
+    return true;
+}
+
+bool tokenize(const QString& s, QVector<Token>* out, QString* err)
+{
+    int i = 0;
+    const int n = s.size();
+    while (i < n) {
+        const QChar c = s[i];
+        if (c.isSpace()) { ++i; continue; }
+
+        // Comentarios de línea
+        if (c == '-' && i + 1 < n && s[i + 1] == '-') {
+            while (i < n && s[i] != '\n') ++i;
+            continue;
+        }
+
+        Token t; t.pos = i;
+
+        if (c == '\'') {                              // 'texto' ('' escapa)
+            QString v; ++i;
+            bool closed = false;
+            while (i < n) {
+                if (s[i] == '\'') {
+                    if (i + 1 < n && s[i + 1] == '\'') { v += '\''; i += 2; continue; }
+                    ++i; closed = true; break;
+                }
+                v += s[i++];
+            }
+            if (!closed) { if (err) *err = QString("Cadena sin cerrar en la posición %1.").arg(t.pos + 1); return false; }
+            t.type = Token::String; t.value = v; t.text = v;
+        }
+        else if (c == '[' || c == '"' || c == '`') { // identificador delimitado
+            const QChar close = (c == '[') ? QChar(']') : c;
+            const int j = s.indexOf(close, i + 1);
+            if (j < 0) { if (err) *err = QString("Identificador sin cerrar en la posición %1.").arg(i + 1); return false; }
+            t.type = Token::Ident; t.text = s.mid(i + 1, j - i - 1);
+            t.bracket = (c == '[');
+            i = j + 1;
+        }
+        else if (c == ':' && i + 1 < n && isIdentStart(s[i + 1])) {   // :parámetro
+            int j = i + 1;
+            while (j < n && isIdentChar(s[j])) ++j;
+            t.type = Token::Param; t.text = s.mid(i + 1, j - i - 1);
+            i = j;
+        }
+        else if (c == '#') {                          // #fecha# (estilo Access)
+            const int j = s.indexOf('#', i + 1);
+            const QDate d = (j < 0) ? QDate() : QDate::fromString(s.mid(i + 1, j - i - 1).trimmed(), "yyyy-MM-dd");
+            if (!d.isValid()) { if (err) *err = QString("Fecha inválida en la posición %1.").arg(i + 1); return false; }
+            t.type = Token::Date; t.value = d; t.text = s.mid(i, j - i + 1);
+            i = j + 1;
+        }
+        else if (c.isDigit() || (c == '.' && i + 1 < n && s[i + 1].isDigit())) {
+            QDate d;
+            if (bareDateAt(s, i, &d)) {
+                t.type = Token::Date; t.value = d; t.text = s.mid(i, 10);
+                i += 10;
+            } else {
+                int j = i;
+                bool dot = false;
+                while (j < n && (s[j].isDigit() || (s[j] == '.' && !dot))) { if (s[j] == '.') dot = true; ++j; }
+                t.text = s.mid(i, j - i);
+                bool ok = false;
+                if (!dot) { const qlonglong v = t.text.toLongLong(&ok); if (ok) t.value = v; }
+                if (!ok)  t.value = t.text.toDouble(&ok);
+                t.type = Token::Number;
+                i = j;
+            }
+        }
+        else if (isIdentStart(c)) {
+            int j = i;
+            while (j < n && isIdentChar(s[j])) ++j;
+            t.text = s.mid(i, j - i);
+            const QString up = t.text.toUpper();
+            if (keywords().contains(up)) { t.type = Token::Keyword; t.text = up; }
+            else                           t.type = Token::Ident;
+            i = j;
+        }
+        else {
+            static const QStringList two = { "<=", ">=", "<>", "!=", "==" };
+            const QString pair = s.mid(i, 2);
+            if (two.contains(pair)) {
+                t.text = (pair == "!=") ? QString("<>") : (pair == "==") ? QString("=") : pair;
+                i += 2;
+            } else if (QString("=<>(),.*+-/;").contains(c)) {
+                t.text = QString(c);
+                ++i;
+            } else {
+                if (err) *err = QString("Carácter inesperado '%1' en la posición %2.").arg(c).arg(i + 1);
+                return false;
+            }
+            t.type = Token::Symbol;
+        }
+        t.end = i;
+        out->push_back(t);
+    }
+    Token e; e.type = Token::End; e.pos = e.end = n;
+    out->push_back(e);
+    return true;
+}
+
+/* ========================= Descenso recursivo ========================= */
+class Parser {
+public:
+    Parser(const QString& src, QVector<Token> toks) : m_src(src), m_t(std::move(toks)) {}
+
+    bool statement(SqlStatement* st)
+    {
+        if (acceptKw("EXPLAIN")) {
+            st->select.analyze = acceptKw("ANALYZE");
+            if (!isKw("SELECT")) return fail("EXPLAIN solo admite SELECT");
+            st->select.explain = true;
+        }
+        if (isKw("SELECT"))      { st->kind = SqlStatement::Kind::Select; if (!select(&st->select)) return false; }
+        else if (isKw("INSERT")) { st->kind = SqlStatement::Kind::Insert; if (!insert(&st->insert)) return false; }
+        else if (isKw("UPDATE")) { st->kind = SqlStatement::Kind::Update; if (!update(&st->update)) return false; }
+        else if (isKw("DELETE")) { st->kind = SqlStatement::Kind::Delete; if (!del(&st->del)) return false; }
+        else return fail("Se esperaba SELECT, INSERT, UPDATE o DELETE");
+        acceptSym(";");
+        if (cur().type != Token::End) return fail("Texto inesperado al final de la sentencia");
+        return true;
+    }
+
+    QString error() const { return m_err; }
+
+private:
+    const QString& m_src;
+    QVector<Token> m_t;
+    int            m_i = 0;
+    QString        m_err;
+
+    const Token& cur() const { return m_t[m_i]; }
+    const Token& peek(int k = 1) const { return m_t[qMin(m_i + k, int(m_t.size()) - 1)]; }
+    bool isKw(const char* k) const  { return cur().type == Token::Keyword && cur().text == QLatin1String(k); }
+    bool isSym(const char* s) const { return cur().type == Token::Symbol  && cur().text == QLatin1String(s); }
+    bool acceptKw(const char* k)  { if (isKw(k))  { ++m_i; return true; } return false; }
+    bool acceptSym(const char* s) { if (isSym(s)) { ++m_i; return true; } return false; }
+
+    bool fail(const QString& what)
+    {
+        if (m_err.isEmpty()) {
+            const Token& t = cur();
+            m_err = (t.type == Token::End)
+                ? QString("%1 (fin de la sentencia).").arg(what)
+                : QString("%1 cerca de '%2' (posición %3).").arg(what, m_src.mid(t.pos, t.end - t.pos)).arg(t.pos + 1);
+        }
+        return false;
+    }
+    bool expectKw(const char* k)  { return acceptKw(k)  || fail(QString("Se esperaba %1").arg(QLatin1String(k))); }
+    bool expectSym(const char* s) { return acceptSym(s) || fail(QString("Se esperaba '%1'").arg(QLatin1String(s))); }
+
+    bool ident(QString* out)
+    {
+        if (cur().type != Token::Ident) return fail("Se esperaba un identificador");
+        *out = cur().text; ++m_i;
+        return true;
+    }
+
+    bool integer(qint64* out)
+    {
+        if (cur().type != Token::Number || cur().value.typeId() != QMetaType::LongLong)
+            return fail("Se esperaba un entero");
+        *out = cur().value.toLongLong(); ++m_i;
+        return true;
+    }
+
+    SqlExprPtr finish(const SqlExprPtr& e, int startTok)
+    {
+        const int from = m_t[startTok].pos;
+        const int to   = m_t[qMax(startTok, m_i - 1)].end;
+        e->text = m_src.mid(from, to - from).trimmed();
+        return e;
+    }
+
+    bool tableRef(SqlTableRef* out)
+    {
+        if (!ident(&out->name)) return false;
+        if (acceptKw("AS")) return ident(&out->alias);
+        if (cur().type == Token::Ident) out->alias = m_t[m_i++].text;
+        return true;
+    }
+
+    /* ----- Sentencias ----- */
+    // SELECT [DISTINCT] ... FROM ... [JOIN] [WHERE] [GROUP BY] [HAVING]
+    bool selectCore(SqlSelect* q)
+    {
+        if (!expectKw("SELECT")) return false;
+        if (acceptKw("DISTINCT")) q->distinct = true;
+        else acceptKw("ALL");
+        do {
+            SqlSelectItem it;
+            if (acceptSym("*")) { it.star = true; }
+            else if (cur().type == Token::Ident && peek().type == Token::Symbol && peek().text == "."
+                     && peek(2).type == Token::Symbol && peek(2).text == "*") {
+                it.star = true; it.starTable = cur().text; m_i += 3;
+            } else {
+                if (!(it.expr = expr())) return false;
+                if (acceptKw("AS")) { if (!ident(&it.alias)) return false; }
+                else if (cur().type == Token::Ident) it.alias = m_t[m_i++].text;
+            }
+            q->items.push_back(it);
+        } while (acceptSym(","));
+
+        if (!expectKw("FROM") || !tableRef(&q->from)) return false;
+        for (;;) {
+            SqlJoin j;
+            if (acceptKw("LEFT")) {
+                acceptKw("OUTER");
+                j.kind = SqlJoin::Kind::Left;
+                if (!expectKw("JOIN")) return false;
+            } else if (acceptKw("INNER")) {
+                if (!expectKw("JOIN")) return false;
+            } else if (!acceptKw("JOIN")) {
+                break;
+            }
+            if (!tableRef(&j.table) || !expectKw("ON") || !(j.on = expr())) return false;
+            q->joins.push_back(j);
+        }
+        if (acceptKw("WHERE") && !(q->where = expr())) return false;
+        if (acceptKw("GROUP")) {
+            if (!expectKw("BY")) return false;
+            do {
+                SqlExprPtr g = expr();
+                if (!g) return false;
+                q->groupBy.push_back(g);
+            } while (acceptSym(","));
+        }
+        if (acceptKw("HAVING") && !(q->having = expr())) return false;
+        return true;
+    }
+
+    bool select(SqlSelect* q)
+    {
+        if (!selectCore(q)) return false;
+        for (;;) {
+            SqlSetOp op;
+            if (acceptKw("UNION"))
+                op.kind = acceptKw("ALL") ? SqlSetOp::Kind::UnionAll : SqlSetOp::Kind::Union;
+            else if (acceptKw("INTERSECT")) op.kind = SqlSetOp::Kind::Intersect;
+            else if (acceptKw("EXCEPT"))    op.kind = SqlSetOp::Kind::Except;
+            else break;
+            op.select = QSharedPointer<SqlSelect>::create();
+            if (!selectCore(op.select.data())) return false;
+            q->compound.push_back(op);
+        }
+
+        if (acceptKw("ORDER")) {
+            if (!expectKw("BY")) return false;
+            do {
+                SqlOrderItem o;
+                if (!(o.expr = expr())) return false;
+                if (acceptKw("DESC")) o.desc = true; else acceptKw("ASC");
+                q->orderBy.push_back(o);
+            } while (acceptSym(","));
+        }
+        if (acceptKw("LIMIT")) {
+            if (!integer(&q->limit)) return false;
+            if (acceptKw("OFFSET")) {
+                if (!integer(&q->offset)) return false;
+            } else if (acceptSym(",")) {            // LIMIT desplazamiento, cantidad
+                q->offset = q->limit;
+                if (!integer(&q->limit)) return false;
+            }
+        }
+        return true;
+    }
+
+    bool insert(SqlInsert* q)
+    {
+        expectKw("INSERT");
+        if (!expectKw("INTO") || !ident(&q->table)) return false;
+        if (acceptSym("(")) {
+            do { QString c; if (!ident(&c)) return false; q->columns << c; } while (acceptSym(","));
+            if (!expectSym(")")) return false;
+        }
+        if (!expectKw("VALUES")) return false;
+        do {
+            if (!expectSym("(")) return false;
+            QVector<SqlExprPtr> row;
+            do { SqlExprPtr e = expr(); if (!e) return false; row.push_back(e); } while (acceptSym(","));
+            if (!expectSym(")")) return false;
+            q->rows.push_back(row);
+        } while (acceptSym(","));
+        return true;
+    }
+
+    bool update(SqlUpdate* q)
+    {
+        expectKw("UPDATE");
+        if (!tableRef(&q->table) || !expectKw("SET")) return false;
+        do {
+            SqlAssignment a;
+            if (!ident(&a.column)) return false;
+            if (acceptSym(".") && !ident(&a.column)) return false;   // Tabla.Columna
+            if (!expectSym("=") || !(a.value = expr())) return false;
+            q->set.push_back(a);
+        } while (acceptSym(","));
+        if (acceptKw("WHERE") && !(q->where = expr())) return false;
+        return true;
+    }
+
+    bool del(SqlDelete* q)
+    {
+        expectKw("DELETE");
+        if (!expectKw("FROM") || !tableRef(&q->table)) return false;
+        if (acceptKw("WHERE") && !(q->where = expr())) return false;
+        return true;
+    }
+
+    // SELECT de IN (...) / EXISTS (...), sin los paréntesis
+    QSharedPointer<SqlSelect> subquery()
+    {
+        auto q = QSharedPointer<SqlSelect>::create();
+        if (!select(q.data())) return {};
+        return q;
+    }
+
+    /* ----- Expresiones (de menor a mayor precedencia) ----- */
+    SqlExprPtr expr() { return orExpr(); }
+
+    SqlExprPtr orExpr()
+    {
+        const int s = m_i;
+        SqlExprPtr l = andExpr();
+        while (l && acceptKw("OR")) {
+            SqlExprPtr r = andExpr();
+            if (!r) return {};
+            l = finish(SqlExpr::binary("OR", l, r), s);
+        }
+        return l;
+    }
+
+    SqlExprPtr andExpr()
+    {
+        const int s = m_i;
+        SqlExprPtr l = notExpr();
+        while (l && acceptKw("AND")) {
+            SqlExprPtr r = notExpr();
+            if (!r) return {};
+            l = finish(SqlExpr::binary("AND", l, r), s);
+        }
+        return l;
+    }
+
+    SqlExprPtr notExpr()
+    {
+        const int s = m_i;
+        if (acceptKw("NOT")) {
+            SqlExprPtr a = notExpr();
+            if (!a) return {};
+            // NOT EXISTS / NOT x IN (SELECT ...) quedan en el nodo (anti join)
+            if (a->kind == SqlExpr::Kind::Exists || a->kind == SqlExpr::Kind::InSelect) {
+                a->negated = !a->negated;
+                return finish(a, s);
+            }
+            auto e = SqlExprPtr::create();
+            e->kind = SqlExpr::Kind::Unary; e->op = "NOT"; e->args << a;
+            return finish(e, s);
+        }
+        return predicate();
+    }
+
+    SqlExprPtr predicate()
+    {
+        const int s = m_i;
+        SqlExprPtr l = additive();
+        if (!l) return {};
+
+        if (cur().type == Token::Symbol) {
+            static const QStringList cmp = { "=", "<>", "<", "<=", ">", ">=" };
+            if (cmp.contains(cur().text)) {
+                const QString op = m_t[m_i++].text;
+                SqlExprPtr r = additive();
+                if (!r) return {};
+                return finish(SqlExpr::binary(op, l, r), s);
+            }
+            return l;
+        }
+
+        if (acceptKw("IS")) {
+            auto e = SqlExprPtr::create();
+            e->kind = SqlExpr::Kind::IsNull;
+            e->negated = acceptKw("NOT");
+            if (!expectKw("NULL")) return {};
+            e->args << l;
+            return finish(e, s);
+        }
+
+        const bool neg = isKw("NOT") && peek().type == Token::Keyword
+                         && (peek().text == "BETWEEN" || peek().text == "IN" || peek().text == "LIKE");
+        if (neg) ++m_i;
+
+        if (acceptKw("BETWEEN")) {
+            auto e = SqlExprPtr::create();
+            e->kind = SqlExpr::Kind::Between; e->negated = neg;
+            SqlExprPtr lo = additive();
+            if (!lo || !expectKw("AND")) return {};
+            SqlExprPtr hi = additive();
+            if (!hi) return {};
+            e->args << l << lo << hi;
+            return finish(e, s);
+        }
+        if (acceptKw("IN")) {
+            auto e = SqlExprPtr::create();
+            e->negated = neg;
+            e->args << l;
+            if (!expectSym("(")) return {};
+            if (isKw("SELECT")) {
+                e->kind = SqlExpr::Kind::InSelect;
+                if (!(e->subquery = subquery())) return {};
+            } else {
+                e->kind = SqlExpr::Kind::InList;
+                do { SqlExprPtr v = additive(); if (!v) return {}; e->args << v; } while (acceptSym(","));
+            }
+            if (!expectSym(")")) return {};
+            return finish(e, s);
+        }
+        if (acceptKw("LIKE")) {
+            auto e = SqlExprPtr::create();
+            e->kind = SqlExpr::Kind::Like; e->negated = neg;
+            SqlExprPtr p = additive();
+            if (!p) return {};
+            e->args << l << p;
+            return finish(e, s);
+        }
+        if (neg) { fail("Se esperaba BETWEEN, IN o LIKE"); return {}; }
+        return l;
+    }
+
+    SqlExprPtr additive()
+    {
+        const int s = m_i;
+        SqlExprPtr l = multiplicative();
+        while (l && (isSym("+") || isSym("-"))) {
+            const QString op = m_t[m_i++].text;
+            SqlExprPtr r = multiplicative();
+            if (!r) return {};
+            l = finish(SqlExpr::binary(op, l, r), s);
+        }
+        return l;
+    }
+
+    SqlExprPtr multiplicative()
+    {
+        const int s = m_i;
+        SqlExprPtr l = unary();
+        while (l && (isSym("*") || isSym("/"))) {
+            const QString op = m_t[m_i++].text;
+            SqlExprPtr r = unary();
+            if (!r) return {};
+            l = finish(SqlExpr::binary(op, l, r), s);
+        }
+        return l;
+    }
+
+    SqlExprPtr unary()
+    {
+        const int s = m_i;
+        if (acceptSym("-")) {
+            SqlExprPtr a = unary();
+            if (!a) return {};
+            if (a->kind == SqlExpr::Kind::Literal && (a->value.typeId() == QMetaType::LongLong
+                                                      || a->value.typeId() == QMetaType::Double)) {
+                a->value = (a->value.typeId() == QMetaType::LongLong) ? QVariant(-a->value.toLongLong())
+                                                                       : QVariant(-a->value.toDouble());
+                return finish(a, s);
+            }
+            auto e = SqlExprPtr::create();
+            e->kind = SqlExpr::Kind::Unary; e->op = "-"; e->args << a;
+            return finish(e, s);
+        }
+        acceptSym("+");
+        return primary();
+    }
+
+    SqlExprPtr primary()
+    {
+        const int s = m_i;
+        const Token& t = cur();
+        switch (t.type) {
+        case Token::Number:
+        case Token::String:
+        case Token::Date:
+            ++m_i;
+            return finish(SqlExpr::literal(t.value), s);
+        case Token::Keyword:
+            if (acceptKw("NULL"))  return finish(SqlExpr::literal(QVariant()), s);
+            if (acceptKw("TRUE"))  return finish(SqlExpr::literal(true), s);
+            if (acceptKw("FALSE")) return finish(SqlExpr::literal(false), s);
+            if (acceptKw("EXISTS")) {
+                auto e = SqlExprPtr::create();
+                e->kind = SqlExpr::Kind::Exists;
+                if (!expectSym("(") || !(e->subquery = subquery()) || !expectSym(")")) return {};
+                return finish(e, s);
+            }
+            break;
+        case Token::Param: {
+            auto e = SqlExprPtr::create();
+            e->kind = SqlExpr::Kind::Param; e->name = t.text;
+            ++m_i;
+            return finish(e, s);
+        }
+        case Token::Ident: {
+            QString a = t.text;
+            const bool bracket = t.bracket;
+            ++m_i;
+            static const QStringList aggs = { "COUNT", "SUM", "AVG", "MIN", "MAX" };
+            if (isSym("(") && aggs.contains(a.toUpper())) {   // función de agregado
+                ++m_i;
+                auto e = SqlExprPtr::create();
+                e->kind = SqlExpr::Kind::Aggregate;
+                e->op = a.toUpper();
+                if (!(e->op == "COUNT" && acceptSym("*"))) {
+                    SqlExprPtr arg = expr();
+                    if (!arg) return {};
+                    e->args << arg;
+                }
+                if (!expectSym(")")) return {};
+                return finish(e, s);
+            }
+            if (acceptSym(".")) {
+                QString b;
+                if (!ident(&b)) return {};
+                return finish(SqlExpr::column(a, b), s);
+            }
+            SqlExprPtr c = SqlExpr::column(QString(), a);
+            c->quoted = bracket;
+            return finish(c, s);
+        }
+        case Token::Symbol:
+            if (acceptSym("(")) {
+                SqlExprPtr e = expr();
+                if (!e || !expectSym(")")) return {};
+                return e;
+            }
+            break;
+        case Token::End:
+            break;
+        }
+        fail("Se esperaba una expresión");
+        return {};
+    }
+};
+
+} // namespace
+
+/* ============================ SqlExpr ============================ */
+SqlExprPtr SqlExpr::literal(const QVariant& v)
+{
+    auto e = SqlExprPtr::create();
+    e->kind = Kind::Literal; e->value = v;
+    return e;
+}
+
+SqlExprPtr SqlExpr::column(const QString& table, const QString& name)
+{
+    auto e = SqlExprPtr::create();
+    e->kind = Kind::Column; e->table = table; e->name = name;
+    return e;
+}
+
+SqlExprPtr SqlExpr::binary(const QString& op, const SqlExprPtr& l, const SqlExprPtr& r)
+{
+    auto e = SqlExprPtr::create();
+    e->kind = Kind::Binary; e->op = op; e->args << l << r;
+    return e;
+}
+
+/* ============================ SqlParser ============================ */
+bool SqlParser::parse(const QString& sql, SqlStatement* out, QString* err)
+{
+    QVector<Token> toks;
+    if (!tokenize(sql, &toks, err)) return false;
+    if (toks.size() == 1) { if (err) *err = "Consulta vacía."; return false; }
+
+    Parser p(sql, toks);
+    SqlStatement st;
+    if (!p.statement(&st)) { if (err) *err = p.error(); return false; }
+    *out = st;
+    return true;
+}
+
+QString SqlParser::quoteIdent(const QString& name)
+{
+    bool plain = !name.isEmpty() && isIdentStart(name[0]) && !keywords().contains(name.toUpper());
+    for (int i = 0; plain && i < name.size(); ++i) plain = isIdentChar(name[i]);
+    return plain ? name : "[" + name + "]";
+}
@@ -0,0 +1,146 @@
+#ifndef SQLPARSER_H
+#define SQLPARSER_H
+
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QVector>
+#include <QSharedPointer>
+#include <QRegularExpression>
+
+/* ============================ AST de SQL ============================ */
+// Dialecto: SELECT [DISTINCT] (con [INNER|LEFT] JOIN ... ON, UNION [ALL],
+// INTERSECT, EXCEPT) e INSERT/UPDATE/DELETE sobre una tabla, GROUP BY / HAVING con
+// COUNT, SUM, AVG, MIN y MAX, expresiones con
+// AND/OR/NOT, comparaciones, aritmética, IS [NOT] NULL, [NOT] BETWEEN, [NOT] IN (lista
+// o SELECT), [NOT] EXISTS (SELECT ...), [NOT] LIKE; EXPLAIN [ANALYZE] SELECT muestra
+// el plan (y lo mide). Identificadores: Nombre, [Con espacios], "Citado", `Citado`,
+// opcionalmente calificados (Tabla.Columna). Fechas: 'yyyy-MM-dd', #yyyy-MM-dd#
+// o yyyy-MM-dd sin comillas (como las generan los diseñadores). Parámetros:
+// :nombre, o [Nombre] que no es columna de ninguna tabla (estilo Access; lo
+// decide SqlEngine::prepare, que ve los esquemas).
+
+struct SqlExpr;
+struct SqlSelect;
+class SqlLikeMatcher;   // sqlpredicate.h
+class SqlInSet;         // sqlpredicate.h
+using SqlExprPtr = QSharedPointer<SqlExpr>;
+
+struct SqlExpr {
+    enum class Kind { Literal, Column, Unary, Binary, IsNull, Between, InList, Like, Aggregate, Param,
+                      InSelect, Exists };
+
+    Kind     kind = Kind::Literal;
+    QString  op;                 // Unary: NOT, -   Binary: AND OR = <> < <= > >= + - * /
+                                 // Aggregate: COUNT SUM AVG MIN MAX (args vacío => COUNT(*))
+    QVariant value;              // Literal
+    QString  table;              // Column: calificador (tabla o alias; vacío si no hay)
+    QString  name;               // Column: nombre de la columna   Param: nombre del parámetro
+    bool     quoted = false;     // Column: escrito como [..] (puede ser un parámetro)
+    bool     negated = false;    // IS NOT NULL / NOT BETWEEN / NOT IN / NOT LIKE / NOT EXISTS
+    QVector<SqlExprPtr> args;    // operandos (Between: valor, desde, hasta; InList: valor, elementos...;
+                                 // InSelect: valor)
+    QSharedPointer<SqlSelect> subquery;   // InSelect / Exists
+    QString  text;               // texto fuente (encabezado por defecto del SELECT)
+
+    // --- Enlace (lo completa el motor al planificar) ---
+    int                index = -1;   // Column: ordinal en la fila de entrada
+    QSharedPointer<const SqlLikeMatcher> like;   // Like: patrón compilado una vez
+    QSharedPointer<const SqlInSet>       inSet;  // InList de literales: conjunto armado una vez
+
+    static SqlExprPtr literal(const QVariant& v);
+    static SqlExprPtr column(const QString& table, const QString& name);
+    static SqlExprPtr binary(const QString& op, const SqlExprPtr& l, const SqlExprPtr& r);
+};
+
+struct SqlTableRef {
+    QString name;
+    QString alias;     // vacío => el propio nombre
+    const QString& label() const { return alias.isEmpty() ? name : alias; }
+};
+
+struct SqlJoin {
+    enum class Kind { Inner, Left };
+    Kind        kind = Kind::Inner;
+    SqlTableRef table;
+    SqlExprPtr  on;
+};
+
+struct SqlSelectItem {
+    SqlExprPtr expr;       // nulo si es estrella
+    QString    alias;
+    bool       star = false;
+    QString    starTable;  // Tabla.* (vacío => *)
+};
+
+struct SqlOrderItem {
+    SqlExprPtr expr;
+    bool       desc = false;
+};
+
+// Operación de conjuntos encadenada a un SELECT (se evalúan de izquierda a
+// derecha, sin precedencia de INTERSECT)
+struct SqlSetOp {
+    enum class Kind { Union, UnionAll, Intersect, Except };
+    Kind                      kind = Kind::Union;
+    QSharedPointer<SqlSelect> select;   // sin ORDER BY ni LIMIT propios
+};
+
+struct SqlSelect {
+    bool                   distinct = false;
+    QVector<SqlSelectItem> items;
+    SqlTableRef            from;
+    QVector<SqlJoin>       joins;     // [INNER | LEFT [OUTER]] JOIN t ON ..., en orden
+    SqlExprPtr             where;     // nulo => sin filtro
+    QVector<SqlExprPtr>    groupBy;
+    SqlExprPtr             having;    // nulo => sin filtro de grupos
+    QVector<SqlSetOp>      compound;  // UNION [ALL] / INTERSECT / EXCEPT ...
+    QVector<SqlOrderItem>  orderBy;   // con compound/DISTINCT: sobre el resultado
+    qint64                 limit  = -1;
+    qint64                 offset = 0;
+    bool                   explain = false;   // EXPLAIN SELECT: devuelve el plan
+    bool                   analyze = false;   // EXPLAIN ANALYZE: lo ejecuta y mide cada operador
+};
+
+struct SqlInsert {
+    QString                        table;
+    QStringList                    columns;   // vacío => todas, en orden de esquema
+    QVector<QVector<SqlExprPtr>>   rows;
+};
+
+struct SqlDelete {
+    SqlTableRef table;
+    SqlExprPtr  where;
+};
+
+struct SqlAssignment {
+    QString    column;
+    SqlExprPtr value;     // puede leer columnas de la fila (SET x = x + 1)
+};
+
+struct SqlUpdate {
+    SqlTableRef            table;
+    QVector<SqlAssignment> set;
+    SqlExprPtr             where;
+};
+
+struct SqlStatement {
+    enum class Kind { Invalid, Select, Insert, Update, Delete };
+    Kind      kind = Kind::Invalid;
+    SqlSelect select;
+    SqlInsert insert;
+    SqlUpdate update;
+    SqlDelete del;
+};
+
+/* ============================== Parser ============================== */
+class SqlParser {
+public:
+    // Analiza una sentencia (un ';' final es opcional). false + err si no es válida.
+    static bool parse(const QString& sql, SqlStatement* out, QString* err = nullptr);
+
+    // Nombre de tabla/columna listo para insertar en SQL generado ([..] si hace falta)
+    static QString quoteIdent(const QString& name);
+};
+
+#endif // SQLPARSER_H
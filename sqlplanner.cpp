@@ -0,0 +1,279 @@
+#include "sqlplanner.h"
+#include "sqlpredicate.h"
+
+#include <QDate>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Conjunciones de nivel superior: a AND (b AND c) -> [a, b, c]
+void conjuncts(const SqlExprPtr& e, QVector<SqlExprPtr>* out)
+{
+    if (e->kind == SqlExpr::Kind::Binary && e->op == "AND") {
+        conjuncts(e->args[0], out);
+        conjuncts(e->args[1], out);
+    } else {
+        out->push_back(e);
+    }
+}
+
+// Convierte el literal al tipo de la columna solo si el orden del índice
+// coincide con el de sqlCompare para ese par (si no, la condición no es indexable)
+bool typedProbe(const Column& col, const QVariant& lit, CellProbe* out)
+{
+    if (sqlIsNull(lit)) return false;
+    const bool isDate = lit.typeId() == QMetaType::QDate;
+    bool ok = false;
+    switch (col.kind()) {
+    case ColumnKind::Int64: {
+        if (isDate) return false;
+        if (lit.typeId() == QMetaType::LongLong) { out->i = lit.toLongLong(); break; }
+        const double d = lit.toDouble(&ok);
+        if (!ok || d != std::floor(d)) return false;   // 5.5 contra enteros: no se acota
+        // Fuera de [-2^63, 2^63) (p. ej. 1e20) no cabe en qint64: no se acota
+        if (d < -9223372036854775808.0 || d >= 9223372036854775808.0) return false;
+        out->i = qint64(d);
+        break;
+    }
+    case ColumnKind::Double:
+        if (isDate) return false;
+        out->d = lit.toDouble(&ok);
+        if (!ok) return false;
+        break;
+    case ColumnKind::Date: {
+        const QDate d = isDate ? lit.toDate() : QDate::fromString(lit.toString(), "yyyy-MM-dd");
+        if (!d.isValid()) return false;
+        out->i = d.toJulianDay();
+        break;
+    }
+    case ColumnKind::Bool:
+        return false;                                  // dos valores: nunca es selectivo
+    case ColumnKind::Text:
+        if (isDate) return false;
+        (void)lit.toDouble(&ok);
+        if (ok) return false;                          // texto contra número compara numérico
+        out->s = lit.toString();
+        break;
+    }
+    out->null = false;
+    return true;
+}
+
+struct Bound {
+    bool      set = false;
+    CellProbe p;
+    bool      incl = true;
+};
+
+// Slots (ascendentes) del índice ordenado dentro de [lo, hi]; vacío y false si
+// superan maxRows (no se copian)
+bool rangeSlots(const ColumnTable& tab, int col, const Bound& lo, const Bound& hi,
+                qint64 maxRows, QVector<int>* out)
+{
+    const QVector<int> order = tab.sortedSlots(col);
+    const Column& c = tab.column(col);
+    auto first = order.cbegin();
+    auto last  = order.cend();
+    if (lo.set) {
+        first = lo.incl
+            ? std::lower_bound(first, last, 0, [&](int s, int) { return c.compareTo(s, lo.p) < 0; })
+            : std::upper_bound(first, last, 0, [&](int, int s) { return c.compareTo(s, lo.p) > 0; });
+    }
+    if (hi.set) {
+        last = hi.incl
+            ? std::upper_bound(first, last, 0, [&](int, int s) { return c.compareTo(s, hi.p) > 0; })
+            : std::lower_bound(first, last, 0, [&](int s, int) { return c.compareTo(s, hi.p) < 0; });
+    }
+    if (last - first > maxRows) return false;
+    out->clear();
+    out->reserve(int(last - first));
+    for (auto it = first; it != last; ++it) out->push_back(*it);
+    std::sort(out->begin(), out->end());
+    return true;
+}
+
+// Igualdad: hash si la igualdad del índice coincide con la de SQL (enteros,
+// fechas; textos con diccionario probando cada variante de mayúsculas), si no
+// el índice ordenado.
+bool equalSlots(const ColumnTable& tab, int col, const CellProbe& p, qint64 maxRows, QVector<int>* out)
+{
+    const Column& c = tab.column(col);
+    if (c.kind() == ColumnKind::Int64 || c.kind() == ColumnKind::Date) {
+        *out = tab.lookup(col, p);
+    } else if (c.kind() == ColumnKind::Text && c.isDictEncoded()) {
+        out->clear();
+        for (const QString& variant : c.dictionary()) {
+            if (QString::compare(variant, p.s, Qt::CaseInsensitive) != 0) continue;
+            *out += tab.lookup(col, c.probe(variant));
+        }
+    } else {
+        Bound b; b.set = true; b.p = p;
+        return rangeSlots(tab, col, b, b, maxRows, out);
+    }
+    if (out->size() > maxRows) return false;
+    std::sort(out->begin(), out->end());
+    return true;
+}
+
+// LIKE 'abc%' sobre texto: el índice ordena sin distinguir mayúsculas, así
+// que los textos con ese prefijo forman un tramo contiguo
+bool prefixSlots(const ColumnTable& tab, int col, const QString& prefix, qint64 maxRows, QVector<int>* out)
+{
+    const QVector<int> order = tab.sortedSlots(col);
+    const Column& c = tab.column(col);
+    const int n = prefix.size();
+    auto head = [&](int s) { return c.textAt(s).left(n).compare(prefix, Qt::CaseInsensitive); };
+    const auto first = std::partition_point(order.cbegin(), order.cend(), [&](int s) { return head(s) < 0; });
+    const auto last  = std::partition_point(first, order.cend(), [&](int s) { return head(s) == 0; });
+    if (last - first > maxRows) return false;
+    out->clear();
+    out->reserve(int(last - first));
+    for (auto it = first; it != last; ++it) out->push_back(*it);
+    std::sort(out->begin(), out->end());
+    return true;
+}
+
+struct Option {
+    QString      text;
+    QVector<int> rows;
+};
+
+bool indexedColumn(const SqlExprPtr& e, const ColumnTable& tab)
+{
+    return e->kind == SqlExpr::Kind::Column && e->index >= 0 && e->index < tab.columnCount()
+        && tab.hasIndex(e->index);
+}
+
+// Una conjunción indexable y selectiva -> sus slots candidatos
+bool indexOption(const SqlExprPtr& e, const ColumnTable& tab, qint64 maxRows, Option* out)
+{
+    out->text = e->text;
+
+    if (e->kind == SqlExpr::Kind::Binary && e->op != "<>") {
+        static const QStringList cmp = { "=", "<", "<=", ">", ">=" };
+        if (!cmp.contains(e->op)) return false;
+        SqlExprPtr colE = e->args[0], litE = e->args[1];
+        QString op = e->op;
+        if (colE->kind == SqlExpr::Kind::Literal) {           // 5 < x  ==  x > 5
+            std::swap(colE, litE);
+            if (op.startsWith('<'))      op[0] = QChar('>');
+            else if (op.startsWith('>')) op[0] = QChar('<');
+        }
+        if (!indexedColumn(colE, tab) || litE->kind != SqlExpr::Kind::Literal) return false;
+        const int col = colE->index;
+        CellProbe p;
+        if (!typedProbe(tab.column(col), litE->value, &p)) return false;
+        if (op == "=") return equalSlots(tab, col, p, maxRows, &out->rows);
+        Bound lo, hi;
+        if (op.startsWith('>')) { lo.set = true; lo.p = p; lo.incl = (op == ">="); }
+        else                    { hi.set = true; hi.p = p; hi.incl = (op == "<="); }
+        return rangeSlots(tab, col, lo, hi, maxRows, &out->rows);
+    }
+
+    if (e->kind == SqlExpr::Kind::Between && !e->negated) {
+        if (!indexedColumn(e->args[0], tab)) return false;
+        if (e->args[1]->kind != SqlExpr::Kind::Literal || e->args[2]->kind != SqlExpr::Kind::Literal) return false;
+        const int col = e->args[0]->index;
+        Bound lo, hi;
+        lo.set = hi.set = true;
+        if (!typedProbe(tab.column(col), e->args[1]->value, &lo.p)) return false;
+        if (!typedProbe(tab.column(col), e->args[2]->value, &hi.p)) return false;
+        return rangeSlots(tab, col, lo, hi, maxRows, &out->rows);
+    }
+
+    if (e->kind == SqlExpr::Kind::Like && !e->negated && e->like) {
+        if (!indexedColumn(e->args[0], tab)) return false;
+        const int col = e->args[0]->index;
+        if (tab.column(col).kind() != ColumnKind::Text) return false;   // otros tipos: LIKE sobre su texto
+        const SqlLikeMatcher& m = *e->like;
+        if (m.kind() == SqlLikeMatcher::Kind::Prefix && !m.literal().isEmpty())
+            return prefixSlots(tab, col, m.literal(), maxRows, &out->rows);
+        if (m.kind() == SqlLikeMatcher::Kind::Exact) {
+            CellProbe p;                                       // comparación de texto, aunque parezca número
+            p.s = m.literal();
+            p.null = false;
+            return equalSlots(tab, col, p, maxRows, &out->rows);
+        }
+        return false;
+    }
+
+    if (e->kind == SqlExpr::Kind::InList && !e->negated && e->inSet) {
+        if (!indexedColumn(e->args[0], tab)) return false;
+        const int col = e->args[0]->index;
+        const Column& c = tab.column(col);
+        const SqlInSet& set = *e->inSet;
+        if (set.size() > SqlInSet::kSmallList)
+            out->text = QString("%1 [semi-join, %2 valores]").arg(e->text).arg(set.size());
+        out->rows.clear();
+        if (c.kind() == ColumnKind::Text && c.isDictEncoded()) {
+            // Semi-join contra el diccionario: una pasada, sin probar cada
+            // elemento contra todas las variantes de mayúsculas
+            for (const QString& variant : c.dictionary()) {
+                if (!set.contains(QVariant(variant))) continue;
+                out->rows += tab.lookup(col, c.probe(variant));
+                if (out->rows.size() > maxRows) return false;
+            }
+        } else {
+            for (const SqlKeyPart& k : set.values()) {   // distintos, NULL ya excluido
+                CellProbe p;
+                if (!typedProbe(c, k.value(), &p)) return false;
+                QVector<int> hits;
+                if (!equalSlots(tab, col, p, maxRows, &hits)) return false;
+                out->rows += hits;
+                if (out->rows.size() > maxRows) return false;
+            }
+        }
+        std::sort(out->rows.begin(), out->rows.end());
+        out->rows.erase(std::unique(out->rows.begin(), out->rows.end()), out->rows.end());
+        return true;
+    }
+
+    return false;
+}
+
+} // namespace
+
+QString SqlAccessPath::describe() const
+{
+    if (kind == Kind::FullScan) return QString("recorrido completo (%1 filas)").arg(estimatedRows);
+    return QString("índice: %1 (%2 filas)").arg(indexConds.join(" ∩ ")).arg(estimatedRows);
+}
+
+SqlAccessPath SqlPlanner::chooseAccessPath(const SqlExprPtr& boundWhere, const ColumnTable& tab)
+{
+    SqlAccessPath path;
+    path.estimatedRows = tab.liveCount();
+    if (!boundWhere || tab.liveCount() == 0) return path;
+
+    // Cada condición indexable da su número exacto de filas (rango en el índice
+    // ordenado o lista del hash); las que pasan del umbral se descartan sin copiarlas.
+    const qint64 maxRows = qint64(tab.liveCount() * kMaxIndexSelectivity);
+    QVector<SqlExprPtr> conds;
+    conjuncts(boundWhere, &conds);
+
+    QVector<Option> options;
+    for (const SqlExprPtr& c : conds) {
+        Option o;
+        if (indexOption(c, tab, maxRows, &o)) options.push_back(o);
+    }
+    if (options.isEmpty()) return path;
+
+    std::sort(options.begin(), options.end(),
+              [](const Option& a, const Option& b) { return a.rows.size() < b.rows.size(); });
+
+    // La más selectiva, intersectada con el resto (todas ascendentes)
+    path.kind = SqlAccessPath::Kind::Index;
+    path.candidates = options[0].rows;
+    path.indexConds << options[0].text;
+    for (int i = 1; i < options.size() && !path.candidates.isEmpty(); ++i) {
+        QVector<int> both;
+        std::set_intersection(path.candidates.cbegin(), path.candidates.cend(),
+                              options[i].rows.cbegin(), options[i].rows.cend(),
+                              std::back_inserter(both));
+        path.candidates.swap(both);
+        path.indexConds << options[i].text;
+    }
+    path.estimatedRows = path.candidates.size();
+    return path;
+}
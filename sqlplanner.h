@@ -0,0 +1,37 @@
+#ifndef SQLPLANNER_H
+#define SQLPLANNER_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "sqlparser.h"
+#include "columnstore.h"
+
+/* ======================= Camino de acceso ======================= */
+// Cómo llega el scan a las filas candidatas. Con índice, el WHERE completo se
+// vuelve a evaluar sobre cada candidata (el índice solo acota).
+struct SqlAccessPath {
+    enum class Kind { FullScan, Index };
+
+    Kind         kind = Kind::FullScan;
+    QVector<int> candidates;        // Index: slots en orden ascendente
+    QStringList  indexConds;        // condiciones resueltas por índice (para EXPLAIN)
+    qint64       estimatedRows = 0; // filas que recorrerá el scan
+
+    QString describe() const;
+};
+
+class SqlPlanner {
+public:
+    // Por encima de esta fracción de la tabla un índice no compensa: se escanea
+    static constexpr double kMaxIndexSelectivity = 0.25;
+
+    // Elige el acceso para un WHERE enlazado contra las columnas de 'tab'. Usa
+    // los índices de la tabla (PK, únicos e "Indexado: Sí") para =, IN, BETWEEN,
+    // <, <=, >, >= sobre conjunciones de nivel superior; si varias condiciones
+    // son selectivas, intersecta sus resultados.
+    static SqlAccessPath chooseAccessPath(const SqlExprPtr& boundWhere, const ColumnTable& tab);
+};
+
+#endif // SQLPLANNER_H
@@ -0,0 +1,623 @@
+#include "sqlpredicate.h"
+
+#include <QDate>
+#include <QVector>
+#include <algorithm>
+
+/* ======================= Valores y comparación ======================= */
+bool sqlIsNull(const QVariant& v) { return !v.isValid() || v.isNull(); }
+
+// Orden entre dos valores no nulos (mismas reglas que usaban las páginas de consulta):
+// fechas (un texto 'yyyy-MM-dd' se interpreta), números, y si no, texto sin mayúsculas.
+int sqlCompare(const QVariant& a, const QVariant& b)
+{
+    if (a.typeId() == QMetaType::QDate || b.typeId() == QMetaType::QDate) {
+        const QDate da = (a.typeId() == QMetaType::QDate) ? a.toDate() : QDate::fromString(a.toString(), "yyyy-MM-dd");
+        const QDate db = (b.typeId() == QMetaType::QDate) ? b.toDate() : QDate::fromString(b.toString(), "yyyy-MM-dd");
+        if (da.isValid() && db.isValid()) return (da < db) ? -1 : (da > db) ? 1 : 0;
+        return QString::compare(a.toString(), b.toString(), Qt::CaseInsensitive);
+    }
+    if (a.typeId() == QMetaType::LongLong && b.typeId() == QMetaType::LongLong) {
+        const qlonglong ia = a.toLongLong(), ib = b.toLongLong();
+        return (ia < ib) ? -1 : (ia > ib) ? 1 : 0;
+    }
+    bool okA = false, okB = false;
+    const double da = a.toDouble(&okA), db = b.toDouble(&okB);
+    if (okA && okB) return (da < db) ? -1 : (da > db) ? 1 : 0;
+    return QString::compare(a.toString(), b.toString(), Qt::CaseInsensitive);
+}
+
+// Orden total para ORDER BY: NULL va primero
+int sqlCompareForSort(const QVariant& a, const QVariant& b)
+{
+    const bool na = sqlIsNull(a), nb = sqlIsNull(b);
+    if (na || nb) return (na && nb) ? 0 : na ? -1 : 1;
+    return sqlCompare(a, b);
+}
+
+QRegularExpression sqlLikeRegex(const QString& pattern)
+{
+    QString rx;
+    for (const QChar c : pattern) {
+        if (c == '%')      rx += ".*";
+        else if (c == '_') rx += '.';
+        else               rx += QRegularExpression::escape(QString(c));
+    }
+    return QRegularExpression(QRegularExpression::anchoredPattern(rx),
+                              QRegularExpression::CaseInsensitiveOption
+                              | QRegularExpression::DotMatchesEverythingOption);
+}
+
+SqlLikeMatcher::SqlLikeMatcher(const QString& pattern) : m_pattern(pattern)
+{
+    // % al principio y al final; el resto del patrón debe ser texto fijo
+    int lead = 0, trail = 0;
+    while (lead < pattern.size() && pattern[lead] == '%') ++lead;
+    while (trail < pattern.size() - lead && pattern[pattern.size() - 1 - trail] == '%') ++trail;
+    m_lit = pattern.mid(lead, pattern.size() - lead - trail);
+    if (m_lit.contains('%') || m_lit.contains('_')) {
+        m_kind = Kind::Wildcard;
+        m_re = sqlLikeRegex(pattern);
+        m_lit.clear();
+    } else if (lead && trail) {
+        m_kind = Kind::Contains;
+        m_finder = QStringMatcher(m_lit, Qt::CaseInsensitive);
+    } else if (lead) {
+        m_kind = Kind::Suffix;
+    } else if (trail) {
+        m_kind = Kind::Prefix;
+    } else {
+        m_kind = Kind::Exact;
+    }
+}
+
+bool SqlLikeMatcher::matches(QStringView s) const
+{
+    switch (m_kind) {
+    case Kind::Exact:    return s.compare(m_lit, Qt::CaseInsensitive) == 0;
+    case Kind::Prefix:   return s.startsWith(m_lit, Qt::CaseInsensitive);
+    case Kind::Suffix:   return s.endsWith(m_lit, Qt::CaseInsensitive);
+    case Kind::Contains: return m_lit.isEmpty() || m_finder.indexIn(s) >= 0;
+    case Kind::Wildcard: return m_re.match(s.toString()).hasMatch();
+    }
+    return false;
+}
+
+SqlKeyPart SqlKeyPart::of(const QVariant& v)
+{
+    SqlKeyPart k;
+    if (sqlIsNull(v)) return k;
+    if (v.typeId() == QMetaType::QDate) {
+        k.cls = Date; k.day = v.toDate().toJulianDay();
+        return k;
+    }
+    bool ok = false;
+    k.num = v.toDouble(&ok);
+    if (ok) {
+        k.cls = Num;
+        if (k.num == 0) k.num = 0;   // -0 == 0
+        return k;
+    }
+    const QString s = v.toString();
+    const QDate d = QDate::fromString(s, "yyyy-MM-dd");
+    if (d.isValid()) { k.cls = Date; k.day = d.toJulianDay(); }
+    else             { k.cls = Text; k.text = s.toCaseFolded(); }
+    return k;
+}
+
+QVariant SqlKeyPart::value() const
+{
+    switch (cls) {
+    case Null: break;
+    case Date: return QDate::fromJulianDay(day);
+    case Num:  return num;
+    case Text: return text;
+    }
+    return {};
+}
+
+bool SqlKeyPart::operator==(const SqlKeyPart& o) const
+{
+    if (cls != o.cls) return false;
+    switch (cls) {
+    case Null: return true;
+    case Date: return day == o.day;
+    case Num:  return num == o.num;
+    case Text: return text == o.text;
+    }
+    return false;
+}
+
+size_t qHash(const SqlKeyPart& k, size_t seed)
+{
+    switch (k.cls) {
+    case SqlKeyPart::Null: return seed;
+    case SqlKeyPart::Date: return qHash(k.day, seed);
+    case SqlKeyPart::Num:  return qHash(k.num, seed);
+    case SqlKeyPart::Text: return qHash(k.text, seed);
+    }
+    return seed;
+}
+
+// Orden cualquiera pero total, para el arreglo de SqlInSet
+static bool keyLess(const SqlKeyPart& a, const SqlKeyPart& b)
+{
+    if (a.cls != b.cls) return a.cls < b.cls;
+    switch (a.cls) {
+    case SqlKeyPart::Null: return false;
+    case SqlKeyPart::Date: return a.day < b.day;
+    case SqlKeyPart::Num:  return a.num < b.num;
+    case SqlKeyPart::Text: return a.text < b.text;
+    }
+    return false;
+}
+
+SqlInSet::SqlInSet(const QVector<QVariant>& values)
+{
+    m_values.reserve(values.size());
+    for (const QVariant& v : values) {
+        if (sqlIsNull(v)) { m_hasNull = true; continue; }
+        m_values.push_back(SqlKeyPart::of(v));
+    }
+    std::sort(m_values.begin(), m_values.end(), keyLess);
+    m_values.erase(std::unique(m_values.begin(), m_values.end()), m_values.end());
+    if (m_values.size() > kSmallList) {
+        m_set.reserve(m_values.size());
+        for (const SqlKeyPart& k : m_values) m_set.insert(k);
+    }
+}
+
+bool SqlInSet::contains(const SqlKeyPart& k) const
+{
+    if (k.cls == SqlKeyPart::Null) return false;
+    if (m_values.size() > kSmallList) return m_set.contains(k);
+    const auto it = std::lower_bound(m_values.cbegin(), m_values.cend(), k, keyLess);
+    return it != m_values.cend() && *it == k;
+}
+
+bool SqlInSet::containsNumber(double d) const
+{
+    SqlKeyPart k;
+    k.cls = SqlKeyPart::Num;
+    k.num = (d == 0) ? 0 : d;   // -0 == 0
+    return contains(k);
+}
+
+bool SqlInSet::containsDay(qint64 julianDay) const
+{
+    SqlKeyPart k;
+    k.cls = SqlKeyPart::Date;
+    k.day = julianDay;
+    return contains(k);
+}
+
+/* ======================= Evaluación de expresiones ======================= */
+bool sqlIsTrue(const QVariant& v) { return !sqlIsNull(v) && v.toBool(); }
+
+static QVariant arith(const QString& op, const QVariant& a, const QVariant& b)
+{
+    if (sqlIsNull(a) || sqlIsNull(b)) return {};
+    if (a.typeId() == QMetaType::LongLong && b.typeId() == QMetaType::LongLong && op != "/") {
+        const qlonglong x = a.toLongLong(), y = b.toLongLong();
+        if (op == "+") return x + y;
+        if (op == "-") return x - y;
+        return x * y;
+    }
+    bool okA = false, okB = false;
+    const double x = a.toDouble(&okA), y = b.toDouble(&okB);
+    if (!okA || !okB) return (op == "+") ? QVariant(a.toString() + b.toString()) : QVariant();
+    if (op == "+") return x + y;
+    if (op == "-") return x - y;
+    if (op == "*") return x * y;
+    return (y == 0.0) ? QVariant() : QVariant(x / y);
+}
+
+QVariant sqlEval(const SqlExpr& e, const Record& row)
+{
+    switch (e.kind) {
+    case SqlExpr::Kind::Literal:
+        return e.value;
+
+    case SqlExpr::Kind::Column:
+        return row.value(e.index);
+
+    case SqlExpr::Kind::Unary: {
+        const QVariant a = sqlEval(*e.args[0], row);
+        if (sqlIsNull(a)) return {};
+        if (e.op == "NOT") return !a.toBool();
+        if (a.typeId() == QMetaType::LongLong) return -a.toLongLong();
+        return -a.toDouble();
+    }
+
+    case SqlExpr::Kind::Binary: {
+        if (e.op == "AND") {
+            const QVariant a = sqlEval(*e.args[0], row);
+            if (!sqlIsNull(a) && !a.toBool()) return false;
+            const QVariant b = sqlEval(*e.args[1], row);
+            if (!sqlIsNull(b) && !b.toBool()) return false;
+            return (sqlIsNull(a) || sqlIsNull(b)) ? QVariant() : QVariant(true);
+        }
+        if (e.op == "OR") {
+            const QVariant a = sqlEval(*e.args[0], row);
+            if (sqlIsTrue(a)) return true;
+            const QVariant b = sqlEval(*e.args[1], row);
+            if (sqlIsTrue(b)) return true;
+            return (sqlIsNull(a) || sqlIsNull(b)) ? QVariant() : QVariant(false);
+        }
+        const QVariant a = sqlEval(*e.args[0], row);
+        const QVariant b = sqlEval(*e.args[1], row);
+        if (e.op == "+" || e.op == "-" || e.op == "*" || e.op == "/") return arith(e.op, a, b);
+        if (sqlIsNull(a) || sqlIsNull(b)) return {};
+        const int c = sqlCompare(a, b);
+        if (e.op == "=")  return c == 0;
+        if (e.op == "<>") return c != 0;
+        if (e.op == "<")  return c < 0;
+        if (e.op == "<=") return c <= 0;
+        if (e.op == ">")  return c > 0;
+        return c >= 0;
+    }
+
+    case SqlExpr::Kind::IsNull:
+        return sqlIsNull(sqlEval(*e.args[0], row)) != e.negated;
+
+    case SqlExpr::Kind::Between: {
+        const QVariant v  = sqlEval(*e.args[0], row);
+        const QVariant lo = sqlEval(*e.args[1], row);
+        const QVariant hi = sqlEval(*e.args[2], row);
+        if (sqlIsNull(v) || sqlIsNull(lo) || sqlIsNull(hi)) return {};
+        const bool in = sqlCompare(v, lo) >= 0 && sqlCompare(v, hi) <= 0;
+        return in != e.negated;
+    }
+
+    case SqlExpr::Kind::InList: {
+        const QVariant v = sqlEval(*e.args[0], row);
+        if (sqlIsNull(v)) return {};
+        if (e.inSet) {                                 // lista de literales: una búsqueda
+            const QVariant in = e.inSet->test(SqlKeyPart::of(v));
+            return sqlIsNull(in) ? in : QVariant(in.toBool() != e.negated);
+        }
+        bool sawNull = false;
+        for (int i = 1; i < e.args.size(); ++i) {
+            const QVariant x = sqlEval(*e.args[i], row);
+            if (sqlIsNull(x)) { sawNull = true; continue; }
+            if (sqlCompare(v, x) == 0) return !e.negated;
+        }
+        return sawNull ? QVariant() : QVariant(e.negated);
+    }
+
+    case SqlExpr::Kind::Like: {
+        const QVariant v = sqlEval(*e.args[0], row);
+        if (sqlIsNull(v)) return {};
+        if (!e.like) {                                 // patrón calculado por fila
+            const QVariant p = sqlEval(*e.args[1], row);
+            if (sqlIsNull(p)) return {};
+            return SqlLikeMatcher(p.toString()).matches(v.toString()) != e.negated;
+        }
+        return e.like->matches(v.toString()) != e.negated;
+    }
+
+    case SqlExpr::Kind::Aggregate:
+        break;   // el motor las sustituye por columnas de la agregación
+    case SqlExpr::Kind::Param:
+        break;   // se sustituyen por literales antes de enlazar (SqlPreparedQuery)
+    case SqlExpr::Kind::InSelect:
+    case SqlExpr::Kind::Exists:
+        break;   // el motor las resuelve con semi / anti joins
+    }
+    return {};
+}
+
+/* ======================= Predicados compilados ======================= */
+namespace {
+
+using Fn = std::function<SqlTruth(int)>;
+
+enum class Cmp { Eq, Ne, Lt, Le, Gt, Ge };
+
+Cmp toCmp(const QString& op)
+{
+    if (op == "=")  return Cmp::Eq;
+    if (op == "<>") return Cmp::Ne;
+    if (op == "<")  return Cmp::Lt;
+    if (op == "<=") return Cmp::Le;
+    if (op == ">")  return Cmp::Gt;
+    return Cmp::Ge;
+}
+
+// literal <op> columna  ==  columna <op invertido> literal
+Cmp mirror(Cmp c)
+{
+    switch (c) {
+    case Cmp::Lt: return Cmp::Gt;
+    case Cmp::Le: return Cmp::Ge;
+    case Cmp::Gt: return Cmp::Lt;
+    case Cmp::Ge: return Cmp::Le;
+    default:      return c;
+    }
+}
+
+inline bool holds(Cmp op, int c)
+{
+    switch (op) {
+    case Cmp::Eq: return c == 0;
+    case Cmp::Ne: return c != 0;
+    case Cmp::Lt: return c < 0;
+    case Cmp::Le: return c <= 0;
+    case Cmp::Gt: return c > 0;
+    case Cmp::Ge: return c >= 0;
+    }
+    return false;
+}
+
+template <typename T> inline int cmp3(T a, T b) { return (a < b) ? -1 : (b < a) ? 1 : 0; }
+
+inline SqlTruth truth(bool b) { return b ? SqlTruth::True : SqlTruth::False; }
+
+SqlTruth truthOf(const QVariant& v)
+{
+    return sqlIsNull(v) ? SqlTruth::Unknown : truth(v.toBool());
+}
+
+Fn constant(SqlTruth t) { return [t](int) { return t; }; }
+
+// Columna por diccionario: el predicado se evalúa una vez por texto distinto y
+// por fila solo se mira el código de la celda (no nula) en la tabla resultante
+class DictHits {
+public:
+    template <typename Pred>
+    DictHits(const Column& col, Pred pred) : m_col(col), m_hit(col.dictionary().size()) {
+        const QVector<QString>& dict = col.dictionary();
+        for (int c = 0; c < dict.size(); ++c) m_hit[c] = pred(dict[c]);
+    }
+    bool operator()(int slot) const {
+        const qint32 code = m_col.codeAt(slot);
+        return code >= 0 && code < m_hit.size() && m_hit[code];
+    }
+
+private:
+    const Column& m_col;
+    QVector<bool> m_hit;
+};
+
+bool isColumn(const SqlExprPtr& e, const ColumnTable& tab)
+{
+    return e->kind == SqlExpr::Kind::Column && e->index >= 0 && e->index < tab.columnCount();
+}
+
+bool isLiteral(const SqlExprPtr& e) { return e->kind == SqlExpr::Kind::Literal; }
+
+// columna <op> literal (no nulo). El literal se convierte una sola vez al tipo
+// de la columna; si la conversión no aplica se compara con sqlCompare sobre el
+// valor de la celda, que da lo mismo que el evaluador genérico.
+Fn compileCompare(const Column& col, Cmp op, const QVariant& lit)
+{
+    const bool litIsDate = lit.typeId() == QMetaType::QDate;
+    bool numOk = false;
+    const double num = litIsDate ? 0.0 : lit.toDouble(&numOk);
+
+    switch (col.kind()) {
+    case ColumnKind::Int64:
+        if (lit.typeId() == QMetaType::LongLong) {
+            const qint64 v = lit.toLongLong();
+            return [&col, op, v](int s) {
+                if (col.isNull(s)) return SqlTruth::Unknown;
+                return truth(holds(op, cmp3(col.int64At(s), v)));
+            };
+        }
+        [[fallthrough]];
+    case ColumnKind::Double:
+        if (numOk) {
+            return [&col, op, num](int s) {
+                if (col.isNull(s)) return SqlTruth::Unknown;
+                return truth(holds(op, cmp3(col.doubleAt(s), num)));
+            };
+        }
+        break;
+
+    case ColumnKind::Date: {
+        const QDate d = litIsDate ? lit.toDate() : QDate::fromString(lit.toString(), "yyyy-MM-dd");
+        if (d.isValid()) {
+            const qint64 day = d.toJulianDay();
+            return [&col, op, day](int s) {
+                if (col.isNull(s)) return SqlTruth::Unknown;
+                return truth(holds(op, cmp3(qint64(col.dayAt(s)), day)));
+            };
+        }
+        break;
+    }
+
+    case ColumnKind::Bool:
+        if (numOk) {
+            return [&col, op, num](int s) {
+                if (col.isNull(s)) return SqlTruth::Unknown;
+                return truth(holds(op, cmp3(col.boolAt(s) ? 1.0 : 0.0, num)));
+            };
+        }
+        break;
+
+    case ColumnKind::Text: {
+        // Solo un literal de texto no numérico se compara como texto puro
+        if (litIsDate || numOk) break;
+        const QString text = lit.toString();
+        if (col.isDictEncoded() && (op == Cmp::Eq || op == Cmp::Ne)) {
+            const DictHits hit(col, [&text](const QString& t) {
+                return QString::compare(t, text, Qt::CaseInsensitive) == 0;
+            });
+            const bool want = (op == Cmp::Eq);
+            return [&col, hit, want](int s) {
+                if (col.isNull(s)) return SqlTruth::Unknown;
+                return truth(hit(s) == want);
+            };
+        }
+        return [&col, op, text](int s) {
+            if (col.isNull(s)) return SqlTruth::Unknown;
+            return truth(holds(op, QStringView(col.textAt(s)).compare(text, Qt::CaseInsensitive)));
+        };
+    }
+    }
+
+    return [&col, op, lit](int s) {
+        const QVariant v = col.value(s);
+        if (sqlIsNull(v)) return SqlTruth::Unknown;
+        return truth(holds(op, sqlCompare(v, lit)));
+    };
+}
+
+Fn andOf(Fn a, Fn b)
+{
+    return [a, b](int s) {
+        const SqlTruth x = a(s);
+        if (x == SqlTruth::False) return SqlTruth::False;
+        const SqlTruth y = b(s);
+        if (y == SqlTruth::False) return SqlTruth::False;
+        return (x == SqlTruth::True && y == SqlTruth::True) ? SqlTruth::True : SqlTruth::Unknown;
+    };
+}
+
+Fn orOf(Fn a, Fn b)
+{
+    return [a, b](int s) {
+        const SqlTruth x = a(s);
+        if (x == SqlTruth::True) return SqlTruth::True;
+        const SqlTruth y = b(s);
+        if (y == SqlTruth::True) return SqlTruth::True;
+        return (x == SqlTruth::False && y == SqlTruth::False) ? SqlTruth::False : SqlTruth::Unknown;
+    };
+}
+
+Fn notOf(Fn a)
+{
+    return [a](int s) {
+        const SqlTruth x = a(s);
+        return x == SqlTruth::Unknown ? x : truth(x == SqlTruth::False);
+    };
+}
+
+Fn compileNode(const SqlExprPtr& e, const ColumnTable& tab)
+{
+    switch (e->kind) {
+    case SqlExpr::Kind::Literal:
+        return constant(truthOf(e->value));
+
+    case SqlExpr::Kind::Unary:
+        if (e->op == "NOT") return notOf(compileNode(e->args[0], tab));
+        break;
+
+    case SqlExpr::Kind::Binary: {
+        if (e->op == "AND") return andOf(compileNode(e->args[0], tab), compileNode(e->args[1], tab));
+        if (e->op == "OR")  return orOf(compileNode(e->args[0], tab), compileNode(e->args[1], tab));
+        if (e->op == "+" || e->op == "-" || e->op == "*" || e->op == "/") break;
+        const SqlExprPtr& l = e->args[0];
+        const SqlExprPtr& r = e->args[1];
+        if (isColumn(l, tab) && isLiteral(r))
+            return sqlIsNull(r->value) ? constant(SqlTruth::Unknown)
+                                       : compileCompare(tab.column(l->index), toCmp(e->op), r->value);
+        if (isLiteral(l) && isColumn(r, tab))
+            return sqlIsNull(l->value) ? constant(SqlTruth::Unknown)
+                                       : compileCompare(tab.column(r->index), mirror(toCmp(e->op)), l->value);
+        break;
+    }
+
+    case SqlExpr::Kind::IsNull:
+        if (isColumn(e->args[0], tab)) {
+            const Column& col = tab.column(e->args[0]->index);
+            const bool neg = e->negated;
+            return [&col, neg](int s) { return truth(col.isNull(s) != neg); };
+        }
+        break;
+
+    case SqlExpr::Kind::Between: {
+        const SqlExprPtr& v = e->args[0];
+        if (!isColumn(v, tab) || !isLiteral(e->args[1]) || !isLiteral(e->args[2])) break;
+        if (sqlIsNull(e->args[1]->value) || sqlIsNull(e->args[2]->value)) return constant(SqlTruth::Unknown);
+        const Column& col = tab.column(v->index);
+        Fn in = andOf(compileCompare(col, Cmp::Ge, e->args[1]->value),
+                      compileCompare(col, Cmp::Le, e->args[2]->value));
+        return e->negated ? notOf(in) : in;
+    }
+
+    case SqlExpr::Kind::InList: {
+        const SqlExprPtr& v = e->args[0];
+        if (!isColumn(v, tab) || !e->inSet) break;
+        const Column& col = tab.column(v->index);
+        const SqlInSetPtr set = e->inSet;
+        const SqlTruth absent = set->hasNull() ? SqlTruth::Unknown : SqlTruth::False;
+        Fn in;
+        switch (col.kind()) {
+        case ColumnKind::Int64:
+        case ColumnKind::Double:
+            in = [&col, set, absent](int s) {
+                if (col.isNull(s)) return SqlTruth::Unknown;
+                return set->containsNumber(col.doubleAt(s)) ? SqlTruth::True : absent;
+            };
+            break;
+        case ColumnKind::Date:
+            in = [&col, set, absent](int s) {
+                if (col.isNull(s)) return SqlTruth::Unknown;
+                return set->containsDay(col.dayAt(s)) ? SqlTruth::True : absent;
+            };
+            break;
+        case ColumnKind::Text:
+            if (col.isDictEncoded()) {
+                const DictHits hit(col, [&set](const QString& t) { return set->contains(QVariant(t)); });
+                in = [&col, hit, absent](int s) {
+                    if (col.isNull(s)) return SqlTruth::Unknown;
+                    return hit(s) ? SqlTruth::True : absent;
+                };
+                break;
+            }
+            [[fallthrough]];
+        case ColumnKind::Bool:
+            in = [&col, set, absent](int s) {
+                if (col.isNull(s)) return SqlTruth::Unknown;
+                return set->contains(col.value(s)) ? SqlTruth::True : absent;
+            };
+            break;
+        }
+        return e->negated ? notOf(in) : in;
+    }
+
+    case SqlExpr::Kind::Like: {
+        const SqlExprPtr& v = e->args[0];
+        if (!isColumn(v, tab) || !e->like) break;
+        const Column& col = tab.column(v->index);
+        const SqlLikeMatcherPtr m = e->like;
+        const bool neg = e->negated;
+        if (col.kind() == ColumnKind::Text && col.isDictEncoded()) {
+            const DictHits hit(col, [&m](const QString& t) { return m->matches(t); });
+            return [&col, hit, neg](int s) {
+                return col.isNull(s) ? SqlTruth::Unknown : truth(hit(s) != neg);
+            };
+        }
+        if (col.kind() == ColumnKind::Text)
+            return [&col, m, neg](int s) {
+                return col.isNull(s) ? SqlTruth::Unknown : truth(m->matches(col.textAt(s)) != neg);
+            };
+        return [&col, m, neg](int s) {
+            const QVariant x = col.value(s);
+            if (sqlIsNull(x)) return SqlTruth::Unknown;
+            return truth(m->matches(x.toString()) != neg);
+        };
+    }
+
+    case SqlExpr::Kind::Column:
+    case SqlExpr::Kind::Aggregate:
+    case SqlExpr::Kind::Param:
+    case SqlExpr::Kind::InSelect:
+    case SqlExpr::Kind::Exists:
+        break;
+    }
+
+    // Forma general: se arma el Record y se evalúa la expresión
+    const ColumnTable* t = &tab;
+    const SqlExprPtr expr = e;
+    return [t, expr](int s) { return truthOf(sqlEval(*expr, t->record(s))); };
+}
+
+} // namespace
+
+SqlPredicate SqlPredicate::compile(const SqlExprPtr& boundExpr, const ColumnTable& tab)
+{
+    if (!boundExpr) return SqlPredicate();
+    return SqlPredicate(compileNode(boundExpr, tab));
+}
@@ -0,0 +1,133 @@
+#ifndef SQLPREDICATE_H
+#define SQLPREDICATE_H
+
+#include <QVariant>
+#include <QString>
+#include <QRegularExpression>
+#include <QStringMatcher>
+#include <QVector>
+#include <QSet>
+#include <functional>
+
+#include "sqlparser.h"
+#include "columnstore.h"
+
+/* ======================== Evaluación genérica ======================== */
+// Lógica de tres valores: un QVariant nulo es "desconocido". Reglas de
+// comparación: fechas (un texto 'yyyy-MM-dd' se interpreta), números, y si
+// no, texto sin distinguir mayúsculas.
+bool     sqlIsNull(const QVariant& v);
+bool     sqlIsTrue(const QVariant& v);
+int      sqlCompare(const QVariant& a, const QVariant& b);         // ambos no nulos
+int      sqlCompareForSort(const QVariant& a, const QVariant& b);  // NULL primero
+QRegularExpression sqlLikeRegex(const QString& pattern);           // % y _
+QVariant sqlEval(const SqlExpr& e, const Record& row);             // expresión ya enlazada
+
+/* =========================== LIKE compilado =========================== */
+// Patrón LIKE analizado una sola vez (sin distinguir mayúsculas, como
+// sqlLikeRegex). Las formas habituales no pasan por expresión regular:
+//   'abc'   -> igualdad          'abc%'  -> prefijo
+//   '%abc'  -> sufijo            '%abc%' -> subcadena (QStringMatcher)
+// Cualquier otro uso de % o _ queda como expresión regular. Lo usan el motor
+// SQL (sqlEval, SqlPredicate, índice por prefijo) y los filtros de informes.
+class SqlLikeMatcher {
+public:
+    enum class Kind : quint8 { Exact, Prefix, Suffix, Contains, Wildcard };
+
+    explicit SqlLikeMatcher(const QString& pattern = QString());
+
+    Kind           kind() const { return m_kind; }
+    const QString& literal() const { return m_lit; }   // texto fijo (salvo Wildcard)
+    const QString& pattern() const { return m_pattern; }
+    bool           matches(QStringView s) const;
+
+private:
+    Kind               m_kind = Kind::Exact;
+    QString            m_pattern;
+    QString            m_lit;
+    QStringMatcher     m_finder;   // Contains
+    QRegularExpression m_re;       // Wildcard
+};
+using SqlLikeMatcherPtr = QSharedPointer<const SqlLikeMatcher>;
+
+// Valor normalizado con la igualdad de sqlCompare, para tablas hash (joins,
+// GROUP BY): fechas (también textos 'yyyy-MM-dd'), números (los enteros como
+// double), texto sin mayúsculas y NULL, que es igual a sí mismo (agrupa; los
+// joins descartan esas filas antes de buscar).
+struct SqlKeyPart {
+    enum Cls : quint8 { Null, Date, Num, Text };
+    Cls     cls = Null;
+    qint64  day = 0;
+    double  num = 0;
+    QString text;
+
+    static SqlKeyPart of(const QVariant& v);
+    QVariant value() const;                  // representativo: of(value()) == *this
+    bool operator==(const SqlKeyPart& o) const;
+};
+using SqlKey = QVector<SqlKeyPart>;
+size_t qHash(const SqlKeyPart& k, size_t seed = 0);
+
+/* ========================= IN (lista) como conjunto ========================= */
+// Los literales de un IN normalizados una vez con SqlKeyPart (la igualdad de
+// sqlCompare): cada fila se resuelve con una sola búsqueda en lugar de una
+// comparación por elemento. Listas cortas: arreglo ordenado con búsqueda
+// binaria; largas: tabla hash. Los NULL de la lista solo se recuerdan (hacen
+// que un valor ausente dé "desconocido").
+class SqlInSet {
+public:
+    static constexpr int kSmallList = 16;
+
+    explicit SqlInSet(const QVector<QVariant>& values = {});
+
+    bool hasNull() const { return m_hasNull; }
+    int  size() const { return m_values.size(); }              // valores distintos no nulos
+    const QVector<SqlKeyPart>& values() const { return m_values; }
+
+    bool contains(const SqlKeyPart& k) const;
+    bool contains(const QVariant& v) const { return contains(SqlKeyPart::of(v)); }
+    bool containsNumber(double d) const;
+    bool containsDay(qint64 julianDay) const;
+
+    // Resultado de "v IN (...)" para un v no nulo, con la lógica de tres valores
+    // (NOT IN lo niega el llamador)
+    QVariant test(const SqlKeyPart& k) const {
+        return contains(k) ? QVariant(true) : m_hasNull ? QVariant() : QVariant(false);
+    }
+
+private:
+    QVector<SqlKeyPart> m_values;   // ordenado (solo se busca en él si es corto)
+    QSet<SqlKeyPart>    m_set;      // listas largas
+    bool                m_hasNull = false;
+};
+using SqlInSetPtr = QSharedPointer<const SqlInSet>;
+
+/* ======================= Predicados compilados ======================= */
+enum class SqlTruth : quint8 { False, True, Unknown };
+
+// WHERE compilado contra las columnas tipadas de una tabla: los ordinales se
+// resuelven una vez, cada literal se convierte una vez al tipo físico de su
+// columna y cada comparación queda como un closure especializado que lee el
+// slot directamente (sin armar Record ni pasar por QVariant). Lo que no tiene
+// forma especializada (aritmética, columna contra columna...) se evalúa con
+// sqlEval sobre el Record, con el mismo resultado.
+//
+// La tabla debe quedar inmutable mientras se use el predicado (un snapshot):
+// los closures guardan referencias a sus columnas y a su diccionario.
+class SqlPredicate {
+public:
+    SqlPredicate() = default;   // vacío: acepta todas las filas
+
+    static SqlPredicate compile(const SqlExprPtr& boundExpr, const ColumnTable& tab);
+
+    bool     isEmpty() const { return !m_fn; }
+    SqlTruth eval(int slot) const { return m_fn ? m_fn(slot) : SqlTruth::True; }
+    bool     matches(int slot) const { return !m_fn || m_fn(slot) == SqlTruth::True; }
+
+private:
+    using Fn = std::function<SqlTruth(int)>;
+    explicit SqlPredicate(Fn fn) : m_fn(std::move(fn)) {}
+    Fn m_fn;
+};
+
+#endif // SQLPREDICATE_H